@@ -36,6 +36,7 @@
 /* These are our own includes */
 #include <lib/include/gtable.h>
 #include <lib/include/clock.h>
+#include <lib/include/device.h>
 #include <lib/include/spi.h>
 #include <common.h>
 
@@ -45,11 +46,7 @@ int sja1105_cgu_mii_tx_clk_config(struct sja1105_spi_setup *spi_setup,
 	const int BUF_LEN = 4;
 	uint8_t packed_buf[BUF_LEN];
 	struct  sja1105_cgu_mii_control mii_tx_clk;
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int  mii_tx_clk_offsets_et[]   = {0x13, 0x1A, 0x21, 0x28, 0x2F};
-	/* UM11040.pdf, Table 114 */
-	const int  mii_tx_clk_offsets_pqrs[] = {0x13, 0x19, 0x1F, 0x25, 0x2B};
-	const int *mii_tx_clk_offsets;
+	const uint64_t *mii_tx_clk_offsets;
 	const int mac_clk_sources[] = {
 		CLKSRC_MII0_TX_CLK,
 		CLKSRC_MII1_TX_CLK,
@@ -66,10 +63,7 @@ int sja1105_cgu_mii_tx_clk_config(struct sja1105_spi_setup *spi_setup,
 	};
 	int clksrc;
 
-	/* E/T and P/Q/R/S compatibility */
-	mii_tx_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                     mii_tx_clk_offsets_et :
-	                     mii_tx_clk_offsets_pqrs;
+	mii_tx_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.mii_tx_clk;
 
 	if (mii_mode == XMII_MODE_MAC) {
 		clksrc = mac_clk_sources[port];
@@ -96,11 +90,7 @@ int sja1105_cgu_mii_rx_clk_config(
 	const int BUF_LEN = 4;
 	uint8_t packed_buf[BUF_LEN];
 	struct  sja1105_cgu_mii_control mii_rx_clk;
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int  mii_rx_clk_offsets_et[]   = {0x14, 0x1B, 0x22, 0x29, 0x30};
-	/* UM11040.pdf, Table 114 */
-	const int  mii_rx_clk_offsets_pqrs[] = {0x14, 0x1A, 0x20, 0x26, 0x2C};
-	const int *mii_rx_clk_offsets;
+	const uint64_t *mii_rx_clk_offsets;
 	const int clk_sources[] = {
 		CLKSRC_MII0_RX_CLK,
 		CLKSRC_MII1_RX_CLK,
@@ -109,10 +99,7 @@ int sja1105_cgu_mii_rx_clk_config(
 		CLKSRC_MII4_RX_CLK,
 	};
 
-	/* E/T and P/Q/R/S compatibility */
-	mii_rx_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                     mii_rx_clk_offsets_et :
-	                     mii_rx_clk_offsets_pqrs;
+	mii_rx_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.mii_rx_clk;
 
 	/* Payload for packed_buf */
 	mii_rx_clk.clksrc    = clk_sources[port];
@@ -134,11 +121,7 @@ int sja1105_cgu_mii_ext_tx_clk_config(
 	const int BUF_LEN = 4;
 	uint8_t packed_buf[BUF_LEN];
 	struct  sja1105_cgu_mii_control mii_ext_tx_clk;
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int  mii_ext_tx_clk_offsets_et[]   = {0x18, 0x1F, 0x26, 0x2D, 0x34};
-	/* UM11040.pdf, Table 114 */
-	const int  mii_ext_tx_clk_offsets_pqrs[] = {0x17, 0x1D, 0x23, 0x29, 0x2F};
-	const int *mii_ext_tx_clk_offsets;
+	const uint64_t *mii_ext_tx_clk_offsets;
 	const int clk_sources[] = {
 		CLKSRC_IDIV0,
 		CLKSRC_IDIV1,
@@ -147,10 +130,7 @@ int sja1105_cgu_mii_ext_tx_clk_config(
 		CLKSRC_IDIV4,
 	};
 
-	/* E/T and P/Q/R/S compatibility */
-	mii_ext_tx_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                         mii_ext_tx_clk_offsets_et :
-	                         mii_ext_tx_clk_offsets_pqrs;
+	mii_ext_tx_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.mii_ext_tx_clk;
 
 	/* Payload for packed_buf */
 	mii_ext_tx_clk.clksrc    = clk_sources[port];
@@ -173,11 +153,7 @@ int sja1105_cgu_mii_ext_rx_clk_config(
 	const int BUF_LEN = 4;
 	uint8_t packed_buf[BUF_LEN];
 	struct  sja1105_cgu_mii_control mii_ext_rx_clk;
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int  mii_ext_rx_clk_offsets_et[]   = {0x19, 0x20, 0x27, 0x2E, 0x35};
-	/* UM11040.pdf, Table 114 */
-	const int  mii_ext_rx_clk_offsets_pqrs[] = {0x18, 0x1E, 0x24, 0x2A, 0x30};
-	const int *mii_ext_rx_clk_offsets;
+	const uint64_t *mii_ext_rx_clk_offsets;
 	const int clk_sources[] = {
 		CLKSRC_IDIV0,
 		CLKSRC_IDIV1,
@@ -186,10 +162,7 @@ int sja1105_cgu_mii_ext_rx_clk_config(
 		CLKSRC_IDIV4,
 	};
 
-	/* E/T and P/Q/R/S compatibility */
-	mii_ext_rx_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                         mii_ext_rx_clk_offsets_et :
-	                         mii_ext_rx_clk_offsets_pqrs;
+	mii_ext_rx_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.mii_ext_rx_clk;
 
 	/* Payload for packed_buf */
 	mii_ext_rx_clk.clksrc    = clk_sources[port];
@@ -36,6 +36,7 @@
 /* These are our own includes */
 #include <lib/include/gtable.h>
 #include <lib/include/clock.h>
+#include <lib/include/device.h>
 #include <lib/include/spi.h>
 #include <common.h>
 
@@ -46,18 +47,11 @@ int sja1105_cgu_rgmii_tx_clk_config(
 {
 	int clksrc;
 	const int BUF_LEN = 4;
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int txc_offsets_et[] = {0x16, 0x1D, 0x24, 0x2B, 0x32};
-	/* UM11040.pdf, Table 114, CGU Register overview */
-	const int txc_offsets_pqrs[] = {0x16, 0x1C, 0x22, 0x28, 0x2E};
-	const int *txc_offsets;
+	const uint64_t *txc_offsets;
 	uint8_t packed_buf[BUF_LEN];
 	struct  sja1105_cgu_mii_control txc;
 
-	/* E/T and P/Q/R/S compatibility */
-	txc_offsets = IS_ET(spi_setup->device_id) ?
-	                     txc_offsets_et :
-	                     txc_offsets_pqrs;
+	txc_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.rgmii_txc;
 
 	if (speed_mbps == 1000) {
 		clksrc = CLKSRC_PLL0;
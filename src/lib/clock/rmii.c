@@ -36,6 +36,7 @@
 /* These are our own includes */
 #include <lib/include/gtable.h>
 #include <lib/include/clock.h>
+#include <lib/include/device.h>
 #include <lib/include/spi.h>
 #include <common.h>
 
@@ -45,11 +46,7 @@ int sja1105_cgu_rmii_ref_clk_config(struct sja1105_spi_setup *spi_setup,
 	const int BUF_LEN = 4;
 	struct  sja1105_cgu_mii_control ref_clk;
 	uint8_t packed_buf[BUF_LEN];
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int ref_clk_offsets_et[] = {0x15, 0x1C, 0x23, 0x2A, 0x31};
-	/* UM11040.pdf, Table 114, CGU Register overview */
-	const int ref_clk_offsets_pqrs[] = {0x15, 0x1B, 0x21, 0x27, 0x2D};
-	const int *ref_clk_offsets;
+	const uint64_t *ref_clk_offsets;
 	const int clk_sources[] = {
 		CLKSRC_MII0_TX_CLK,
 		CLKSRC_MII1_TX_CLK,
@@ -58,10 +55,7 @@ int sja1105_cgu_rmii_ref_clk_config(struct sja1105_spi_setup *spi_setup,
 		CLKSRC_MII4_TX_CLK,
 	};
 
-	/* E/T and P/Q/R/S compatibility */
-	ref_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                     ref_clk_offsets_et :
-	                     ref_clk_offsets_pqrs;
+	ref_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.rmii_ref_clk;
 
 	/* Payload for packed_buf */
 	ref_clk.clksrc    = clk_sources[port];
@@ -82,16 +76,9 @@ int sja1105_cgu_rmii_ext_tx_clk_config(struct sja1105_spi_setup *spi_setup,
 	const int BUF_LEN = 4;
 	struct  sja1105_cgu_mii_control ext_tx_clk;
 	uint8_t packed_buf[BUF_LEN];
-	/* UM10944.pdf, Table 78, CGU Register overview */
-	const int ext_tx_clk_offsets_et[] = {0x18, 0x1F, 0x26, 0x2D, 0x34};
-	/* UM11040.pdf, Table 114, CGU Register overview */
-	const int ext_tx_clk_offsets_pqrs[] = {0x17, 0x1D, 0x23, 0x29, 0x2F};
-	const int *ext_tx_clk_offsets;
-
-	/* E/T and P/Q/R/S compatibility */
-	ext_tx_clk_offsets = IS_ET(spi_setup->device_id) ?
-	                     ext_tx_clk_offsets_et :
-	                     ext_tx_clk_offsets_pqrs;
+	const uint64_t *ext_tx_clk_offsets;
+
+	ext_tx_clk_offsets = sja1105_spi_setup_ops(spi_setup)->cgu.rmii_ext_tx_clk;
 
 	/* Payload for packed_buf */
 	ext_tx_clk.clksrc    = CLKSRC_PLL1;
@@ -0,0 +1,198 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/* These are our own include files */
+#include <lib/include/context.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <lib/helpers.h>
+#include <common.h>
+
+struct sja1105_ctx {
+	struct sja1105_spi_setup spi_setup;
+	pthread_mutex_t          bus_lock;
+	int                      quirks;
+	int                      opened;
+	struct sja1105_ctx_stats stats;
+	void                    *buf;
+	size_t                   buf_len;
+	struct sja1105_spi_batch batch;
+};
+
+/*
+ * Create a context from a filled-in SPI setup (as read from
+ * sja1105.conf). The setup is copied; the caller's structure
+ * is not referenced afterwards, except for the device and
+ * staging_area strings which must outlive the context.
+ */
+struct sja1105_ctx *sja1105_ctx_new(const struct sja1105_spi_setup *spi_setup)
+{
+	struct sja1105_ctx *ctx;
+	pthread_mutexattr_t attr;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		loge("failed to allocate context");
+		goto out;
+	}
+	memcpy(&ctx->spi_setup, spi_setup, sizeof(*spi_setup));
+	ctx->spi_setup.fd  = -1;
+	ctx->spi_setup.ctx = ctx;
+	ctx->quirks = QUIRK_LSW32_IS_FIRST;
+	/* Recursive, so that multi-transfer operations can hold
+	 * the bus while sja1105_spi_transfer takes it again */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&ctx->bus_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+out:
+	return ctx;
+}
+
+void sja1105_ctx_free(struct sja1105_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	if (ctx->spi_setup.fd >= 0) {
+		close(ctx->spi_setup.fd);
+	}
+	pthread_mutex_destroy(&ctx->bus_lock);
+	free(ctx->buf);
+	free(ctx);
+}
+
+/* Open the SPI device and detect the switch, once */
+int sja1105_ctx_open(struct sja1105_ctx *ctx)
+{
+	int rc = 0;
+
+	sja1105_ctx_lock(ctx);
+	if (ctx->opened) {
+		goto out;
+	}
+	rc = sja1105_spi_configure(&ctx->spi_setup);
+	if (rc < 0) {
+		goto out;
+	}
+	ctx->opened = 1;
+out:
+	sja1105_ctx_unlock(ctx);
+	return rc;
+}
+
+struct sja1105_spi_setup *sja1105_ctx_spi_setup(struct sja1105_ctx *ctx)
+{
+	return &ctx->spi_setup;
+}
+
+void sja1105_ctx_set_quirks(struct sja1105_ctx *ctx, int quirks)
+{
+	sja1105_ctx_lock(ctx);
+	ctx->quirks = quirks;
+	sja1105_ctx_unlock(ctx);
+}
+
+/*
+ * Take the bus for a sequence of SPI transfers that must not be
+ * interleaved with those of other threads (e.g. a dynamic
+ * reconfiguration command and its read-back). This also applies
+ * the quirks of the context to the calling thread.
+ * A NULL context (bare sja1105_spi_setup) is a no-op.
+ */
+void sja1105_ctx_lock(struct sja1105_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&ctx->bus_lock);
+	gtable_configure(ctx->quirks);
+}
+
+void sja1105_ctx_unlock(struct sja1105_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	pthread_mutex_unlock(&ctx->bus_lock);
+}
+
+void sja1105_ctx_stats_get(struct sja1105_ctx *ctx,
+                           struct sja1105_ctx_stats *stats)
+{
+	sja1105_ctx_lock(ctx);
+	memcpy(stats, &ctx->stats, sizeof(*stats));
+	sja1105_ctx_unlock(ctx);
+}
+
+/* Called by sja1105_spi_transfer with the bus lock held */
+void sja1105_ctx_account(struct sja1105_ctx *ctx, int bytes, int rc)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	ctx->stats.transfers++;
+	ctx->stats.bytes += bytes;
+	if (rc < 0) {
+		ctx->stats.errors++;
+	}
+}
+
+/*
+ * Scratch buffer owned by the context, grown on demand.
+ * It stays valid until the next call or sja1105_ctx_free,
+ * and callers must hold the bus lock while using it.
+ */
+void *sja1105_ctx_buf_get(struct sja1105_ctx *ctx, size_t len)
+{
+	void *buf;
+
+	if (len <= ctx->buf_len) {
+		return ctx->buf;
+	}
+	buf = realloc(ctx->buf, len);
+	if (buf == NULL) {
+		loge("failed to allocate %zu bytes", len);
+		return NULL;
+	}
+	ctx->buf = buf;
+	ctx->buf_len = len;
+	return buf;
+}
+
+/* Callers must hold the bus lock */
+struct sja1105_spi_batch *sja1105_ctx_batch(struct sja1105_ctx *ctx)
+{
+	return &ctx->batch;
+}
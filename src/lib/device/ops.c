@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <stdint.h>
+/* These are our own include files */
+#include <lib/include/static-config.h>
+#include <lib/include/device.h>
+#include <lib/include/ptp.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+const struct sja1105_device_ops sja1105et_device_ops = {
+	.family = "E/T",
+	/* No configuration-only reset on E/T */
+	.config_mode_reset = sja1105_cold_reset,
+	.core = {
+		.ptp_control       = 0x17,
+		.ptpschtm          = SJA1105T_PTPSCHTM_ADDR,
+		.ptppinst          = SJA1105ET_PTPPINST_ADDR,
+		.ptppindur         = SJA1105ET_PTPPINDUR_ADDR,
+		.ptpclkval         = SJA1105ET_PTPCLKVAL_ADDR,
+		.ptpclkrate        = SJA1105ET_PTPCLKRATE_ADDR,
+		.ptptsclk          = SJA1105ET_PTPTSCLK_ADDR,
+		.ptpclkcorp        = SJA1105T_PTPCLKCORP_ADDR,
+		.port_status_ctrl  = 0x0F,
+		.vlan_lookup_dyn   = 0x27,
+		.l2_forwarding_dyn = 0x24,
+	},
+	/* UM10944.pdf, Table 78, CGU Register overview */
+	.cgu = {
+		.mii_tx_clk       = {0x13, 0x1A, 0x21, 0x28, 0x2F},
+		.mii_rx_clk       = {0x14, 0x1B, 0x22, 0x29, 0x30},
+		.mii_ext_tx_clk   = {0x18, 0x1F, 0x26, 0x2D, 0x34},
+		.mii_ext_rx_clk   = {0x19, 0x20, 0x27, 0x2E, 0x35},
+		.rgmii_txc        = {0x16, 0x1D, 0x24, 0x2B, 0x32},
+		.rmii_ref_clk     = {0x15, 0x1C, 0x23, 0x2A, 0x31},
+		.rmii_ext_tx_clk  = {0x18, 0x1F, 0x26, 0x2D, 0x34},
+	},
+	.general_status                = &sja1105et_general_status_reg,
+	.ptpegr_ts_bits                = 24,
+	.has_qlevel                    = 0,
+	.l2_lookup_entry_size          = SIZE_L2_LOOKUP_ENTRY_ET,
+	.l2_lookup_entry_pack          = sja1105et_l2_lookup_entry_pack,
+	.l2_lookup_entry_unpack        = sja1105et_l2_lookup_entry_unpack,
+	.mac_config_entry_size         = SIZE_MAC_CONFIG_ENTRY_ET,
+	.mac_config_entry_pack         = sja1105et_mac_config_entry_pack,
+	.mac_config_entry_unpack       = sja1105et_mac_config_entry_unpack,
+	.l2_lookup_params_entry_size   = SIZE_L2_LOOKUP_PARAMS_ENTRY_ET,
+	.l2_lookup_params_entry_pack   = sja1105et_l2_lookup_params_entry_pack,
+	.l2_lookup_params_entry_unpack = sja1105et_l2_lookup_params_entry_unpack,
+	.avb_params_entry_size         = SIZE_AVB_PARAMS_ENTRY_ET,
+	.avb_params_entry_pack         = sja1105et_avb_params_entry_pack,
+	.avb_params_entry_unpack       = sja1105et_avb_params_entry_unpack,
+	.general_params_entry_size     = SIZE_GENERAL_PARAMS_ENTRY_ET,
+	.general_params_entry_pack     = sja1105et_general_params_entry_pack,
+	.general_params_entry_unpack   = sja1105et_general_params_entry_unpack,
+};
+
+const struct sja1105_device_ops sja1105pqrs_device_ops = {
+	.family = "P/Q/R/S",
+	.config_mode_reset = sja1105_config_reset,
+	.core = {
+		.ptp_control       = 0x18,
+		.ptpschtm          = SJA1105QS_PTPSCHTM_ADDR,
+		.ptppinst          = SJA1105PQRS_PTPPINST_ADDR,
+		.ptppindur         = SJA1105PQRS_PTPPINDUR_ADDR,
+		.ptpclkval         = SJA1105PQRS_PTPCLKVAL_ADDR,
+		.ptpclkrate        = SJA1105PQRS_PTPCLKRATE_ADDR,
+		.ptptsclk          = SJA1105PQRS_PTPTSCLK_ADDR,
+		.ptpclkcorp        = SJA1105QS_PTPCLKCORP_ADDR,
+		.port_status_ctrl  = 0x10,
+		.vlan_lookup_dyn   = 0x2D,
+		.l2_forwarding_dyn = 0x2A,
+	},
+	/* UM11040.pdf, Table 114 */
+	.cgu = {
+		.mii_tx_clk       = {0x13, 0x19, 0x1F, 0x25, 0x2B},
+		.mii_rx_clk       = {0x14, 0x1A, 0x20, 0x26, 0x2C},
+		.mii_ext_tx_clk   = {0x17, 0x1D, 0x23, 0x29, 0x2F},
+		.mii_ext_rx_clk   = {0x18, 0x1E, 0x24, 0x2A, 0x30},
+		.rgmii_txc        = {0x16, 0x1C, 0x22, 0x28, 0x2E},
+		.rmii_ref_clk     = {0x15, 0x1B, 0x21, 0x27, 0x2D},
+		.rmii_ext_tx_clk  = {0x17, 0x1D, 0x23, 0x29, 0x2F},
+	},
+	.general_status                = &sja1105pqrs_general_status_reg,
+	.ptpegr_ts_bits                = 32,
+	.has_qlevel                    = 1,
+	.l2_lookup_entry_size          = SIZE_L2_LOOKUP_ENTRY_PQRS,
+	.l2_lookup_entry_pack          = sja1105pqrs_l2_lookup_entry_pack,
+	.l2_lookup_entry_unpack        = sja1105pqrs_l2_lookup_entry_unpack,
+	.mac_config_entry_size         = SIZE_MAC_CONFIG_ENTRY_PQRS,
+	.mac_config_entry_pack         = sja1105pqrs_mac_config_entry_pack,
+	.mac_config_entry_unpack       = sja1105pqrs_mac_config_entry_unpack,
+	.l2_lookup_params_entry_size   = SIZE_L2_LOOKUP_PARAMS_ENTRY_PQRS,
+	.l2_lookup_params_entry_pack   = sja1105pqrs_l2_lookup_params_entry_pack,
+	.l2_lookup_params_entry_unpack = sja1105pqrs_l2_lookup_params_entry_unpack,
+	.avb_params_entry_size         = SIZE_AVB_PARAMS_ENTRY_PQRS,
+	.avb_params_entry_pack         = sja1105pqrs_avb_params_entry_pack,
+	.avb_params_entry_unpack       = sja1105pqrs_avb_params_entry_unpack,
+	.general_params_entry_size     = SIZE_GENERAL_PARAMS_ENTRY_PQRS,
+	.general_params_entry_pack     = sja1105pqrs_general_params_entry_pack,
+	.general_params_entry_unpack   = sja1105pqrs_general_params_entry_unpack,
+};
+
+/*
+ * Anything that is not E/T is treated as P/Q/R/S, which is what the
+ * IS_ET() tests that used to be spread throughout the code did.
+ */
+const struct sja1105_device_ops *sja1105_device_ops_get(uint64_t device_id)
+{
+	if (IS_ET(device_id)) {
+		return &sja1105et_device_ops;
+	}
+	return &sja1105pqrs_device_ops;
+}
+
+/* Ops bound by sja1105_spi_configure, or resolved now for
+ * an spi_setup that was filled in by hand */
+const struct sja1105_device_ops *
+sja1105_spi_setup_ops(const struct sja1105_spi_setup *spi_setup)
+{
+	if (spi_setup->ops) {
+		return spi_setup->ops;
+	}
+	return sja1105_device_ops_get(spi_setup->device_id);
+}
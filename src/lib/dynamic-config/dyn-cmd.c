@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+/* These are our own include files */
+#include <lib/include/context.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <lib/helpers.h>
+#include <common.h>
+
+/* All dynamic reconfiguration interfaces handled here share the same
+ * layout: the entry, optionally followed by padding, and then a
+ * command word in the last 4 bytes of buf, with VALID at bit 31.
+ * The hardware clears VALID once it has processed the command.
+ *
+ * If errors_bit is not negative, the command word is read back after
+ * completion and the command is considered failed if that bit is set.
+ */
+int sja1105_dyn_cmd_commit(struct sja1105_spi_setup *spi_setup,
+                           uint64_t addr, void *buf, int len,
+                           int errors_bit)
+{
+	uint64_t cmd_addr = addr + len / 4 - 1;
+	struct sja1105_spi_wait valid = {
+		.reg_addr   = cmd_addr,
+		.start_bit  = 31,
+		.end_bit    = 31,
+		.expected   = 0,
+		.timeout_us = 10000,
+	};
+	uint64_t cmd;
+	int rc;
+
+	sja1105_ctx_lock(spi_setup->ctx);
+
+	rc = sja1105_spi_send_packed_buf(spi_setup, SPI_WRITE, addr,
+	                                 buf, len);
+	if (rc < 0) {
+		loge("failed to send dynamic command to 0x%" PRIx64, addr);
+		goto out;
+	}
+	rc = sja1105_spi_wait_field(spi_setup, &valid);
+	if (rc < 0) {
+		loge("dynamic command at 0x%" PRIx64 " did not complete", addr);
+		goto out;
+	}
+	if (errors_bit < 0 || spi_setup->dry_run) {
+		goto out;
+	}
+	rc = sja1105_spi_send_int(spi_setup, SPI_READ, cmd_addr, &cmd, 4);
+	if (rc < 0) {
+		loge("failed to read back dynamic command at 0x%" PRIx64,
+		     cmd_addr);
+		goto out;
+	}
+	if (cmd & (1ull << errors_bit)) {
+		loge("dynamic command at 0x%" PRIx64 " was rejected", addr);
+		rc = -EIO;
+	}
+out:
+	sja1105_ctx_unlock(spi_setup->ctx);
+	return rc;
+}
@@ -35,6 +35,7 @@
 #include <stdio.h>
 /* These are our own include files */
 #include <lib/include/dynamic-config.h>
+#include <lib/include/context.h>
 #include <lib/include/static-config.h>
 #include <lib/include/gtable.h>
 #include <lib/include/spi.h>
@@ -144,6 +145,13 @@ sja1105_mgmt_route_commit(struct sja1105_spi_setup *spi_setup,
 	/* Structure to hold command we are constructing,
 	 * and mgmt entry we are reading/writing */
 	struct sja1105_dyn_l2_lookup_cmd cmd;
+	struct sja1105_spi_wait valid = {
+		.reg_addr   = ENTRY_ADDR + SIZE_L2_LOOKUP_ENTRY_ET / 4,
+		.start_bit  = 31,
+		.end_bit    = 31,
+		.expected   = 0,
+		.timeout_us = 10000,
+	};
 	int rc;
 
 	memset(&cmd, 0, sizeof(cmd));
@@ -160,6 +168,10 @@ sja1105_mgmt_route_commit(struct sja1105_spi_setup *spi_setup,
 	cmd.entry.mgmt.enfport = 1;
 	sja1105_dyn_l2_lookup_cmd_pack(packed_buf, &cmd);
 
+	/* The command, its completion and its read-back must not be
+	 * interleaved with another thread's dynamic command */
+	sja1105_ctx_lock(spi_setup->ctx);
+
 	/* Send SPI write operation: "read/write mgmt table entry" */
 	rc = sja1105_spi_send_packed_buf(spi_setup,
 	                                 SPI_WRITE,
@@ -170,6 +182,13 @@ sja1105_mgmt_route_commit(struct sja1105_spi_setup *spi_setup,
 		loge("failed to read from spi");
 		goto out;
 	}
+	/* Hardware clears VALID when it has finished processing
+	 * the command. Only then is the result available. */
+	rc = sja1105_spi_wait_field(spi_setup, &valid);
+	if (rc < 0) {
+		loge("dynamic l2 lookup command did not complete");
+		goto out;
+	}
 
 	if (read_or_write == SPI_READ) {
 		/* If previous operation was a read, retrieve its result:
@@ -188,6 +207,7 @@ sja1105_mgmt_route_commit(struct sja1105_spi_setup *spi_setup,
 		memcpy(entry, &cmd.entry, sizeof(*entry));
 	}
 out:
+	sja1105_ctx_unlock(spi_setup->ctx);
 	return rc;
 }
 
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+/* These are our own include files */
+#include <lib/include/dynamic-config.h>
+#include <lib/include/static-config.h>
+#include <lib/include/device.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <lib/helpers.h>
+#include <common.h>
+
+/* Buffer is segregated into 3 parts:
+ *   * ENTRY: a portion of SIZE_VLAN_LOOKUP_ENTRY (8) bytes
+ *   * a 4 byte gap, which is not used
+ *   * CMD: a portion of 4 bytes
+ * The entry is indexed by its own VLANID field.
+ */
+#define SIZE_DYN_VLAN_LOOKUP_CMD (SIZE_VLAN_LOOKUP_ENTRY + 4 + 4)
+
+static void
+sja1105_dyn_vlan_lookup_cmd_access(void *buf,
+                                   struct sja1105_dyn_vlan_lookup_cmd *cmd,
+                                   int write)
+{
+	int  (*pack_or_unpack)(void*, uint64_t*, int, int, int);
+	uint8_t *cmd_ptr = (uint8_t*) buf + SIZE_VLAN_LOOKUP_ENTRY + 4;
+
+	if (write == 0) {
+		pack_or_unpack = gtable_unpack;
+		memset(cmd, 0, sizeof(*cmd));
+		sja1105_vlan_lookup_entry_unpack(buf, &cmd->entry);
+	} else {
+		pack_or_unpack = gtable_pack;
+		memset(buf, 0, SIZE_DYN_VLAN_LOOKUP_CMD);
+		sja1105_vlan_lookup_entry_pack(buf, &cmd->entry);
+	}
+	pack_or_unpack(cmd_ptr, &cmd->valid,    31, 31, 4);
+	pack_or_unpack(cmd_ptr, &cmd->rdwrset,  30, 30, 4);
+	pack_or_unpack(cmd_ptr, &cmd->valident, 27, 27, 4);
+}
+
+void sja1105_dyn_vlan_lookup_cmd_pack(void *buf, struct
+                                      sja1105_dyn_vlan_lookup_cmd *cmd)
+{
+	sja1105_dyn_vlan_lookup_cmd_access(buf, cmd, 1);
+}
+
+void sja1105_dyn_vlan_lookup_cmd_unpack(void *buf, struct
+                                        sja1105_dyn_vlan_lookup_cmd *cmd)
+{
+	sja1105_dyn_vlan_lookup_cmd_access(buf, cmd, 0);
+}
+
+static int
+sja1105_vlan_lookup_commit(struct sja1105_spi_setup *spi_setup,
+                           struct sja1105_vlan_lookup_entry *entry,
+                           int valident)
+{
+	const struct sja1105_device_ops *ops;
+	uint8_t packed_buf[SIZE_DYN_VLAN_LOOKUP_CMD];
+	struct sja1105_dyn_vlan_lookup_cmd cmd;
+
+	ops = sja1105_spi_setup_ops(spi_setup);
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.valid    = 1;
+	cmd.rdwrset  = 1;
+	cmd.valident = valident;
+	cmd.entry    = *entry;
+	sja1105_dyn_vlan_lookup_cmd_pack(packed_buf, &cmd);
+
+	return sja1105_dyn_cmd_commit(spi_setup, ops->core.vlan_lookup_dyn,
+	                              packed_buf, SIZE_DYN_VLAN_LOOKUP_CMD,
+	                              -1);
+}
+
+int sja1105_vlan_lookup_set(struct sja1105_spi_setup *spi_setup,
+                            struct sja1105_vlan_lookup_entry *entry)
+{
+	return sja1105_vlan_lookup_commit(spi_setup, entry, 1);
+}
+
+int sja1105_vlan_lookup_del(struct sja1105_spi_setup *spi_setup,
+                            uint64_t vlanid)
+{
+	struct sja1105_vlan_lookup_entry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.vlanid = vlanid;
+	return sja1105_vlan_lookup_commit(spi_setup, &entry, 0);
+}
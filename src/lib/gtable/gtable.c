@@ -48,7 +48,9 @@
 
 #define loge(fmt, ...) fprintf(stderr, fmt "\n", ##__VA_ARGS__)
 
-int g_quirks = QUIRK_LSW32_IS_FIRST;
+/* Per-thread, so that contexts with different quirks can be used
+ * from different threads. See sja1105_ctx_lock. */
+__thread int g_quirks = QUIRK_LSW32_IS_FIRST;
 
 enum gtable_operation {
 	GTABLE_PACK,
@@ -290,6 +292,13 @@ void gtable_bitdump(void *table, int len)
 	printf("\n");
 }
 
+/* Quirks in effect for the calling thread, to be passed on
+ * with gtable_configure to helper threads */
+int gtable_quirks_get(void)
+{
+	return g_quirks;
+}
+
 int gtable_configure(int quirks)
 {
 	g_quirks = quirks;
@@ -318,14 +327,15 @@ static uint32_t crc32_add(uint32_t crc, uint8_t byte)
 	return crc;
 }
 
-uint32_t ether_crc32_le(void *buf, unsigned int len)
+/* Incremental form of ether_crc32_le, for data that is produced
+ * piecewise. Start from ETHER_CRC32_SEED, feed every piece (each a
+ * multiple of 4 bytes long) through ether_crc32_le_update, and get
+ * the CRC with ether_crc32_le_final. */
+uint32_t ether_crc32_le_update(uint32_t crc, void *buf, unsigned int len)
 {
 	unsigned int i;
 	uint64_t chunk;
-	uint32_t crc;
 
-	/* seed */
-	crc = 0xFFFFFFFF;
 	for (i = 0; i < len; i += 4) {
 		gtable_unpack(buf + i, &chunk, 31, 0, 4);
 		crc = crc32_add(crc, chunk & 0xFF);
@@ -333,9 +343,22 @@ uint32_t ether_crc32_le(void *buf, unsigned int len)
 		crc = crc32_add(crc, (chunk >> 16) & 0xFF);
 		crc = crc32_add(crc, (chunk >> 24) & 0xFF);
 	}
+	return crc;
+}
+
+uint32_t ether_crc32_le_final(uint32_t crc)
+{
 	return bit_reverse(~crc, 32);
 }
 
+uint32_t ether_crc32_le(void *buf, unsigned int len)
+{
+	uint32_t crc;
+
+	crc = ether_crc32_le_update(ETHER_CRC32_SEED, buf, len);
+	return ether_crc32_le_final(crc);
+}
+
 static uint8_t crc8_add(uint8_t crc, uint8_t byte, uint8_t poly)
 {
 	int i;
@@ -372,3 +395,17 @@ uint8_t fdb_hash(uint64_t vlanid, uint64_t macaddr, uint64_t poly_koopman)
 	return crc;
 }
 
+
+/* 64-bit FNV-1a hash, used to fingerprint configuration tables */
+uint64_t sja1105_fnv1a64(const void *buf, unsigned int len)
+{
+	const uint8_t *p = buf;
+	uint64_t hash = 0xCBF29CE484222325ull;
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
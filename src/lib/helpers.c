@@ -69,6 +69,8 @@ const char *sja1105_err_code_to_string(int rc)
 		return "SJA1105_ERR_INVALID_XML";
 	case SJA1105_ERR_FILESYSTEM:
 		return "SJA1105_ERR_FILESYSTEM";
+	case SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK:
+		return "SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK";
 	default:
 		return "unknown error code";
 	}
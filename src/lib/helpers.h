@@ -35,4 +35,35 @@
 
 void  mac_addr_sprintf(char *buf, uint64_t mac_hexval);
 
+struct sja1105_ctx;
+void  sja1105_ctx_account(struct sja1105_ctx *ctx, int bytes, int rc);
+
+/* SPI writes queued between sja1105_spi_batch_begin and
+ * sja1105_spi_batch_end, sent as one SPI_IOC_MESSAGE. spidev
+ * refuses messages larger than its buffer (4096 bytes by default).
+ */
+#define SPI_BATCH_MAX_XFERS 32
+#define SPI_BATCH_MAX_BYTES 4096
+
+struct sja1105_spi_batch {
+	int     depth;
+	int     rc;
+	int     count;
+	int     len;
+	int     xfer_len[SPI_BATCH_MAX_XFERS];
+	uint8_t buf[SPI_BATCH_MAX_BYTES];
+};
+
+struct sja1105_spi_batch *sja1105_ctx_batch(struct sja1105_ctx *ctx);
+
+struct sja1105_spi_setup;
+int   sja1105_spi_batch_add(const struct sja1105_spi_setup *spi_setup,
+                            const void *tx, int size);
+int   sja1105_dyn_cmd_commit(struct sja1105_spi_setup *spi_setup,
+                             uint64_t addr, void *buf, int len,
+                             int errors_bit);
+
+int   sja1105_parallel_run(int jobs, int (*fn)(void *priv, int job),
+                           void *priv);
+
 #endif
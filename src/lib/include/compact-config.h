@@ -0,0 +1,148 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#ifndef _COMPACT_CONFIG_H
+#define _COMPACT_CONFIG_H
+
+#include <stddef.h>
+#include "static-config.h"
+
+/* Tables in the order in which they are laid out in the
+ * packed static config (increasing block ID) */
+enum sja1105_blk_idx {
+	BLK_IDX_SCHEDULE = 0,
+	BLK_IDX_SCHEDULE_ENTRY_POINTS,
+	BLK_IDX_VL_LOOKUP,
+	BLK_IDX_VL_POLICING,
+	BLK_IDX_VL_FORWARDING,
+	BLK_IDX_L2_LOOKUP,
+	BLK_IDX_L2_POLICING,
+	BLK_IDX_VLAN_LOOKUP,
+	BLK_IDX_L2_FORWARDING,
+	BLK_IDX_MAC_CONFIG,
+	BLK_IDX_SCHEDULE_PARAMS,
+	BLK_IDX_SCHEDULE_ENTRY_POINTS_PARAMS,
+	BLK_IDX_VL_FORWARDING_PARAMS,
+	BLK_IDX_L2_LOOKUP_PARAMS,
+	BLK_IDX_L2_FORWARDING_PARAMS,
+	BLK_IDX_AVB_PARAMS,
+	BLK_IDX_GENERAL_PARAMS,
+	BLK_IDX_XMII_PARAMS,
+	BLK_IDX_SGMII,
+	BLK_IDX_MAX,
+};
+
+struct sja1105_device_ops;
+
+/* Everything needed to handle one table generically. The entry
+ * functions take a pointer to the struct sja1105_<table>_entry
+ * matching the table, and the ops of the device, which provide
+ * the layout of the tables that differ between E/T and P/Q/R/S.
+ * Those have an entry_size of 0: use sja1105_table_entry_size.
+ */
+struct sja1105_table_desc {
+	/* Name of the member in struct sja1105_static_config */
+	const char *name;
+	uint64_t    block_id;
+	int         max_count;
+	size_t      entry_struct_size;
+	size_t      array_offset;
+	size_t      count_offset;
+	int         entry_size;
+	/* Offset of the entry size in struct sja1105_device_ops,
+	 * for the tables with no fixed entry_size */
+	size_t      ops_entry_size_offset;
+	void      (*pack)(const struct sja1105_device_ops *ops,
+	                  void *buf, void *entry);
+	void      (*unpack)(const struct sja1105_device_ops *ops,
+	                    void *buf, void *entry);
+};
+
+/* A table is kept in its packed (hardware) form, which is also its
+ * narrowest form, in a buffer sized for the entries actually present.
+ */
+struct sja1105_compact_table {
+	int      count;
+	int      entry_size;
+	uint8_t *entries;
+};
+
+/* Alternative to struct sja1105_static_config, whose size does not
+ * depend on the hardware table limits but on the entries present.
+ * Initialize with sja1105_compact_config_init and release with
+ * sja1105_compact_config_free.
+ */
+struct sja1105_compact_config {
+	uint64_t device_id;
+	struct sja1105_compact_table tables[BLK_IDX_MAX];
+};
+
+const struct sja1105_table_desc *sja1105_table_desc_get(int blk_idx);
+int  sja1105_blk_idx_from_id(uint64_t block_id);
+int  sja1105_table_skipped_entry_size(uint64_t block_id);
+int  sja1105_table_entry_size(int blk_idx, uint64_t device_id);
+
+void sja1105_compact_config_init(struct sja1105_compact_config*,
+                                 uint64_t device_id);
+void sja1105_compact_config_free(struct sja1105_compact_config*);
+int  sja1105_compact_config_resize(struct sja1105_compact_config*,
+                                   int blk_idx, int count);
+int  sja1105_compact_config_get_entry(const struct sja1105_compact_config*,
+                                      int blk_idx, int index, void *entry);
+int  sja1105_compact_config_set_entry(struct sja1105_compact_config*,
+                                      int blk_idx, int index, void *entry);
+size_t sja1105_compact_config_mem_size(const struct sja1105_compact_config*);
+
+int  sja1105_compact_config_from_static(struct sja1105_compact_config*,
+                                        struct sja1105_static_config*);
+int  sja1105_compact_table_from_static(struct sja1105_compact_config*,
+                                       struct sja1105_static_config*,
+                                       int blk_idx);
+int  sja1105_compact_config_to_static(struct sja1105_static_config*,
+                                      const struct sja1105_compact_config*);
+
+unsigned int
+sja1105_compact_config_get_length(const struct sja1105_compact_config*);
+int  sja1105_compact_config_pack(void *buf,
+                                 const struct sja1105_compact_config*);
+int  sja1105_compact_config_unpack(void *buf, unsigned int len,
+                                   struct sja1105_compact_config*);
+int  sja1105_table_entries_unpack(struct sja1105_static_config*,
+                                  int blk_idx, void *data, int count);
+
+int  sja1105_parallel_configure(int threads);
+int  sja1105_parallel_threads(void);
+
+int  sja1105_static_config_stream(struct sja1105_static_config*,
+                                  int (*write)(void *priv, const void *buf,
+                                               unsigned int len),
+                                  void *priv);
+
+#endif
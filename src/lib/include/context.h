@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#ifndef _SJA1105_CONTEXT_H
+#define _SJA1105_CONTEXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "spi.h"
+
+/* Opaque handle for one SJA1105 switch. It owns the SPI setup
+ * (file descriptor, detected device ID), the gtable quirks used
+ * to talk to that switch, a reusable scratch buffer, transfer
+ * statistics and a bus mutex. Separate contexts can be used
+ * concurrently from separate threads; a single context can be
+ * shared between threads, which are then serialized on the
+ * bus mutex.
+ */
+struct sja1105_ctx;
+
+struct sja1105_ctx_stats {
+	uint64_t transfers;
+	uint64_t bytes;
+	uint64_t errors;
+};
+
+struct sja1105_ctx *sja1105_ctx_new(const struct sja1105_spi_setup *spi_setup);
+void sja1105_ctx_free(struct sja1105_ctx *ctx);
+int  sja1105_ctx_open(struct sja1105_ctx *ctx);
+struct sja1105_spi_setup *sja1105_ctx_spi_setup(struct sja1105_ctx *ctx);
+void sja1105_ctx_set_quirks(struct sja1105_ctx *ctx, int quirks);
+void sja1105_ctx_lock(struct sja1105_ctx *ctx);
+void sja1105_ctx_unlock(struct sja1105_ctx *ctx);
+void sja1105_ctx_stats_get(struct sja1105_ctx *ctx,
+                           struct sja1105_ctx_stats *stats);
+void *sja1105_ctx_buf_get(struct sja1105_ctx *ctx, size_t len);
+
+#endif
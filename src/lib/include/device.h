@@ -0,0 +1,121 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#ifndef _SJA1105_DEVICE_H
+#define _SJA1105_DEVICE_H
+
+#include <stdint.h>
+#include "static-config.h"
+#include "status.h"
+#include "regmap.h"
+#include "spi.h"
+
+#define SJA1105_NUM_PORTS 5
+#define SJA1105_NUM_TC    8
+
+/* Per-port CGU register offsets (relative to CGU_ADDR) */
+struct sja1105_cgu_regs {
+	uint64_t mii_tx_clk[SJA1105_NUM_PORTS];
+	uint64_t mii_rx_clk[SJA1105_NUM_PORTS];
+	uint64_t mii_ext_tx_clk[SJA1105_NUM_PORTS];
+	uint64_t mii_ext_rx_clk[SJA1105_NUM_PORTS];
+	uint64_t rgmii_txc[SJA1105_NUM_PORTS];
+	uint64_t rmii_ref_clk[SJA1105_NUM_PORTS];
+	uint64_t rmii_ext_tx_clk[SJA1105_NUM_PORTS];
+};
+
+/* Register offsets (relative to CORE_ADDR) that differ between
+ * the E/T and P/Q/R/S families. Registers only present on
+ * Qbv-capable parts (T and Q/S) are listed too; callers must
+ * check SUPPORTS_TSN before touching them.
+ */
+struct sja1105_core_regs {
+	uint64_t ptp_control;
+	uint64_t ptpschtm;
+	uint64_t ptppinst;
+	uint64_t ptppindur;
+	uint64_t ptpclkval;
+	uint64_t ptpclkrate;
+	uint64_t ptptsclk;
+	uint64_t ptpclkcorp;
+	uint64_t port_status_ctrl;
+	/* Dynamic reconfiguration: first word of the entry */
+	uint64_t vlan_lookup_dyn;
+	uint64_t l2_forwarding_dyn;
+};
+
+/*
+ * Everything that depends on the switch family, resolved once
+ * (see sja1105_device_ops_get) instead of testing IS_ET/IS_PQRS
+ * at every access. Adding a family means adding one instance
+ * of this structure.
+ */
+struct sja1105_device_ops {
+	const char *family;
+	/* Quickest reset that leaves the switch waiting for a new
+	 * static configuration */
+	int (*config_mode_reset)(struct sja1105_spi_setup*);
+	struct sja1105_core_regs core;
+	struct sja1105_cgu_regs  cgu;
+	/* General status registers, starting at CORE_ADDR + 1 */
+	const struct sja1105_reg *general_status;
+	/* Width of the partial PTP egress timestamps */
+	int   ptpegr_ts_bits;
+	/* Port status */
+	int   has_qlevel;
+	/* Static configuration tables with family-specific layout */
+	int   l2_lookup_entry_size;
+	void (*l2_lookup_entry_pack)(void*, struct sja1105_l2_lookup_entry*);
+	void (*l2_lookup_entry_unpack)(void*, struct sja1105_l2_lookup_entry*);
+	int   mac_config_entry_size;
+	void (*mac_config_entry_pack)(void*, struct sja1105_mac_config_entry*);
+	void (*mac_config_entry_unpack)(void*, struct sja1105_mac_config_entry*);
+	int   l2_lookup_params_entry_size;
+	void (*l2_lookup_params_entry_pack)(void*, struct sja1105_l2_lookup_params_entry*);
+	void (*l2_lookup_params_entry_unpack)(void*, struct sja1105_l2_lookup_params_entry*);
+	int   avb_params_entry_size;
+	void (*avb_params_entry_pack)(void*, struct sja1105_avb_params_entry*);
+	void (*avb_params_entry_unpack)(void*, struct sja1105_avb_params_entry*);
+	int   general_params_entry_size;
+	void (*general_params_entry_pack)(void*, struct sja1105_general_params_entry*);
+	void (*general_params_entry_unpack)(void*, struct sja1105_general_params_entry*);
+};
+
+extern const struct sja1105_device_ops sja1105et_device_ops;
+extern const struct sja1105_device_ops sja1105pqrs_device_ops;
+
+const struct sja1105_device_ops *sja1105_device_ops_get(uint64_t device_id);
+const struct sja1105_device_ops *
+sja1105_spi_setup_ops(const struct sja1105_spi_setup *spi_setup);
+
+extern const struct sja1105_reg sja1105et_general_status_reg;
+extern const struct sja1105_reg sja1105pqrs_general_status_reg;
+
+#endif
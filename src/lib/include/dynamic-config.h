@@ -68,4 +68,32 @@ int sja1105_mgmt_route_get(struct sja1105_spi_setup*, struct sja1105_mgmt_entry*
 int sja1105_mgmt_route_set(struct sja1105_spi_setup*, struct sja1105_mgmt_entry*, int index);
 void sja1105_mgmt_entry_show(struct sja1105_mgmt_entry *entry);
 
+struct sja1105_dyn_vlan_lookup_cmd {
+	uint64_t valid;
+	uint64_t rdwrset;
+	uint64_t valident;
+	struct sja1105_vlan_lookup_entry entry;
+};
+
+void sja1105_dyn_vlan_lookup_cmd_pack(void *buf, struct
+                                      sja1105_dyn_vlan_lookup_cmd *cmd);
+void sja1105_dyn_vlan_lookup_cmd_unpack(void *buf, struct
+                                        sja1105_dyn_vlan_lookup_cmd *cmd);
+int sja1105_vlan_lookup_set(struct sja1105_spi_setup*, struct sja1105_vlan_lookup_entry*);
+int sja1105_vlan_lookup_del(struct sja1105_spi_setup*, uint64_t vlanid);
+
+struct sja1105_dyn_l2_forwarding_cmd {
+	uint64_t valid;
+	uint64_t errors;
+	uint64_t rdwrset;
+	uint64_t index;
+	struct sja1105_l2_forwarding_entry entry;
+};
+
+void sja1105_dyn_l2_forwarding_cmd_pack(void *buf, struct
+                                        sja1105_dyn_l2_forwarding_cmd *cmd);
+void sja1105_dyn_l2_forwarding_cmd_unpack(void *buf, struct
+                                          sja1105_dyn_l2_forwarding_cmd *cmd);
+int sja1105_l2_forwarding_set(struct sja1105_spi_setup*, struct sja1105_l2_forwarding_entry*, int index);
+
 #endif
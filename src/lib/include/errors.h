@@ -43,6 +43,7 @@
 #define SJA1105_ERR_STAGING_AREA_INVALID                              7
 #define SJA1105_ERR_INVALID_XML                                       8
 #define SJA1105_ERR_FILESYSTEM                                        9
+#define SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK                         10
 
 const char *sja1105_err_code_to_string(int rc);
 
@@ -35,12 +35,18 @@
 #define QUIRK_LITTLE_ENDIAN    (1 << 1ull)
 #define QUIRK_LSW32_IS_FIRST   (1 << 2ull)
 
+#define ETHER_CRC32_SEED       0xFFFFFFFF
+
 int  gtable_configure(int quirks);
+int  gtable_quirks_get(void);
 int  gtable_unpack(void*, uint64_t*, int, int, int);
 int  gtable_pack(void*, uint64_t*, int, int, int);
 void gtable_hexdump(void*, int);
 void gtable_bitdump(void*, int);
 uint32_t ether_crc32_le(void*, unsigned int);
+uint32_t ether_crc32_le_update(uint32_t crc, void*, unsigned int);
+uint32_t ether_crc32_le_final(uint32_t crc);
+uint64_t sja1105_fnv1a64(const void*, unsigned int);
 uint8_t fdb_hash(uint64_t vlanid, uint64_t macaddr, uint64_t poly_koopman);
 
 #endif
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#ifndef _SJA1105_REGMAP_H
+#define _SJA1105_REGMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spi.h"
+
+/* A bit field inside a register block. The unpacked value
+ * is stored as uint64_t at byte offset "member" of the
+ * destination structure (use offsetof). */
+struct sja1105_reg_field {
+	const char *name;
+	int         word;   /* 32-bit word index inside the block */
+	int         start;
+	int         end;
+	size_t      member;
+};
+
+/* A named block of consecutive 32-bit registers. Blocks that are
+ * repeated per port are described once, with the address of
+ * instance 0 and the address increment between instances. */
+struct sja1105_reg {
+	const char *name;
+	uint64_t    addr;
+	uint64_t    stride;
+	int         words;
+	const struct sja1105_reg_field *fields;
+	int         field_count;
+};
+
+/* One block to be read: instance of reg, and where to place
+ * the packed (wire-order) bytes, reg->words * 4 of them */
+struct sja1105_reg_read {
+	const struct sja1105_reg *reg;
+	int         instance;
+	void       *buf;
+};
+
+uint64_t sja1105_reg_addr(const struct sja1105_reg *reg, int instance);
+void sja1105_reg_unpack(const struct sja1105_reg *reg, void *buf, void *dst);
+int  sja1105_regmap_read(struct sja1105_spi_setup *spi_setup,
+                         struct sja1105_reg_read *reads, int count,
+                         int max_gap_words);
+
+#endif
@@ -34,6 +34,9 @@
 #include <linux/spi/spidev.h>
 #include <stdint.h>
 
+struct sja1105_ctx;
+struct sja1105_device_ops;
+
 struct sja1105_spi_setup {
 	uint64_t    device_id;
 	uint64_t    part_nr; /* Needed for P/R distinction (same switch core) */
@@ -46,7 +49,26 @@ struct sja1105_spi_setup {
 	int         dry_run;
 	const char *staging_area;
 	int         flush;
+	int         delta_flush;
+	int         fast_reconfig;
 	int         fd;
+	/* Owning context, or NULL if the setup is used on its own */
+	struct sja1105_ctx *ctx;
+	/* Family-specific layout, bound by sja1105_spi_configure */
+	const struct sja1105_device_ops *ops;
+};
+
+/* Describes a wait for a register bit field to reach a given value.
+ * waited_us and polls are filled in by sja1105_spi_wait_field.
+ */
+struct sja1105_spi_wait {
+	uint64_t     reg_addr;
+	int          start_bit;
+	int          end_bit;
+	uint64_t     expected;
+	unsigned int timeout_us;
+	uint64_t     waited_us;
+	int          polls;
 };
 
 struct sja1105_spi_message {
@@ -65,6 +87,8 @@ int sja1105_device_id_get(struct sja1105_spi_setup *spi_setup,
                           uint64_t *device_id, uint64_t *part_nr);
 
 int sja1105_spi_transfer(const struct sja1105_spi_setup*, const void *tx, void *rx, int size);
+int sja1105_spi_batch_begin(const struct sja1105_spi_setup*);
+int sja1105_spi_batch_end(const struct sja1105_spi_setup*);
 int sja1105_spi_configure(struct sja1105_spi_setup*);
 void sja1105_spi_message_unpack(void*, struct sja1105_spi_message*);
 void sja1105_spi_message_pack(void*, struct sja1105_spi_message*);
@@ -84,9 +108,21 @@ int sja1105_spi_send_long_packed_buf(struct sja1105_spi_setup *spi_setup,
                                      uint64_t base_addr,
                                      char    *packed_buf,
                                      uint64_t size_bytes);
+struct sja1105_spi_stream;
+int sja1105_spi_send_stream(struct sja1105_spi_setup *spi_setup,
+                            uint64_t base_addr,
+                            int (*produce)(void *priv,
+                                           struct sja1105_spi_stream*),
+                            void *priv);
+int sja1105_spi_stream_write(void *stream, const void *buf, unsigned int len);
+uint64_t sja1105_time_us(void);
+int sja1105_spi_wait_field(struct sja1105_spi_setup *spi_setup,
+                           struct sja1105_spi_wait *wait);
 
 #define SIZE_SJA1105_DEVICE_ID 4
 #define SIZE_SPI_MSG_HEADER    4
 #define SIZE_SPI_MSG_MAXLEN    64 * 4
+/* The read count field of the message header is 6 bits wide */
+#define SIZE_SPI_READ_MAXLEN   63 * 4
 
 #endif
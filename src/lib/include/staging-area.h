@@ -33,9 +33,18 @@
 
 #include "static-config.h"
 
+struct sja1105_staging_area_map;
+
 struct sja1105_staging_area {
 	struct sja1105_static_config static_config;
 	/* More configuration tables? TBD */
+	/* When loaded from a file: its mapping, and which tables
+	 * have been unpacked to static_config so far */
+	struct sja1105_staging_area_map *map;
+	/* Hash of the XML file the config was loaded from (0 if it
+	 * has been modified since), and when it was last saved */
+	uint64_t xml_hash;
+	uint64_t timestamp;
 };
 
 enum sja1105_default_staging_area {
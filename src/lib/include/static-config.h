@@ -482,15 +482,20 @@ void sja1105_table_header_pack(void*, struct sja1105_table_header*);
 void sja1105_table_header_unpack(void*, struct sja1105_table_header*);
 void sja1105_table_header_pack_with_crc(void*, struct sja1105_table_header *hdr);
 void sja1105_table_header_show(struct sja1105_table_header *hdr);
+const char *sja1105_table_header_name(uint64_t block_id);
 
 /* From static-config.c */
 unsigned int sja1105_static_config_get_length(struct sja1105_static_config*);
 int  sja1105_static_config_add_entry(struct sja1105_table_header*, void *,
                                      struct sja1105_static_config*);
 int  sja1105_static_config_hexdump(void*);
+int  sja1105_static_config_verify(void *buf, unsigned int len,
+                                  int check_valid);
 int  sja1105_static_config_check_valid(struct sja1105_static_config*);
 int  sja1105_static_config_pack(void*, struct sja1105_static_config*);
 int  sja1105_static_config_unpack(void*, struct sja1105_static_config*);
+void sja1105_static_config_patch_fdb(struct sja1105_static_config*);
+void sja1105_static_config_finish_unpack(struct sja1105_static_config*);
 
 void sja1105_lib_get_build_date(char *buf);
 void sja1105_lib_get_version(char *buf);
@@ -157,6 +157,32 @@ void sja1105_port_status_show(struct sja1105_port_status*,
 int sja1105_port_status_get(struct sja1105_spi_setup*,
                             struct sja1105_port_status*,
                             int port);
+int sja1105_port_status_get_all(struct sja1105_spi_setup*,
+                                struct sja1105_port_status*);
 int sja1105_port_status_clear(struct sja1105_spi_setup*, int);
 
+enum sja1105_watchdog_fault {
+	SJA1105_WATCHDOG_OK = 0,
+	SJA1105_WATCHDOG_UNCONFIGURED, /* configs cleared */
+	SJA1105_WATCHDOG_DEVICE_ID,    /* ids set */
+	SJA1105_WATCHDOG_PARITY,       /* ramparerrl or ramparerru set */
+};
+
+struct sja1105_watchdog {
+	unsigned int min_period_us;
+	unsigned int max_period_us;
+	/* Filled in by sja1105_watchdog_poll */
+	unsigned int period_us;  /* to wait before the next poll */
+	uint64_t     last_ok_us; /* when the switch was last seen healthy */
+	uint64_t     polls;
+	struct sja1105_general_status status;
+};
+
+void sja1105_watchdog_init(struct sja1105_watchdog*,
+                           unsigned int min_period_us,
+                           unsigned int max_period_us);
+int  sja1105_watchdog_poll(struct sja1105_spi_setup*,
+                           struct sja1105_watchdog*);
+const char *sja1105_watchdog_fault_string(int fault);
+
 #endif
@@ -32,6 +32,7 @@
 #include <inttypes.h>
 /* These are our own include files */
 #include <lib/include/static-config.h>
+#include <lib/include/device.h>
 #include <lib/include/ptp.h>
 #include <lib/include/gtable.h>
 #include <lib/include/status.h>
@@ -118,11 +119,7 @@ int sja1105_ptp_cmd_commit(struct sja1105_spi_setup *spi_setup,
 	 * Relying on the caller to not access an unsupported Qbv
 	 * register on non-Qbv-capable devices.
 	 */
-	if (IS_ET(spi_setup->device_id)) {
-		ptp_control_addr = 0x17;
-	} else {
-		ptp_control_addr = 0x18;
-	}
+	ptp_control_addr = sja1105_spi_setup_ops(spi_setup)->core.ptp_control;
 	sja1105_ptp_cmd_pack(packed_buf, ptp_cmd, spi_setup->device_id);
 	return sja1105_spi_send_packed_buf(spi_setup,
 	                                   SPI_WRITE,
@@ -144,13 +141,7 @@ int sja1105_ptp_qbv_running(struct sja1105_spi_setup *spi_setup)
 		rc = -EINVAL;
 		goto out;
 	}
-	if (IS_PQRS(spi_setup->device_id)) {
-		/* Only Q/S will enter here. */
-		ptp_control_addr = 0x18;
-	} else {
-		/* Only T will enter here */
-		ptp_control_addr = 0x17;
-	}
+	ptp_control_addr = sja1105_spi_setup_ops(spi_setup)->core.ptp_control;
 	rc = sja1105_spi_send_packed_buf(spi_setup,
 	                                 SPI_READ,
 	                                 CORE_ADDR + ptp_control_addr,
@@ -271,11 +262,7 @@ int sja1105_ptp_ts_clk_get(struct sja1105_spi_setup *spi_setup,
 	uint64_t ptptsclk;
 	int rc;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptptsclk_addr = SJA1105ET_PTPTSCLK_ADDR;
-	} else {
-		ptptsclk_addr = SJA1105PQRS_PTPTSCLK_ADDR;
-	}
+	ptptsclk_addr = sja1105_spi_setup_ops(spi_setup)->core.ptptsclk;
 	rc = sja1105_ptp_read_reg(spi_setup,
 	                          ptptsclk_addr,
 	                          &ptptsclk, 8);
@@ -296,11 +283,7 @@ int sja1105_ptp_clk_get(struct sja1105_spi_setup *spi_setup,
 	uint64_t ptpclkval;
 	int rc;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptpclkval_addr = SJA1105ET_PTPCLKVAL_ADDR;
-	} else {
-		ptpclkval_addr = SJA1105PQRS_PTPCLKVAL_ADDR;
-	}
+	ptpclkval_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpclkval;
 	rc = sja1105_ptp_read_reg(spi_setup,
 	                          ptpclkval_addr,
 	                          &ptpclkval, 8);
@@ -338,11 +321,7 @@ sja1105_ptp_clk_write(struct sja1105_spi_setup *spi_setup,
 	uint64_t ptpclkval_addr;
 	uint64_t ptpclkval;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptpclkval_addr = SJA1105ET_PTPCLKVAL_ADDR;
-	} else {
-		ptpclkval_addr = SJA1105PQRS_PTPCLKVAL_ADDR;
-	}
+	ptpclkval_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpclkval;
 	sja1105_timespec_to_ptp_time(ts, &ptpclkval);
 	return sja1105_ptp_write_reg(spi_setup,
 	                             ptpclkval_addr,
@@ -423,11 +402,7 @@ int sja1105_ptp_clk_rate_set(struct sja1105_spi_setup *spi_setup,
 	uint64_t ptpclkrate_ext;
 	int rc;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptpclkrate_addr = SJA1105ET_PTPCLKRATE_ADDR;
-	} else {
-		ptpclkrate_addr = SJA1105PQRS_PTPCLKRATE_ADDR;
-	}
+	ptpclkrate_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpclkrate;
 	rc = sja1105_ptpclkrate_from_ratio(ratio, &ptpclkrate);
 	if (rc < 0) {
 		loge("%s: failed to convert ratio %lf", __func__, ratio);
@@ -446,11 +421,7 @@ int sja1105_ptp_pin_start_time_set(struct sja1105_spi_setup *spi_setup,
 	uint64_t ptppinst_addr;
 	uint64_t pinst;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptppinst_addr = SJA1105ET_PTPPINST_ADDR;
-	} else {
-		ptppinst_addr = SJA1105PQRS_PTPPINST_ADDR;
-	}
+	ptppinst_addr = sja1105_spi_setup_ops(spi_setup)->core.ptppinst;
 	sja1105_timespec_to_ptp_time(ts, &pinst);
 	return sja1105_ptp_write_reg(spi_setup,
 	                             ptppinst_addr,
@@ -465,11 +436,7 @@ int sja1105_ptp_pin_duration_set(struct sja1105_spi_setup *spi_setup,
 	uint64_t pindur;
 	int rc;
 
-	if (IS_ET(spi_setup->device_id)) {
-		ptppindur_addr = SJA1105ET_PTPPINDUR_ADDR;
-	} else {
-		ptppindur_addr = SJA1105PQRS_PTPPINDUR_ADDR;
-	}
+	ptppindur_addr = sja1105_spi_setup_ops(spi_setup)->core.ptppindur;
 	sja1105_timespec_to_ptp_time(ts, &pindur);
 	if (pindur >= UINT32_MAX) {
 		loge("%s: provided ts is too large", __func__);
@@ -496,13 +463,7 @@ int sja1105_ptp_qbv_correction_period_set(struct sja1105_spi_setup *spi_setup,
 		rc = -EINVAL;
 		goto out;
 	}
-	if (IS_ET(spi_setup->device_id)) {
-		/* Only T will enter here */
-		ptpclkcorp_addr = SJA1105T_PTPCLKCORP_ADDR;
-	} else {
-		/* Only Q/S will enter here */
-		ptpclkcorp_addr = SJA1105QS_PTPCLKCORP_ADDR;
-	}
+	ptpclkcorp_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpclkcorp;
 	sja1105_timespec_to_ptp_time(ts, &ptpclkcorp);
 	if (ptpclkcorp >= UINT32_MAX) {
 		loge("%s: provided ts is too large", __func__);
@@ -527,13 +488,7 @@ int sja1105_ptp_qbv_start_time_set(struct sja1105_spi_setup *spi_setup,
 		loge("1588 + Qbv is only supported on T and Q/S!");
 		return -EINVAL;
 	}
-	if (IS_ET(spi_setup->device_id)) {
-		/* Only T enters here */
-		ptpschtm_addr = SJA1105T_PTPSCHTM_ADDR;
-	} else {
-		/* Only Q/S enter here */
-		ptpschtm_addr = SJA1105QS_PTPSCHTM_ADDR;
-	}
+	ptpschtm_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpschtm;
 	sja1105_timespec_to_ptp_time(ts, &ptpschtm);
 	return sja1105_ptp_write_reg(spi_setup,
 	                             ptpschtm_addr,
@@ -568,14 +523,10 @@ int sja1105_ptpegr_ts_poll(struct sja1105_spi_setup *spi_setup,
 
 	if (source == TS_PTPCLK) {
 		/* Use PTPCLK */
-		ptpclk_addr = IS_ET(spi_setup->device_id) ?
-		              SJA1105ET_PTPCLKVAL_ADDR :
-		              SJA1105PQRS_PTPCLKVAL_ADDR;
+		ptpclk_addr = sja1105_spi_setup_ops(spi_setup)->core.ptpclkval;
 	} else if (source == TS_PTPTSCLK) {
 		/* Use PTPTSCLK */
-		ptpclk_addr = IS_ET(spi_setup->device_id) ?
-		              SJA1105ET_PTPTSCLK_ADDR :
-		              SJA1105PQRS_PTPTSCLK_ADDR;
+		ptpclk_addr = sja1105_spi_setup_ops(spi_setup)->core.ptptsclk;
 	} else {
 		loge("%s: invalid source selection: %d", __func__, source);
 		rc = -EINVAL;
@@ -606,11 +557,7 @@ int sja1105_ptpegr_ts_poll(struct sja1105_spi_setup *spi_setup,
 		goto out;
 	}
 	/* E/T and P/Q/R/S have different sized egress timestamps */
-	if (IS_ET(spi_setup->device_id)) {
-		ptpegr_ts_mask = (1ull << 24ull) - 1;
-	} else {
-		ptpegr_ts_mask = (1ull << 32ull) - 1;
-	}
+	ptpegr_ts_mask = (1ull << sja1105_spi_setup_ops(spi_setup)->ptpegr_ts_bits) - 1;
 	ptpegr_ts_reconstructed = (ptp_full_current_ts & ~ptpegr_ts_mask) |
 	                           ptpegr_ts_partial;
 	/* Check if wraparound occurred between moment when the partial
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+/* These are our own include files */
+#include <lib/include/context.h>
+#include <lib/include/regmap.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+#define SIZE_BURST_MAX_WORDS (SIZE_SPI_READ_MAXLEN / 4)
+
+uint64_t sja1105_reg_addr(const struct sja1105_reg *reg, int instance)
+{
+	return reg->addr + instance * reg->stride;
+}
+
+/* Unpack all described fields of a block into the structure at dst */
+void sja1105_reg_unpack(const struct sja1105_reg *reg, void *buf, void *dst)
+{
+	const struct sja1105_reg_field *field;
+	uint32_t *p = (uint32_t*) buf;
+	int i;
+
+	for (i = 0; i < reg->field_count; i++) {
+		field = &reg->fields[i];
+		gtable_unpack(p + field->word,
+		              (uint64_t*) ((char*) dst + field->member),
+		              field->start, field->end, 4);
+	}
+}
+
+static int reg_read_cmp(const void *a, const void *b)
+{
+	const struct sja1105_reg_read *ra = *(const struct sja1105_reg_read**) a;
+	const struct sja1105_reg_read *rb = *(const struct sja1105_reg_read**) b;
+	uint64_t addr_a = sja1105_reg_addr(ra->reg, ra->instance);
+	uint64_t addr_b = sja1105_reg_addr(rb->reg, rb->instance);
+
+	return (addr_a > addr_b) - (addr_a < addr_b);
+}
+
+/*
+ * Read a set of register blocks with as few SPI messages as possible.
+ * The blocks are sorted by address, and neighbours are merged into one
+ * burst as long as the hole between them is at most max_gap_words and
+ * the burst fits into SIZE_SPI_READ_MAXLEN. Only pass a nonzero
+ * max_gap_words if the registers in the holes are safe to read
+ * (no clear-on-read side effects).
+ */
+int sja1105_regmap_read(struct sja1105_spi_setup *spi_setup,
+                        struct sja1105_reg_read *reads, int count,
+                        int max_gap_words)
+{
+	struct sja1105_reg_read **sorted;
+	uint8_t  burst_buf[SIZE_SPI_READ_MAXLEN];
+	uint64_t burst_start, burst_end;
+	uint64_t addr, end;
+	int first, i, j;
+	int bursts = 0;
+	int rc = 0;
+
+	if (count == 0) {
+		return 0;
+	}
+	/* The whole plan goes out under the bus lock, so the blocks are
+	 * read in one go, and the plan lives in the context scratch
+	 * buffer. A bare spi_setup has neither. */
+	sja1105_ctx_lock(spi_setup->ctx);
+	if (spi_setup->ctx) {
+		sorted = sja1105_ctx_buf_get(spi_setup->ctx,
+		                             count * sizeof(*sorted));
+	} else {
+		sorted = malloc(count * sizeof(*sorted));
+	}
+	if (sorted == NULL) {
+		loge("failed to allocate read plan");
+		sja1105_ctx_unlock(spi_setup->ctx);
+		return -ENOMEM;
+	}
+	for (i = 0; i < count; i++) {
+		if (reads[i].reg->words > SIZE_BURST_MAX_WORDS) {
+			loge("register block %s is too large", reads[i].reg->name);
+			rc = -EINVAL;
+			goto out;
+		}
+		sorted[i] = &reads[i];
+	}
+	qsort(sorted, count, sizeof(*sorted), reg_read_cmp);
+
+	first = 0;
+	while (first < count) {
+		burst_start = sja1105_reg_addr(sorted[first]->reg,
+		                               sorted[first]->instance);
+		burst_end = burst_start + sorted[first]->reg->words;
+		/* Grow the burst while the next block is close enough */
+		for (i = first + 1; i < count; i++) {
+			addr = sja1105_reg_addr(sorted[i]->reg, sorted[i]->instance);
+			end = addr + sorted[i]->reg->words;
+			if (addr > burst_end + max_gap_words) {
+				break;
+			}
+			if (end > burst_end) {
+				if (end - burst_start > SIZE_BURST_MAX_WORDS) {
+					break;
+				}
+				burst_end = end;
+			}
+		}
+		rc = sja1105_spi_send_packed_buf(spi_setup, SPI_READ,
+		                                 burst_start, burst_buf,
+		                                 (burst_end - burst_start) * 4);
+		if (rc < 0) {
+			loge("failed to read registers 0x%" PRIx64 "-0x%" PRIx64,
+			     burst_start, burst_end - 1);
+			goto out;
+		}
+		bursts++;
+		for (j = first; j < i; j++) {
+			addr = sja1105_reg_addr(sorted[j]->reg, sorted[j]->instance);
+			memcpy(sorted[j]->buf,
+			       burst_buf + (addr - burst_start) * 4,
+			       sorted[j]->reg->words * 4);
+		}
+		first = i;
+	}
+	logv("read %d register blocks in %d bursts", count, bursts);
+out:
+	if (spi_setup->ctx == NULL) {
+		free(sorted);
+	}
+	sja1105_ctx_unlock(spi_setup->ctx);
+	return rc;
+}
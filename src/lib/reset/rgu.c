@@ -31,6 +31,7 @@
 #include <string.h>
 /* These are our own include files */
 #include <lib/include/static-config.h>
+#include <lib/include/context.h>
 #include <lib/include/gtable.h>
 #include <lib/include/spi.h>
 #include <common.h>
@@ -105,6 +106,27 @@ void sja1105_reset_cmd_show(struct sja1105_reset_cmd *reset)
 	}
 }
 
+/*
+ * The switch does not answer SPI reads while it is held in reset.
+ * Consider the reset complete once the device ID register reads back
+ * the expected value.
+ */
+static int sja1105_reset_wait_done(struct sja1105_spi_setup *spi_setup)
+{
+	struct sja1105_spi_wait device_id = {
+		.reg_addr   = CORE_ADDR + 0x00,
+		.start_bit  = 31,
+		.end_bit    = 0,
+		.expected   = spi_setup->device_id,
+		.timeout_us = 100000,
+	};
+
+	if (spi_setup->device_id == SJA1105_NO_DEVICE_ID) {
+		return 0;
+	}
+	return sja1105_spi_wait_field(spi_setup, &device_id);
+}
+
 int sja1105_reset_cmd_commit(struct sja1105_spi_setup *spi_setup,
                              struct sja1105_reset_cmd *reset)
 {
@@ -125,11 +147,16 @@ int sja1105_reset_cmd_commit(struct sja1105_spi_setup *spi_setup,
 	}
 	sja1105_reset_cmd_pack(packed_buf, reset, spi_setup->device_id);
 
+	sja1105_ctx_lock(spi_setup->ctx);
 	rc = sja1105_spi_send_packed_buf(spi_setup,
 	                                 SPI_WRITE,
 	                                 RGU_ADDR,
 	                                 packed_buf,
 	                                 BUF_LEN);
+	if (rc == 0) {
+		rc = sja1105_reset_wait_done(spi_setup);
+	}
+	sja1105_ctx_unlock(spi_setup->ctx);
 out:
 	return rc;
 }
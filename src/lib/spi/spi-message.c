@@ -35,6 +35,7 @@
 #include <lib/include/static-config.h>
 #include <lib/include/gtable.h>
 #include <lib/include/spi.h>
+#include <lib/helpers.h>
 #include <common.h>
 
 static void sja1105_spi_message_access(void  *buf,
@@ -119,6 +120,14 @@ sja1105_spi_send_packed_buf(struct sja1105_spi_setup *spi_setup,
 		goto out;
 	}
 
+	if (read_or_write == SPI_WRITE) {
+		rc = sja1105_spi_batch_add(spi_setup, tx_buf, MSG_LEN);
+		if (rc != 0) {
+			/* Queued, or failed to send the queue */
+			rc = (rc > 0) ? 0 : rc;
+			goto out;
+		}
+	}
 	rc = sja1105_spi_transfer(spi_setup, tx_buf, rx_buf, MSG_LEN);
 	if (rc < 0) {
 		loge("sja1105_spi_transfer failed");
@@ -189,13 +198,16 @@ int sja1105_spi_send_long_packed_buf(struct sja1105_spi_setup *spi_setup,
 		int      len;
 		uint64_t spi_address;
 	} chunk;
+	const int max_chunk_len = (read_or_write == SPI_READ) ?
+	                          SIZE_SPI_READ_MAXLEN :
+	                          SIZE_SPI_MSG_MAXLEN;
 	int distance_to_end;
 	int rc = 0;
 
 	/* Initialize chunk */
 	chunk.buf_ptr = packed_buf;
 	chunk.spi_address = base_addr;
-	chunk.len = min(buf_len, SIZE_SPI_MSG_MAXLEN);
+	chunk.len = min(buf_len, (uint64_t) max_chunk_len);
 
 	while (chunk.len) {
 		rc = sja1105_spi_send_packed_buf(spi_setup,
@@ -211,7 +223,7 @@ int sja1105_spi_send_long_packed_buf(struct sja1105_spi_setup *spi_setup,
 		chunk.spi_address += chunk.len / 4;
 		distance_to_end = (int) ((packed_buf + buf_len) -
 		                          chunk.buf_ptr);
-		chunk.len = min(distance_to_end, SIZE_SPI_MSG_MAXLEN);
+		chunk.len = min(distance_to_end, max_chunk_len);
 	}
 out_send_failed:
 	return rc;
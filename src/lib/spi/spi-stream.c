@@ -0,0 +1,207 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+/* These are our own libraries */
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+/*
+ * Pipelined SPI write of a buffer that is produced piecewise (e.g. a
+ * static config being packed). The producer runs in a helper thread
+ * and fills a small ring of message-sized slots, while the calling
+ * thread, which may hold the bus lock, sends the slots that are full.
+ * Packing of the next piece thus overlaps with the SPI transfer of
+ * the previous one, and the whole buffer never needs to exist at once.
+ * The SPI messages are the same as with sja1105_spi_send_long_packed_buf.
+ */
+#define SPI_STREAM_SLOTS 4
+
+struct sja1105_spi_stream {
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	char         slots[SPI_STREAM_SLOTS][SIZE_SPI_MSG_MAXLEN];
+	int          slot_len[SPI_STREAM_SLOTS];
+	/* Number of slots handed over by the producer, and sent */
+	unsigned int head;
+	unsigned int tail;
+	/* Bytes already in the slot being filled */
+	int          fill;
+	int          done;
+	/* First error, of either side */
+	int          rc;
+	int          quirks;
+	int        (*produce)(void *priv, struct sja1105_spi_stream*);
+	void        *priv;
+};
+
+/* Hand the slot being filled over to the sending side, and wait
+ * for a free one if all are in use */
+static int spi_stream_publish(struct sja1105_spi_stream *stream)
+{
+	int rc;
+
+	pthread_mutex_lock(&stream->lock);
+	stream->slot_len[stream->head % SPI_STREAM_SLOTS] = stream->fill;
+	stream->head++;
+	stream->fill = 0;
+	pthread_cond_broadcast(&stream->cond);
+	while (stream->head - stream->tail >= SPI_STREAM_SLOTS &&
+	       stream->rc == 0) {
+		pthread_cond_wait(&stream->cond, &stream->lock);
+	}
+	rc = stream->rc;
+	pthread_mutex_unlock(&stream->lock);
+	return rc;
+}
+
+/* To be called by the producer only */
+int sja1105_spi_stream_write(void *priv, const void *buf, unsigned int len)
+{
+	struct sja1105_spi_stream *stream = priv;
+	const char *p = buf;
+	unsigned int n;
+	int rc;
+
+	while (len) {
+		n = min(len, (unsigned int) (SIZE_SPI_MSG_MAXLEN - stream->fill));
+		memcpy(stream->slots[stream->head % SPI_STREAM_SLOTS] +
+		       stream->fill, p, n);
+		stream->fill += n;
+		p += n;
+		len -= n;
+		if (stream->fill == SIZE_SPI_MSG_MAXLEN) {
+			rc = spi_stream_publish(stream);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+	}
+	return 0;
+}
+
+static void *spi_stream_producer(void *priv)
+{
+	struct sja1105_spi_stream *stream = priv;
+	int rc;
+
+	/* Pack with the same quirks as the thread that sends */
+	gtable_configure(stream->quirks);
+	rc = stream->produce(stream->priv, stream);
+
+	pthread_mutex_lock(&stream->lock);
+	if (rc == 0 && stream->fill) {
+		/* The slot being filled is always a free one */
+		stream->slot_len[stream->head % SPI_STREAM_SLOTS] = stream->fill;
+		stream->head++;
+	}
+	if (rc < 0 && stream->rc == 0) {
+		stream->rc = rc;
+	}
+	stream->done = 1;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+	return NULL;
+}
+
+int sja1105_spi_send_stream(struct sja1105_spi_setup *spi_setup,
+                            uint64_t base_addr,
+                            int (*produce)(void *priv,
+                                           struct sja1105_spi_stream*),
+                            void *priv)
+{
+	struct sja1105_spi_stream *stream;
+	pthread_t producer;
+	uint64_t offset = 0;
+	char *slot;
+	int len;
+	int rc;
+
+	stream = calloc(1, sizeof(*stream));
+	if (stream == NULL) {
+		loge("calloc failed");
+		return -ENOMEM;
+	}
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->cond, NULL);
+	stream->quirks  = gtable_quirks_get();
+	stream->produce = produce;
+	stream->priv    = priv;
+
+	rc = pthread_create(&producer, NULL, spi_stream_producer, stream);
+	if (rc) {
+		loge("could not create thread: %s", strerror(rc));
+		rc = -rc;
+		goto out;
+	}
+	while (1) {
+		pthread_mutex_lock(&stream->lock);
+		while (stream->tail == stream->head && !stream->done &&
+		       stream->rc == 0) {
+			pthread_cond_wait(&stream->cond, &stream->lock);
+		}
+		if (stream->rc < 0 || stream->tail == stream->head) {
+			pthread_mutex_unlock(&stream->lock);
+			break;
+		}
+		slot = stream->slots[stream->tail % SPI_STREAM_SLOTS];
+		len  = stream->slot_len[stream->tail % SPI_STREAM_SLOTS];
+		pthread_mutex_unlock(&stream->lock);
+
+		rc = sja1105_spi_send_packed_buf(spi_setup, SPI_WRITE,
+		                                 base_addr + offset / 4,
+		                                 slot, len);
+		offset += len;
+
+		pthread_mutex_lock(&stream->lock);
+		if (rc < 0) {
+			loge("spi_send_packed_buf returned %d", rc);
+			if (stream->rc == 0) {
+				stream->rc = rc;
+			}
+		}
+		stream->tail++;
+		pthread_cond_broadcast(&stream->cond);
+		pthread_mutex_unlock(&stream->lock);
+	}
+	pthread_join(producer, NULL);
+	rc = stream->rc;
+	logv("streamed %" PRIu64 " bytes", offset);
+out:
+	pthread_cond_destroy(&stream->cond);
+	pthread_mutex_destroy(&stream->lock);
+	free(stream);
+	return rc;
+}
@@ -43,7 +43,10 @@
 /* These are our own libraries */
 #include <lib/include/static-config.h>
 #include <lib/include/gtable.h>
+#include <lib/include/context.h>
+#include <lib/include/device.h>
 #include <lib/include/spi.h>
+#include <lib/helpers.h>
 #include <common.h>
 
 const char *SJA1105E_DEVICE_ID_STR        = "SJA1105E";
@@ -212,6 +215,7 @@ int sja1105_spi_configure(struct sja1105_spi_setup *spi_setup)
 		 */
 		logv("%s: spi_setup is in dry run mode, no-op", __func__);
 		spi_setup->fd = -1;
+		spi_setup->ops = sja1105_device_ops_get(spi_setup->device_id);
 		rc = 0;
 		goto out_dry_run;
 	}
@@ -256,6 +260,8 @@ int sja1105_spi_configure(struct sja1105_spi_setup *spi_setup)
 			goto out_unknown_device_id;
 		}
 	}
+	spi_setup->ops = sja1105_device_ops_get(spi_setup->device_id);
+	logv("using %s device ops", spi_setup->ops->family);
 	goto out_ok;
 out_mismatched_read_write:
 out_unknown_device_id:
@@ -267,6 +273,57 @@ out_ok:
 	return rc;
 }
 
+/* Send the queued writes as a single message, with chip select
+ * toggled between them. Called with the bus lock held.
+ */
+static int spi_batch_flush(const struct sja1105_spi_setup *spi_setup,
+                           struct sja1105_spi_batch *batch)
+{
+	struct spi_ioc_transfer tr[SPI_BATCH_MAX_XFERS];
+	uint8_t *tx = batch->buf;
+	int i, rc;
+
+	if (batch->count == 0) {
+		return batch->rc;
+	}
+	memset(tr, 0, sizeof(tr));
+	for (i = 0; i < batch->count; i++) {
+		tr[i].tx_buf        = (unsigned long)tx;
+		tr[i].len           = batch->xfer_len[i];
+		tr[i].delay_usecs   = spi_setup->delay;
+		tr[i].speed_hz      = spi_setup->speed;
+		tr[i].bits_per_word = spi_setup->bits;
+		tr[i].cs_change     = 1;
+		tx += batch->xfer_len[i];
+	}
+	tr[batch->count - 1].cs_change = spi_setup->cs_change;
+
+	if (flock(spi_setup->fd, LOCK_EX) < 0) {
+		loge("locking spi device failed");
+		rc = -EAGAIN;
+		goto out;
+	}
+	rc = ioctl(spi_setup->fd, SPI_IOC_MESSAGE(batch->count), tr);
+	if (rc < 0) {
+		loge("ioctl failed");
+	}
+	rc = (rc == batch->len) ? 0 : -EIO;
+	if (flock(spi_setup->fd, LOCK_UN) < 0) {
+		loge("unlocking spi device failed");
+		rc = -EAGAIN;
+	}
+out:
+	for (i = 0; i < batch->count; i++) {
+		sja1105_ctx_account(spi_setup->ctx, batch->xfer_len[i], rc);
+	}
+	batch->count = 0;
+	batch->len = 0;
+	if (rc < 0 && batch->rc == 0) {
+		batch->rc = rc;
+	}
+	return batch->rc;
+}
+
 int sja1105_spi_transfer(const struct sja1105_spi_setup *spi_setup,
                          const void *tx, void *rx, int size)
 {
@@ -282,6 +339,15 @@ int sja1105_spi_transfer(const struct sja1105_spi_setup *spi_setup,
 	int saved_ioctl_result;
 	int rc = 0;
 
+	sja1105_ctx_lock(spi_setup->ctx);
+	if (spi_setup->ctx && sja1105_ctx_batch(spi_setup->ctx)->count) {
+		/* Queued writes go out ahead of this transfer */
+		rc = spi_batch_flush(spi_setup,
+		                     sja1105_ctx_batch(spi_setup->ctx));
+		if (rc < 0) {
+			goto out_batch_failed;
+		}
+	}
 	if (spi_setup->dry_run) {
 		printf("spi-transfer: size %d bytes\n", size);
 		gtable_hexdump((void*) tx, size);
@@ -311,10 +377,84 @@ out:
 	 * the number of transferred bytes instead.
 	 * https://github.com/openil/sja1105-tool/issues/8
 	 */
-	if (rc < 0) {
-		return rc;
-	} else {
-		return (saved_ioctl_result == size) ? 0 : -EIO;
+	if (rc >= 0) {
+		rc = (saved_ioctl_result == size) ? 0 : -EIO;
+	}
+	sja1105_ctx_account(spi_setup->ctx, size, rc);
+out_batch_failed:
+	sja1105_ctx_unlock(spi_setup->ctx);
+	return rc;
+}
+
+/* Start queueing the SPI writes done through spi_setup, until
+ * the matching sja1105_spi_batch_end. The bus stays locked in
+ * between. Calls may nest. Writes are only queued for an
+ * spi_setup that belongs to a context, and not in dry run mode.
+ */
+int sja1105_spi_batch_begin(const struct sja1105_spi_setup *spi_setup)
+{
+	struct sja1105_spi_batch *batch;
+
+	if (spi_setup->ctx == NULL) {
+		return 0;
 	}
+	sja1105_ctx_lock(spi_setup->ctx);
+	batch = sja1105_ctx_batch(spi_setup->ctx);
+	if (batch->depth++ == 0) {
+		batch->rc = 0;
+	}
+	return 0;
+}
+
+/* Send what is still queued. Returns the first error of any
+ * write queued since the outermost sja1105_spi_batch_begin.
+ */
+int sja1105_spi_batch_end(const struct sja1105_spi_setup *spi_setup)
+{
+	struct sja1105_spi_batch *batch;
+	int rc;
+
+	if (spi_setup->ctx == NULL) {
+		return 0;
+	}
+	batch = sja1105_ctx_batch(spi_setup->ctx);
+	rc = spi_batch_flush(spi_setup, batch);
+	batch->depth--;
+	sja1105_ctx_unlock(spi_setup->ctx);
+	return rc;
+}
+
+/* Returns 1 if the write was queued, 0 if it must be sent right
+ * away by the caller, or a negative error code from sending
+ * the writes queued before it.
+ */
+int sja1105_spi_batch_add(const struct sja1105_spi_setup *spi_setup,
+                          const void *tx, int size)
+{
+	struct sja1105_spi_batch *batch;
+	int rc = 0;
+
+	if (spi_setup->ctx == NULL || spi_setup->dry_run) {
+		return 0;
+	}
+	sja1105_ctx_lock(spi_setup->ctx);
+	batch = sja1105_ctx_batch(spi_setup->ctx);
+	if (batch->depth == 0 || size > SPI_BATCH_MAX_BYTES) {
+		goto out;
+	}
+	if (batch->count == SPI_BATCH_MAX_XFERS ||
+	    batch->len + size > SPI_BATCH_MAX_BYTES) {
+		rc = spi_batch_flush(spi_setup, batch);
+		if (rc < 0) {
+			goto out;
+		}
+	}
+	memcpy(batch->buf + batch->len, tx, size);
+	batch->xfer_len[batch->count++] = size;
+	batch->len += size;
+	rc = 1;
+out:
+	sja1105_ctx_unlock(spi_setup->ctx);
+	return rc;
 }
 
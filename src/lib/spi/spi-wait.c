@@ -0,0 +1,125 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+/* These are our own libraries */
+#include <lib/include/spi.h>
+#include <common.h>
+
+/* Number of back-to-back register reads issued before the first sleep.
+ * An SPI read already takes a few microseconds, and most busy bits
+ * clear within that time.
+ */
+#define SJA1105_WAIT_SPIN_POLLS    4
+/* Bounds of the exponential backoff between polls */
+#define SJA1105_WAIT_MIN_SLEEP_US  10
+#define SJA1105_WAIT_MAX_SLEEP_US  2000
+
+uint64_t sja1105_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/*
+ * Poll the register at wait->reg_addr until the bit field
+ * [wait->start_bit:wait->end_bit] reads back as wait->expected,
+ * or until wait->timeout_us elapses.
+ * The first few reads are issued back-to-back, after which the
+ * interval between reads doubles (bounded by SJA1105_WAIT_MAX_SLEEP_US),
+ * but never past the deadline.
+ * On return, wait->waited_us and wait->polls hold the observed
+ * completion time and the number of reads that were needed.
+ * Returns 0 on success, -ETIMEDOUT if the field did not settle, or the
+ * SPI error code.
+ */
+int sja1105_spi_wait_field(struct sja1105_spi_setup *spi_setup,
+                           struct sja1105_spi_wait *wait)
+{
+	uint64_t start, now, deadline;
+	uint64_t sleep_us = SJA1105_WAIT_MIN_SLEEP_US;
+	uint64_t reg;
+	uint64_t field;
+	int rc;
+
+	wait->waited_us = 0;
+	wait->polls = 0;
+
+	if (spi_setup->dry_run) {
+		/* There is no hardware to wait for */
+		rc = 0;
+		goto out;
+	}
+	start = sja1105_time_us();
+	deadline = start + wait->timeout_us;
+	while (1) {
+		reg = 0;
+		rc = sja1105_spi_send_int(spi_setup, SPI_READ, wait->reg_addr,
+		                          &reg, 4);
+		wait->polls++;
+		now = sja1105_time_us();
+		wait->waited_us = now - start;
+		if (rc < 0) {
+			loge("failed to read register 0x%" PRIx64, wait->reg_addr);
+			goto out;
+		}
+		field = (reg >> wait->end_bit) &
+		        ((2ull << (wait->start_bit - wait->end_bit)) - 1);
+		if (field == wait->expected) {
+			break;
+		}
+		if (now >= deadline) {
+			rc = -ETIMEDOUT;
+			goto out;
+		}
+		if (wait->polls < SJA1105_WAIT_SPIN_POLLS) {
+			continue;
+		}
+		usleep(min(sleep_us, deadline - now));
+		sleep_us = min(2 * sleep_us, SJA1105_WAIT_MAX_SLEEP_US);
+	}
+out:
+	if (rc == -ETIMEDOUT) {
+		loge("Register 0x%" PRIx64 "[%d:%d] did not reach 0x%" PRIx64
+		     " within %u us", wait->reg_addr, wait->start_bit,
+		     wait->end_bit, wait->expected, wait->timeout_us);
+	} else if (rc == 0) {
+		logv("Register 0x%" PRIx64 "[%d:%d] settled after %" PRIu64
+		     " us (%d reads)", wait->reg_addr, wait->start_bit,
+		     wait->end_bit, wait->waited_us, wait->polls);
+	}
+	return rc;
+}
@@ -0,0 +1,860 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+/* These are our own include files */
+#include <lib/include/compact-config.h>
+#include <lib/include/device.h>
+#include <lib/include/static-config.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <lib/helpers.h>
+#include <common.h>
+
+/* Adapt the typed entry accessors to the generic prototype used in
+ * struct sja1105_table_desc. The accessors of the tables whose layout
+ * depends on the family are those of the device ops. */
+#define DEFINE_COMMON_ENTRY_WRAPPERS(table)                                   \
+	static void table##_pack(const struct sja1105_device_ops *ops,        \
+	                         void *buf, void *entry)                      \
+	{                                                                     \
+		(void) ops;                                                   \
+		sja1105_##table##_entry_pack(buf, entry);                     \
+	}                                                                     \
+	static void table##_unpack(const struct sja1105_device_ops *ops,      \
+	                           void *buf, void *entry)                    \
+	{                                                                     \
+		(void) ops;                                                   \
+		sja1105_##table##_entry_unpack(buf, entry);                   \
+	}
+
+#define DEFINE_FAMILY_ENTRY_WRAPPERS(table)                                   \
+	static void table##_pack(const struct sja1105_device_ops *ops,        \
+	                         void *buf, void *entry)                      \
+	{                                                                     \
+		ops->table##_entry_pack(buf, entry);                          \
+	}                                                                     \
+	static void table##_unpack(const struct sja1105_device_ops *ops,      \
+	                           void *buf, void *entry)                    \
+	{                                                                     \
+		ops->table##_entry_unpack(buf, entry);                        \
+	}
+
+DEFINE_COMMON_ENTRY_WRAPPERS(schedule);
+DEFINE_COMMON_ENTRY_WRAPPERS(schedule_entry_points);
+DEFINE_COMMON_ENTRY_WRAPPERS(vl_lookup);
+DEFINE_COMMON_ENTRY_WRAPPERS(vl_policing);
+DEFINE_COMMON_ENTRY_WRAPPERS(vl_forwarding);
+DEFINE_FAMILY_ENTRY_WRAPPERS(l2_lookup);
+DEFINE_COMMON_ENTRY_WRAPPERS(l2_policing);
+DEFINE_COMMON_ENTRY_WRAPPERS(vlan_lookup);
+DEFINE_COMMON_ENTRY_WRAPPERS(l2_forwarding);
+DEFINE_FAMILY_ENTRY_WRAPPERS(mac_config);
+DEFINE_COMMON_ENTRY_WRAPPERS(schedule_params);
+DEFINE_COMMON_ENTRY_WRAPPERS(schedule_entry_points_params);
+DEFINE_COMMON_ENTRY_WRAPPERS(vl_forwarding_params);
+DEFINE_FAMILY_ENTRY_WRAPPERS(l2_lookup_params);
+DEFINE_COMMON_ENTRY_WRAPPERS(l2_forwarding_params);
+DEFINE_FAMILY_ENTRY_WRAPPERS(avb_params);
+DEFINE_FAMILY_ENTRY_WRAPPERS(general_params);
+DEFINE_COMMON_ENTRY_WRAPPERS(xmii_params);
+DEFINE_COMMON_ENTRY_WRAPPERS(sgmii);
+
+#define TABLE_DESC(idx, table, blk_id, max, size, ops_size)                   \
+	[idx] = {                                                             \
+		.name              = #table,                                  \
+		.block_id          = (blk_id),                                \
+		.max_count         = (max),                                   \
+		.entry_struct_size = sizeof(struct sja1105_##table##_entry),  \
+		.array_offset      = offsetof(struct sja1105_static_config,   \
+		                              table),                         \
+		.count_offset      = offsetof(struct sja1105_static_config,   \
+		                              table##_count),                 \
+		.entry_size        = (size),                                  \
+		.ops_entry_size_offset = (ops_size),                          \
+		.pack              = table##_pack,                            \
+		.unpack            = table##_unpack,                          \
+	}
+
+#define COMMON_TABLE_DESC(idx, table, blk_id, max, size)                      \
+	TABLE_DESC(idx, table, blk_id, max, size, 0)
+
+#define FAMILY_TABLE_DESC(idx, table, blk_id, max)                            \
+	TABLE_DESC(idx, table, blk_id, max, 0,                                \
+	           offsetof(struct sja1105_device_ops, table##_entry_size))
+
+static const struct sja1105_table_desc sja1105_table_descs[BLK_IDX_MAX] = {
+	COMMON_TABLE_DESC(BLK_IDX_SCHEDULE, schedule,
+	                  BLKID_SCHEDULE_TABLE,
+	                  MAX_SCHEDULE_COUNT,
+	                  SIZE_SCHEDULE_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_SCHEDULE_ENTRY_POINTS, schedule_entry_points,
+	                  BLKID_SCHEDULE_ENTRY_POINTS_TABLE,
+	                  MAX_SCHEDULE_ENTRY_POINTS_COUNT,
+	                  SIZE_SCHEDULE_ENTRY_POINTS_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_VL_LOOKUP, vl_lookup,
+	                  BLKID_VL_LOOKUP_TABLE,
+	                  MAX_VL_LOOKUP_COUNT,
+	                  SIZE_VL_LOOKUP_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_VL_POLICING, vl_policing,
+	                  BLKID_VL_POLICING_TABLE,
+	                  MAX_VL_POLICING_COUNT,
+	                  SIZE_VL_POLICING_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_VL_FORWARDING, vl_forwarding,
+	                  BLKID_VL_FORWARDING_TABLE,
+	                  MAX_VL_FORWARDING_COUNT,
+	                  SIZE_VL_FORWARDING_ENTRY),
+	FAMILY_TABLE_DESC(BLK_IDX_L2_LOOKUP, l2_lookup,
+	                  BLKID_L2_LOOKUP_TABLE,
+	                  MAX_L2_LOOKUP_COUNT),
+	COMMON_TABLE_DESC(BLK_IDX_L2_POLICING, l2_policing,
+	                  BLKID_L2_POLICING_TABLE,
+	                  MAX_L2_POLICING_COUNT,
+	                  SIZE_L2_POLICING_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_VLAN_LOOKUP, vlan_lookup,
+	                  BLKID_VLAN_LOOKUP_TABLE,
+	                  MAX_VLAN_LOOKUP_COUNT,
+	                  SIZE_VLAN_LOOKUP_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_L2_FORWARDING, l2_forwarding,
+	                  BLKID_L2_FORWARDING_TABLE,
+	                  MAX_L2_FORWARDING_COUNT,
+	                  SIZE_L2_FORWARDING_ENTRY),
+	FAMILY_TABLE_DESC(BLK_IDX_MAC_CONFIG, mac_config,
+	                  BLKID_MAC_CONFIG_TABLE,
+	                  MAX_MAC_CONFIG_COUNT),
+	COMMON_TABLE_DESC(BLK_IDX_SCHEDULE_PARAMS, schedule_params,
+	                  BLKID_SCHEDULE_PARAMS_TABLE,
+	                  MAX_SCHEDULE_PARAMS_COUNT,
+	                  SIZE_SCHEDULE_PARAMS_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_SCHEDULE_ENTRY_POINTS_PARAMS,
+	                  schedule_entry_points_params,
+	                  BLKID_SCHEDULE_ENTRY_POINTS_PARAMS_TABLE,
+	                  MAX_SCHEDULE_ENTRY_POINTS_PARAMS_COUNT,
+	                  SIZE_SCHEDULE_ENTRY_POINTS_PARAMS_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_VL_FORWARDING_PARAMS, vl_forwarding_params,
+	                  BLKID_VL_FORWARDING_PARAMS_TABLE,
+	                  MAX_VL_FORWARDING_PARAMS_COUNT,
+	                  SIZE_VL_FORWARDING_PARAMS_ENTRY),
+	FAMILY_TABLE_DESC(BLK_IDX_L2_LOOKUP_PARAMS, l2_lookup_params,
+	                  BLKID_L2_LOOKUP_PARAMS_TABLE,
+	                  MAX_L2_LOOKUP_PARAMS_COUNT),
+	COMMON_TABLE_DESC(BLK_IDX_L2_FORWARDING_PARAMS, l2_forwarding_params,
+	                  BLKID_L2_FORWARDING_PARAMS_TABLE,
+	                  MAX_L2_FORWARDING_PARAMS_COUNT,
+	                  SIZE_L2_FORWARDING_PARAMS_ENTRY),
+	FAMILY_TABLE_DESC(BLK_IDX_AVB_PARAMS, avb_params,
+	                  BLKID_AVB_PARAMS_TABLE,
+	                  MAX_AVB_PARAMS_COUNT),
+	FAMILY_TABLE_DESC(BLK_IDX_GENERAL_PARAMS, general_params,
+	                  BLKID_GENERAL_PARAMS_TABLE,
+	                  MAX_GENERAL_PARAMS_COUNT),
+	COMMON_TABLE_DESC(BLK_IDX_XMII_PARAMS, xmii_params,
+	                  BLKID_XMII_MODE_PARAMS_TABLE,
+	                  MAX_XMII_PARAMS_COUNT,
+	                  SIZE_XMII_MODE_PARAMS_ENTRY),
+	COMMON_TABLE_DESC(BLK_IDX_SGMII, sgmii,
+	                  BLKID_SGMII_TABLE,
+	                  MAX_SGMII_COUNT,
+	                  SIZE_SGMII_ENTRY),
+};
+
+const struct sja1105_table_desc *sja1105_table_desc_get(int blk_idx)
+{
+	if (blk_idx < 0 || blk_idx >= BLK_IDX_MAX) {
+		return NULL;
+	}
+	return &sja1105_table_descs[blk_idx];
+}
+
+int sja1105_blk_idx_from_id(uint64_t block_id)
+{
+	int i;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		if (sja1105_table_descs[i].block_id == block_id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Tables that may be found in a packed config but are not supported
+ * (yet): their entries are skipped over. Returns their entry size, or
+ * 0 for the other block IDs. */
+int sja1105_table_skipped_entry_size(uint64_t block_id)
+{
+	if (block_id == BLKID_CLK_SYNC_PARAMS_TABLE) {
+		logv("Clock Synchronization Parameters Table Unimplemented");
+		return SIZE_CLK_SYNC_PARAMS_ENTRY;
+	}
+	return 0;
+}
+
+int sja1105_table_entry_size(int blk_idx, uint64_t device_id)
+{
+	const struct sja1105_table_desc *desc = &sja1105_table_descs[blk_idx];
+
+	if (desc->entry_size) {
+		return desc->entry_size;
+	}
+	return *(const int*) ((const char*) sja1105_device_ops_get(device_id) +
+	                      desc->ops_entry_size_offset);
+}
+
+void sja1105_compact_config_init(struct sja1105_compact_config *compact,
+                                 uint64_t device_id)
+{
+	int i;
+
+	memset(compact, 0, sizeof(*compact));
+	compact->device_id = device_id;
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		compact->tables[i].entry_size =
+			sja1105_table_entry_size(i, device_id);
+	}
+}
+
+void sja1105_compact_config_free(struct sja1105_compact_config *compact)
+{
+	int i;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		free(compact->tables[i].entries);
+		compact->tables[i].entries = NULL;
+		compact->tables[i].count = 0;
+	}
+}
+
+/* Change the number of entries of a table. New entries are zeroed. */
+int sja1105_compact_config_resize(struct sja1105_compact_config *compact,
+                                  int blk_idx, int count)
+{
+	const struct sja1105_table_desc *desc;
+	struct sja1105_compact_table *table;
+	uint8_t *entries;
+
+	desc = sja1105_table_desc_get(blk_idx);
+	if (desc == NULL || count < 0 || count > desc->max_count) {
+		loge("invalid entry count %d for table %d", count, blk_idx);
+		return -EINVAL;
+	}
+	table = &compact->tables[blk_idx];
+	if (count == 0) {
+		free(table->entries);
+		table->entries = NULL;
+		table->count = 0;
+		return 0;
+	}
+	entries = realloc(table->entries, count * table->entry_size);
+	if (entries == NULL) {
+		loge("realloc failed");
+		return -ENOMEM;
+	}
+	if (count > table->count) {
+		memset(entries + table->count * table->entry_size, 0,
+		       (count - table->count) * table->entry_size);
+	}
+	table->entries = entries;
+	table->count = count;
+	return 0;
+}
+
+int sja1105_compact_config_get_entry(const struct sja1105_compact_config *compact,
+                                     int blk_idx, int index, void *entry)
+{
+	const struct sja1105_compact_table *table;
+	const struct sja1105_table_desc *desc;
+
+	desc = sja1105_table_desc_get(blk_idx);
+	if (desc == NULL) {
+		return -EINVAL;
+	}
+	table = &compact->tables[blk_idx];
+	if (index < 0 || index >= table->count) {
+		return -ERANGE;
+	}
+	desc->unpack(sja1105_device_ops_get(compact->device_id),
+	             table->entries + index * table->entry_size, entry);
+	return 0;
+}
+
+int sja1105_compact_config_set_entry(struct sja1105_compact_config *compact,
+                                     int blk_idx, int index, void *entry)
+{
+	const struct sja1105_table_desc *desc;
+	struct sja1105_compact_table *table;
+
+	desc = sja1105_table_desc_get(blk_idx);
+	if (desc == NULL) {
+		return -EINVAL;
+	}
+	table = &compact->tables[blk_idx];
+	if (index < 0 || index >= table->count) {
+		return -ERANGE;
+	}
+	desc->pack(sja1105_device_ops_get(compact->device_id),
+	           table->entries + index * table->entry_size, entry);
+	return 0;
+}
+
+size_t sja1105_compact_config_mem_size(const struct sja1105_compact_config *compact)
+{
+	size_t size = sizeof(*compact);
+	int i;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		size += compact->tables[i].count * compact->tables[i].entry_size;
+	}
+	return size;
+}
+
+/*
+ * Entries are packed and unpacked in ranges of at most RANGE_ENTRIES,
+ * which are independent of each other and can be handled by different
+ * threads (see sja1105_parallel_run). Configs smaller than
+ * PARALLEL_MIN_ENTRIES are not worth the thread startup.
+ */
+#define RANGE_ENTRIES        256
+#define PARALLEL_MIN_ENTRIES 1024
+
+struct entry_range {
+	int blk_idx;
+	int start;
+	int end;
+};
+
+struct entry_ranges {
+	struct entry_range *ranges;
+	int      count;
+	const struct sja1105_device_ops *ops;
+	/* Packed entries, per table */
+	uint8_t *entries[BLK_IDX_MAX];
+	int      entry_size[BLK_IDX_MAX];
+	struct sja1105_static_config *config;
+};
+
+/* Split tables first_blk_idx to last_blk_idx of compact into ranges */
+static int
+entry_ranges_build(struct entry_ranges *work,
+                   const struct sja1105_compact_config *compact,
+                   struct sja1105_static_config *config,
+                   int first_blk_idx, int last_blk_idx)
+{
+	const struct sja1105_compact_table *table;
+	int i, j, n = 0;
+
+	memset(work, 0, sizeof(*work));
+	work->ops = sja1105_device_ops_get(compact->device_id);
+	work->config = config;
+	for (i = first_blk_idx; i <= last_blk_idx; i++) {
+		table = &compact->tables[i];
+		n += (table->count + RANGE_ENTRIES - 1) / RANGE_ENTRIES;
+		work->entries[i] = table->entries;
+		work->entry_size[i] = table->entry_size;
+	}
+	if (n == 0) {
+		/* Empty tables: no ranges, entry_ranges_run has no jobs */
+		return 0;
+	}
+	work->ranges = malloc(n * sizeof(*work->ranges));
+	if (work->ranges == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	for (i = first_blk_idx; i <= last_blk_idx; i++) {
+		table = &compact->tables[i];
+		for (j = 0; j < table->count; j += RANGE_ENTRIES) {
+			work->ranges[work->count].blk_idx = i;
+			work->ranges[work->count].start = j;
+			work->ranges[work->count].end =
+				min(j + RANGE_ENTRIES, table->count);
+			work->count++;
+		}
+	}
+	return 0;
+}
+
+static int entry_range_pack(void *priv, int job)
+{
+	struct entry_ranges *work = priv;
+	struct entry_range *range = &work->ranges[job];
+	const struct sja1105_table_desc *desc = &sja1105_table_descs[range->blk_idx];
+	char *array = (char*) work->config + desc->array_offset;
+	int j;
+
+	for (j = range->start; j < range->end; j++) {
+		desc->pack(work->ops, work->entries[range->blk_idx] +
+		           j * work->entry_size[range->blk_idx],
+		           array + j * desc->entry_struct_size);
+	}
+	return 0;
+}
+
+static int entry_range_unpack(void *priv, int job)
+{
+	struct entry_ranges *work = priv;
+	struct entry_range *range = &work->ranges[job];
+	const struct sja1105_table_desc *desc = &sja1105_table_descs[range->blk_idx];
+	char *array = (char*) work->config + desc->array_offset;
+	int j;
+
+	for (j = range->start; j < range->end; j++) {
+		desc->unpack(work->ops, work->entries[range->blk_idx] +
+		             j * work->entry_size[range->blk_idx],
+		             array + j * desc->entry_struct_size);
+	}
+	return 0;
+}
+
+static int
+entry_ranges_run(struct entry_ranges *work, int (*fn)(void *priv, int job))
+{
+	int total = 0;
+	int rc = 0;
+	int i;
+
+	for (i = 0; i < work->count; i++) {
+		total += work->ranges[i].end - work->ranges[i].start;
+	}
+	if (total >= PARALLEL_MIN_ENTRIES) {
+		rc = sja1105_parallel_run(work->count, fn, work);
+	} else {
+		for (i = 0; i < work->count; i++) {
+			fn(work, i);
+		}
+	}
+	free(work->ranges);
+	return rc;
+}
+
+/* Unpack count packed entries of a table, found at data, into the
+ * legacy structure (its count is not updated). */
+int sja1105_table_entries_unpack(struct sja1105_static_config *config,
+                                 int blk_idx, void *data, int count)
+{
+	struct sja1105_compact_config view;
+	struct entry_ranges work;
+	int rc;
+
+	if (sja1105_table_desc_get(blk_idx) == NULL) {
+		return -EINVAL;
+	}
+	/* Only borrows data, and is never freed */
+	sja1105_compact_config_init(&view, config->device_id);
+	view.tables[blk_idx].count = count;
+	view.tables[blk_idx].entries = data;
+	rc = entry_ranges_build(&work, &view, config, blk_idx, blk_idx);
+	if (rc < 0) {
+		return rc;
+	}
+	return entry_ranges_run(&work, entry_range_unpack);
+}
+
+/* Replace one table of compact with the entries of the same
+ * table in the legacy structure */
+int sja1105_compact_table_from_static(struct sja1105_compact_config *compact,
+                                      struct sja1105_static_config *config,
+                                      int blk_idx)
+{
+	const struct sja1105_table_desc *desc;
+	struct entry_ranges work;
+	int count;
+	int rc;
+
+	desc = sja1105_table_desc_get(blk_idx);
+	if (desc == NULL) {
+		return -EINVAL;
+	}
+	count = *(int*) ((char*) config + desc->count_offset);
+
+	rc = sja1105_compact_config_resize(compact, blk_idx, count);
+	if (rc < 0) {
+		return rc;
+	}
+	rc = entry_ranges_build(&work, compact, config, blk_idx, blk_idx);
+	if (rc < 0) {
+		return rc;
+	}
+	return entry_ranges_run(&work, entry_range_pack);
+}
+
+/* compact must not hold any tables (freshly initialized or freed).
+ * config is not const because the static FDB entries get their
+ * index assigned here, the same way sja1105_static_config_pack does.
+ */
+int sja1105_compact_config_from_static(struct sja1105_compact_config *compact,
+                                       struct sja1105_static_config *config)
+{
+	struct entry_ranges work;
+	int i;
+	int rc;
+
+	if (!DEVICE_ID_VALID(config->device_id)) {
+		loge("Cannot convert config with invalid Device ID 0x%08"
+		     PRIx64, config->device_id);
+		return -EINVAL;
+	}
+	sja1105_compact_config_init(compact, config->device_id);
+
+	sja1105_static_config_patch_fdb(config);
+
+	/* Size all tables first, so that their entries can then be
+	 * packed by range, all tables at once */
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		rc = sja1105_compact_config_resize(compact, i,
+		         *(int*) ((char*) config +
+		                  sja1105_table_descs[i].count_offset));
+		if (rc < 0) {
+			goto error;
+		}
+	}
+	rc = entry_ranges_build(&work, compact, config, 0, BLK_IDX_MAX - 1);
+	if (rc < 0) {
+		goto error;
+	}
+	rc = entry_ranges_run(&work, entry_range_pack);
+	if (rc < 0) {
+		goto error;
+	}
+	return 0;
+error:
+	sja1105_compact_config_free(compact);
+	return rc;
+}
+
+/* The legacy structure has room for every table at its hardware
+ * maximum, so this costs the same regardless of the config size */
+int sja1105_compact_config_to_static(struct sja1105_static_config *config,
+                                     const struct sja1105_compact_config *compact)
+{
+	const struct sja1105_compact_table *table;
+	const struct sja1105_table_desc *desc;
+	struct entry_ranges work;
+	int i, rc;
+
+	memset(config, 0, sizeof(*config));
+	config->device_id = compact->device_id;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		desc  = &sja1105_table_descs[i];
+		table = &compact->tables[i];
+
+		if (table->count > desc->max_count) {
+			loge("There can be no more than %d %s entries "
+			     "(%d present)", desc->max_count, desc->name,
+			     table->count);
+			return -ERANGE;
+		}
+		*(int*) ((char*) config + desc->count_offset) = table->count;
+	}
+	rc = entry_ranges_build(&work, compact, config, 0, BLK_IDX_MAX - 1);
+	if (rc < 0) {
+		return rc;
+	}
+	rc = entry_ranges_run(&work, entry_range_unpack);
+	if (rc < 0) {
+		return rc;
+	}
+	sja1105_static_config_finish_unpack(config);
+	return 0;
+}
+
+unsigned int
+sja1105_compact_config_get_length(const struct sja1105_compact_config *compact)
+{
+	unsigned int sum = SIZE_SJA1105_DEVICE_ID;
+	int i;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		if (compact->tables[i].count == 0) {
+			continue;
+		}
+		/* Header, its CRC included, plus data and data CRC */
+		sum += SIZE_TABLE_HEADER + 4;
+		sum += compact->tables[i].count * compact->tables[i].entry_size;
+	}
+	/* Ending header, which has no data CRC */
+	sum += SIZE_TABLE_HEADER;
+	return sum;
+}
+
+struct table_pack_work {
+	const struct sja1105_compact_config *compact;
+	int   blk_idx[BLK_IDX_MAX];
+	/* Where the header of each table goes */
+	char *dest[BLK_IDX_MAX];
+};
+
+/* Header, data and data CRC of one table */
+static int table_pack(void *priv, int job)
+{
+	struct table_pack_work *work = priv;
+	const struct sja1105_compact_table *table;
+	struct sja1105_table_header header = {0};
+	int blk_idx = work->blk_idx[job];
+	char *p = work->dest[job];
+	uint64_t crc;
+	int len;
+
+	table = &work->compact->tables[blk_idx];
+	len = table->count * table->entry_size;
+	header.block_id = sja1105_table_descs[blk_idx].block_id;
+	header.len = len / 4;
+	sja1105_table_header_pack_with_crc(p, &header);
+	p += SIZE_TABLE_HEADER;
+	memcpy(p, table->entries, len);
+	crc = ether_crc32_le(p, len);
+	p += len;
+	gtable_pack(p, &crc, 31, 0, 4);
+	return 0;
+}
+
+/* Produces the same bytes as sja1105_static_config_pack.
+ * The position of every table is known in advance, so tables
+ * are packed (and their CRCs computed) in parallel. */
+int sja1105_compact_config_pack(void *buf,
+                                const struct sja1105_compact_config *compact)
+{
+	struct table_pack_work work = {.compact = compact};
+	struct sja1105_table_header header = {0};
+	char *p = buf;
+	int jobs = 0;
+	int i;
+
+	if (!DEVICE_ID_VALID(compact->device_id)) {
+		loge("Cannot pack invalid Device ID 0x%08"
+		     PRIx64 "!", compact->device_id);
+		return -EINVAL;
+	}
+	gtable_pack(p, (uint64_t*) &compact->device_id, 31, 0, 4);
+	p += SIZE_SJA1105_DEVICE_ID;
+
+	for (i = 0; i < BLK_IDX_MAX; i++) {
+		if (compact->tables[i].count == 0) {
+			continue;
+		}
+		work.blk_idx[jobs] = i;
+		work.dest[jobs] = p;
+		jobs++;
+		p += SIZE_TABLE_HEADER + 4 +
+		     compact->tables[i].count * compact->tables[i].entry_size;
+	}
+	if (p - (char*) buf >= PARALLEL_MIN_ENTRIES * 16) {
+		sja1105_parallel_run(jobs, table_pack, &work);
+	} else {
+		for (i = 0; i < jobs; i++) {
+			table_pack(&work, i);
+		}
+	}
+	/* Final header */
+	header.block_id = 0;      /* Does not matter */
+	header.len = 0;           /* Marks that header is final */
+	header.crc = 0xDEADBEEF;  /* Will be replaced on-the-fly on "config upload" */
+	sja1105_table_header_pack(p, &header);
+	return 0;
+}
+
+struct config_stream {
+	int   (*write)(void *priv, const void *buf, unsigned int len);
+	void   *priv;
+	/* CRC of everything written so far, for the final header */
+	uint32_t crc;
+};
+
+static int config_stream_put(struct config_stream *s, void *buf,
+                             unsigned int len)
+{
+	s->crc = ether_crc32_le_update(s->crc, buf, len);
+	return s->write(s->priv, buf, len);
+}
+
+/* Streaming form of sja1105_compact_config_pack, for a config that is
+ * not held in compact form. Tables are packed one at a time and handed
+ * to write() as they are produced, the final header CRC included (it
+ * is computed along the way, not in a second pass over the data).
+ * Only one table is held in packed form at any time.
+ */
+int sja1105_static_config_stream(struct sja1105_static_config *config,
+                                 int (*write)(void *priv, const void *buf,
+                                              unsigned int len),
+                                 void *priv)
+{
+	struct config_stream s = {
+		.write = write,
+		.priv  = priv,
+		.crc   = ETHER_CRC32_SEED,
+	};
+	struct sja1105_compact_config scratch;
+	struct sja1105_compact_table *table;
+	struct sja1105_table_header header = {0};
+	char   hdr_buf[SIZE_TABLE_HEADER];
+	char   word[4];
+	uint64_t crc;
+	int len;
+	int rc;
+	int i;
+
+	if (!DEVICE_ID_VALID(config->device_id)) {
+		loge("Cannot pack invalid Device ID 0x%08"
+		     PRIx64 "!", config->device_id);
+		return -EINVAL;
+	}
+	sja1105_compact_config_init(&scratch, config->device_id);
+	sja1105_static_config_patch_fdb(config);
+
+	gtable_pack(word, &config->device_id, 31, 0, 4);
+	rc = config_stream_put(&s, word, SIZE_SJA1105_DEVICE_ID);
+	for (i = 0; i < BLK_IDX_MAX && rc == 0; i++) {
+		rc = sja1105_compact_table_from_static(&scratch, config, i);
+		if (rc < 0) {
+			break;
+		}
+		table = &scratch.tables[i];
+		if (table->count == 0) {
+			continue;
+		}
+		len = table->count * table->entry_size;
+		header.block_id = sja1105_table_descs[i].block_id;
+		header.len = len / 4;
+		sja1105_table_header_pack_with_crc(hdr_buf, &header);
+		rc = config_stream_put(&s, hdr_buf, SIZE_TABLE_HEADER);
+		if (rc < 0) {
+			break;
+		}
+		crc = ether_crc32_le(table->entries, len);
+		rc = config_stream_put(&s, table->entries, len);
+		if (rc < 0) {
+			break;
+		}
+		gtable_pack(word, &crc, 31, 0, 4);
+		rc = config_stream_put(&s, word, 4);
+		sja1105_compact_config_resize(&scratch, i, 0);
+	}
+	sja1105_compact_config_free(&scratch);
+	if (rc < 0) {
+		return rc;
+	}
+	/* Final header, with the CRC of everything before its CRC field */
+	header.block_id = 0;
+	header.len = 0;
+	header.crc = 0;
+	sja1105_table_header_pack(hdr_buf, &header);
+	s.crc = ether_crc32_le_update(s.crc, hdr_buf, SIZE_TABLE_HEADER - 4);
+	header.crc = ether_crc32_le_final(s.crc);
+	sja1105_table_header_pack(hdr_buf, &header);
+	return s.write(s.priv, hdr_buf, SIZE_TABLE_HEADER);
+}
+
+/* Tables are copied in their packed form, nothing gets unpacked */
+int sja1105_compact_config_unpack(void *buf, unsigned int len,
+                                  struct sja1105_compact_config *compact)
+{
+	struct sja1105_table_header hdr;
+	struct sja1105_compact_table *table;
+	uint64_t device_id;
+	uint64_t read_crc;
+	uint64_t computed_crc;
+	char *p = buf;
+	char *end = p + len;
+	int blk_idx;
+	int count;
+	int rc;
+
+	if (len < SIZE_SJA1105_DEVICE_ID + SIZE_TABLE_HEADER) {
+		loge("Static config is too short (%u bytes)", len);
+		return -EINVAL;
+	}
+	gtable_unpack(p, &device_id, 31, 0, 4);
+	if (DEVICE_ID_VALID(device_id) == 0) {
+		loge("Invalid device id in staging area: 0x%08" PRIx64,
+		     device_id);
+		return -EINVAL;
+	}
+	sja1105_compact_config_init(compact, device_id);
+	p += SIZE_SJA1105_DEVICE_ID;
+
+	while (p + SIZE_TABLE_HEADER <= end) {
+		sja1105_table_header_unpack(p, &hdr);
+		/* This should match on last table header */
+		if (hdr.len == 0) {
+			return 0;
+		}
+		computed_crc = ether_crc32_le(p, SIZE_TABLE_HEADER - 4);
+		if ((hdr.crc & 0xFFFFFFFF) != computed_crc) {
+			loge("Table header CRC is invalid, exiting.");
+			goto error;
+		}
+		p += SIZE_TABLE_HEADER;
+		if (p + hdr.len * 4 + 4 > end) {
+			loge("Table data runs past the end of the config");
+			goto error;
+		}
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx < 0) {
+			if (sja1105_table_skipped_entry_size(hdr.block_id) == 0) {
+				loge("Unknown Table %" PRIX64, hdr.block_id);
+				goto error;
+			}
+			p += hdr.len * 4 + 4;
+			continue;
+		}
+		table = &compact->tables[blk_idx];
+		if ((hdr.len * 4) % table->entry_size) {
+			loge("Incorrect table length for %s",
+			     sja1105_table_descs[blk_idx].name);
+			goto error;
+		}
+		computed_crc = ether_crc32_le(p, hdr.len * 4);
+		gtable_unpack(p + hdr.len * 4, &read_crc, 31, 0, 4);
+		if (computed_crc != read_crc) {
+			loge("Data CRC is invalid, exiting.");
+			goto error;
+		}
+		count = table->count;
+		rc = sja1105_compact_config_resize(compact, blk_idx,
+		         count + hdr.len * 4 / table->entry_size);
+		if (rc < 0) {
+			goto out_free;
+		}
+		memcpy(table->entries + count * table->entry_size, p,
+		       hdr.len * 4);
+		p += hdr.len * 4 + 4;
+	}
+	loge("Static config has no final header");
+error:
+	rc = -EINVAL;
+out_free:
+	sja1105_compact_config_free(compact);
+	return rc;
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/* These are our own include files */
+#include <lib/include/compact-config.h>
+#include <lib/include/gtable.h>
+#include <lib/helpers.h>
+#include <common.h>
+
+/*
+ * Work that splits into independent jobs (e.g. packing ranges of table
+ * entries) can be spread over a few threads. The number of threads is
+ * process-wide, like the gtable quirks, and defaults to 1, which runs
+ * every job in the calling thread.
+ */
+#define MAX_THREADS 16
+
+static int g_threads = 1;
+
+/* 0 means one thread per online CPU */
+int sja1105_parallel_configure(int threads)
+{
+	if (threads < 0) {
+		return -EINVAL;
+	}
+	if (threads == 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	g_threads = (threads < 1) ? 1 : min(threads, MAX_THREADS);
+	return 0;
+}
+
+int sja1105_parallel_threads(void)
+{
+	return g_threads;
+}
+
+struct parallel_work {
+	int   jobs;
+	int   next;
+	int   rc;
+	int   quirks;
+	int (*fn)(void *priv, int job);
+	void *priv;
+};
+
+static void *parallel_worker(void *priv)
+{
+	struct parallel_work *work = priv;
+	int job;
+	int rc;
+
+	gtable_configure(work->quirks);
+	while ((job = __sync_fetch_and_add(&work->next, 1)) < work->jobs) {
+		rc = work->fn(work->priv, job);
+		if (rc < 0) {
+			__sync_bool_compare_and_swap(&work->rc, 0, rc);
+		}
+	}
+	return NULL;
+}
+
+/* Runs fn for every job from 0 to jobs - 1, in no particular order.
+ * Returns the first error reported by fn, if any. */
+int sja1105_parallel_run(int jobs, int (*fn)(void *priv, int job),
+                         void *priv)
+{
+	struct parallel_work work = {
+		.jobs   = jobs,
+		.fn     = fn,
+		.priv   = priv,
+		.quirks = gtable_quirks_get(),
+	};
+	pthread_t threads[MAX_THREADS];
+	int count = min(g_threads, jobs) - 1;
+	int i;
+
+	/* The calling thread is one of the workers. If threads cannot
+	 * be created, it simply takes on more of the jobs. */
+	for (i = 0; i < count; i++) {
+		if (pthread_create(&threads[i], NULL, parallel_worker, &work)) {
+			break;
+		}
+	}
+	count = i;
+	parallel_worker(&work);
+	for (i = 0; i < count; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	return work.rc;
+}
@@ -30,9 +30,12 @@
  *****************************************************************************/
 #include <inttypes.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 /* These are our own include files */
 #include <lib/include/static-config.h>
+#include <lib/include/compact-config.h>
+#include <lib/include/device.h>
 #include <lib/include/gtable.h>
 #include <common.h>
 #include <stddef.h>
@@ -68,6 +71,18 @@ static void sja1105_table_write_crc(char *table_start, char *crc_ptr)
 	config->table##_count = count;                                        \
 }
 
+/* Same as above, for the tables whose layout differs between E/T and
+ * P/Q/R/S. The unpack function comes from the device ops. */
+#define POPULATE_FAMILY_CONFIG_TABLE(table, buf, max_entry_count, table_name) \
+{                                                                             \
+	int count = config->table##_count;                                    \
+	struct sja1105_##table##_entry entry;                                 \
+	CHECK_COUNT(count, (max_entry_count), (table_name));                  \
+	ops->table##_entry_unpack(buf, &entry);                               \
+	config->table[count++] = entry;                                       \
+	config->table##_count = count;                                        \
+}
+
 /* Input: struct sja1105_table_header *hdr
  *        void *buf
  *        config->device_id
@@ -80,6 +95,9 @@ static void sja1105_table_write_crc(char *table_start, char *crc_ptr)
 int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
                                     struct sja1105_static_config *config)
 {
+	const struct sja1105_device_ops *ops;
+
+	ops = sja1105_device_ops_get(config->device_id);
 
 	switch (hdr->block_id) {
 	case BLKID_SCHEDULE_TABLE:
@@ -109,13 +127,8 @@ int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
 	}
 	case BLKID_L2_LOOKUP_TABLE:
 	{
-		if (IS_ET(config->device_id)) {
-			POPULATE_CONFIG_TABLE(et, l2_lookup, buf, MAX_L2_LOOKUP_COUNT, "L2 Lookup");
-			return SIZE_L2_LOOKUP_ENTRY_ET;
-		} else {
-			POPULATE_CONFIG_TABLE(pqrs, l2_lookup, buf, MAX_L2_LOOKUP_COUNT, "L2 Lookup");
-			return SIZE_L2_LOOKUP_ENTRY_PQRS;
-		}
+		POPULATE_FAMILY_CONFIG_TABLE(l2_lookup, buf, MAX_L2_LOOKUP_COUNT, "L2 Lookup");
+		return ops->l2_lookup_entry_size;
 	}
 	case BLKID_L2_POLICING_TABLE:
 	{
@@ -134,13 +147,8 @@ int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
 	}
 	case BLKID_MAC_CONFIG_TABLE:
 	{
-		if (IS_ET(config->device_id)) {
-			POPULATE_CONFIG_TABLE(et, mac_config, buf, MAX_MAC_CONFIG_COUNT, "Mac Configuration");
-			return SIZE_MAC_CONFIG_ENTRY_ET;
-		} else {
-			POPULATE_CONFIG_TABLE(pqrs, mac_config, buf, MAX_MAC_CONFIG_COUNT, "Mac Configuration");
-			return SIZE_MAC_CONFIG_ENTRY_PQRS;
-		}
+		POPULATE_FAMILY_CONFIG_TABLE(mac_config, buf, MAX_MAC_CONFIG_COUNT, "Mac Configuration");
+		return ops->mac_config_entry_size;
 	}
 	case BLKID_SCHEDULE_PARAMS_TABLE:
 	{
@@ -159,13 +167,8 @@ int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
 	}
 	case BLKID_L2_LOOKUP_PARAMS_TABLE:
 	{
-		if (IS_ET(config->device_id)) {
-			POPULATE_CONFIG_TABLE(et, l2_lookup_params, buf, MAX_L2_LOOKUP_PARAMS_COUNT, "L2 Lookup Parameters");
-			return SIZE_L2_LOOKUP_PARAMS_ENTRY_ET;
-		} else {
-			POPULATE_CONFIG_TABLE(pqrs, l2_lookup_params, buf, MAX_L2_LOOKUP_PARAMS_COUNT, "L2 Lookup Parameters");
-			return SIZE_L2_LOOKUP_PARAMS_ENTRY_PQRS;
-		}
+		POPULATE_FAMILY_CONFIG_TABLE(l2_lookup_params, buf, MAX_L2_LOOKUP_PARAMS_COUNT, "L2 Lookup Parameters");
+		return ops->l2_lookup_params_entry_size;
 	}
 	case BLKID_L2_FORWARDING_PARAMS_TABLE:
 	{
@@ -179,31 +182,13 @@ int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
 	}
 	case BLKID_AVB_PARAMS_TABLE:
 	{
-		struct sja1105_avb_params_entry entry;
-		CHECK_COUNT(config->avb_params_count, MAX_AVB_PARAMS_COUNT, "AVB Parameters");
-		if (IS_ET(config->device_id)) {
-			sja1105et_avb_params_entry_unpack(buf, &entry);
-			config->avb_params[config->avb_params_count++] = entry;
-			return SIZE_AVB_PARAMS_ENTRY_ET;
-		} else {
-			sja1105pqrs_avb_params_entry_unpack(buf, &entry);
-			config->avb_params[config->avb_params_count++] = entry;
-			return SIZE_AVB_PARAMS_ENTRY_PQRS;
-		}
+		POPULATE_FAMILY_CONFIG_TABLE(avb_params, buf, MAX_AVB_PARAMS_COUNT, "AVB Parameters");
+		return ops->avb_params_entry_size;
 	}
 	case BLKID_GENERAL_PARAMS_TABLE:
 	{
-		struct sja1105_general_params_entry entry;
-		CHECK_COUNT(config->general_params_count, MAX_GENERAL_PARAMS_COUNT, "General Parameters");
-		if (IS_ET(config->device_id)) {
-			sja1105et_general_params_entry_unpack(buf, &entry);
-			config->general_params[config->general_params_count++] = entry;
-			return SIZE_GENERAL_PARAMS_ENTRY_ET;
-		} else {
-			sja1105pqrs_general_params_entry_unpack(buf, &entry);
-			config->general_params[config->general_params_count++] = entry;
-			return SIZE_GENERAL_PARAMS_ENTRY_PQRS;
-		}
+		POPULATE_FAMILY_CONFIG_TABLE(general_params, buf, MAX_GENERAL_PARAMS_COUNT, "General Parameters");
+		return ops->general_params_entry_size;
 	}
 	case BLKID_XMII_MODE_PARAMS_TABLE:
 	{
@@ -226,18 +211,20 @@ int sja1105_static_config_add_entry(struct sja1105_table_header *hdr, void *buf,
  * (length of static config) */
 int sja1105_static_config_hexdump(void *buf)
 {
+	const struct sja1105_table_desc *desc;
 	struct sja1105_table_header hdr;
-	struct sja1105_static_config config;
+	int counts[BLK_IDX_MAX] = {0};
+	uint64_t device_id;
 	char *p = buf;
 	char *table_end;
+	int blk_idx;
 	int bytes;
 
-	memset(&config, 0, sizeof(config));
 	/* Retrieve device_id from first 4 bytes of packed buffer */
-	gtable_unpack(p, &config.device_id, 31, 0, 4);
+	gtable_unpack(p, &device_id, 31, 0, 4);
 	printf("Device ID is 0x%08" PRIx64 " (%s)\n",
-	       config.device_id, sja1105_device_id_string_get(
-	       config.device_id, SJA1105_PART_NR_DONT_CARE));
+	       device_id, sja1105_device_id_string_get(
+	       device_id, SJA1105_PART_NR_DONT_CARE));
 	p += SIZE_SJA1105_DEVICE_ID;
 
 	while (1) {
@@ -251,12 +238,25 @@ int sja1105_static_config_hexdump(void *buf)
 		gtable_hexdump(p, SIZE_TABLE_HEADER);
 		p += SIZE_TABLE_HEADER;
 
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx >= 0) {
+			/* Only the entry size is needed here, not the entries */
+			desc  = sja1105_table_desc_get(blk_idx);
+			bytes = sja1105_table_entry_size(blk_idx, device_id);
+		} else {
+			desc  = NULL;
+			bytes = sja1105_table_skipped_entry_size(hdr.block_id);
+		}
+		if (bytes == 0) {
+			printf("Unknown Table %" PRIX64 "\n", hdr.block_id);
+			goto error;
+		}
 		table_end = p + hdr.len * 4;
 		while (p < table_end) {
-			bytes = sja1105_static_config_add_entry(&hdr, p,
-			                                        &config);
-			if (bytes < 0) {
-				goto error;
+			if (desc) {
+				CHECK_COUNT(counts[blk_idx] + 1, desc->max_count,
+				            desc->name);
+				counts[blk_idx]++;
 			}
 			printf("Entry (%d bytes):\n", bytes);
 			gtable_hexdump(p, bytes);
@@ -278,6 +278,151 @@ error:
 	return -1;
 }
 
+/* Entries of the tables that sja1105_static_config_check_valid
+ * looks into, besides the table counts */
+static int
+verify_unpack_for_check(struct sja1105_static_config *config, int blk_idx,
+                        void *data, int count)
+{
+	switch (blk_idx) {
+	case BLK_IDX_L2_FORWARDING_PARAMS:
+	case BLK_IDX_VL_FORWARDING_PARAMS:
+		return sja1105_table_entries_unpack(config, blk_idx, data, count);
+	}
+	return 0;
+}
+
+/*
+ * Check a packed static config without unpacking it: every table
+ * header must be followed by a known block ID, a whole number of
+ * entries within the table limits, and matching header and data CRCs.
+ * With check_valid, sja1105_static_config_check_valid is run as well,
+ * on the table counts and the few entries it looks into.
+ * Returns the length of the config (up to and including the final
+ * header), or a negative value if it is invalid.
+ */
+int sja1105_static_config_verify(void *buf, unsigned int len, int check_valid)
+{
+	const struct sja1105_table_desc *desc;
+	struct sja1105_static_config *config = NULL;
+	struct sja1105_table_header hdr;
+	int counts[BLK_IDX_MAX] = {0};
+	uint64_t computed_crc;
+	uint64_t read_crc;
+	uint64_t device_id;
+	char *p = buf;
+	char *end = p + len;
+	int entry_size;
+	int blk_idx;
+	int final = 0;
+	int rc = -EINVAL;
+
+	if (len < SIZE_SJA1105_DEVICE_ID + SIZE_TABLE_HEADER) {
+		loge("Static config is too short (%u bytes)", len);
+		return -EINVAL;
+	}
+	gtable_unpack(p, &device_id, 31, 0, 4);
+	if (DEVICE_ID_VALID(device_id) == 0) {
+		loge("Invalid device id 0x%08" PRIx64, device_id);
+		return -EINVAL;
+	}
+	p += SIZE_SJA1105_DEVICE_ID;
+	if (check_valid) {
+		/* Only the pages actually written to are touched */
+		config = calloc(1, sizeof(*config));
+		if (config == NULL) {
+			loge("calloc failed");
+			return -ENOMEM;
+		}
+		config->device_id = device_id;
+	}
+	while (p + SIZE_TABLE_HEADER <= end) {
+		sja1105_table_header_unpack(p, &hdr);
+		if (hdr.len == 0) {
+			p += SIZE_TABLE_HEADER;
+			final = 1;
+			break;
+		}
+		computed_crc = ether_crc32_le(p, SIZE_TABLE_HEADER - 4);
+		if ((hdr.crc & 0xFFFFFFFF) != computed_crc) {
+			loge("Table header CRC is invalid");
+			goto out;
+		}
+		p += SIZE_TABLE_HEADER;
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx < 0) {
+			entry_size = sja1105_table_skipped_entry_size(hdr.block_id);
+			if (entry_size == 0) {
+				loge("Unknown Table %" PRIX64, hdr.block_id);
+				goto out;
+			}
+			if (p + hdr.len * 4 + 4 > end ||
+			    (hdr.len * 4) % entry_size) {
+				loge("Incorrect length for table %" PRIX64,
+				     hdr.block_id);
+				goto out;
+			}
+			computed_crc = ether_crc32_le(p, hdr.len * 4);
+			gtable_unpack(p + hdr.len * 4, &read_crc, 31, 0, 4);
+			if (computed_crc != read_crc) {
+				loge("Data CRC is invalid for table %" PRIX64,
+				     hdr.block_id);
+				goto out;
+			}
+			p += hdr.len * 4 + 4;
+			continue;
+		}
+		desc = sja1105_table_desc_get(blk_idx);
+		if (p + hdr.len * 4 + 4 > end) {
+			loge("%s runs past the end of the config", desc->name);
+			goto out;
+		}
+		entry_size = sja1105_table_entry_size(blk_idx, device_id);
+		if ((hdr.len * 4) % entry_size) {
+			loge("Incorrect table length for %s", desc->name);
+			goto out;
+		}
+		counts[blk_idx] += hdr.len * 4 / entry_size;
+		if (counts[blk_idx] > desc->max_count) {
+			loge("There can be no more than %d %s entries "
+			     "(%d present)", desc->max_count, desc->name,
+			     counts[blk_idx]);
+			goto out;
+		}
+		computed_crc = ether_crc32_le(p, hdr.len * 4);
+		gtable_unpack(p + hdr.len * 4, &read_crc, 31, 0, 4);
+		if (computed_crc != read_crc) {
+			loge("Data CRC is invalid for %s", desc->name);
+			goto out;
+		}
+		if (config) {
+			rc = verify_unpack_for_check(config, blk_idx, p,
+			                             hdr.len * 4 / entry_size);
+			if (rc < 0) {
+				goto out;
+			}
+			*(int*) ((char*) config + desc->count_offset) =
+				counts[blk_idx];
+			rc = -EINVAL;
+		}
+		p += hdr.len * 4 + 4;
+	}
+	if (!final) {
+		loge("Static config has no final header");
+		goto out;
+	}
+	if (config) {
+		rc = sja1105_static_config_check_valid(config);
+		if (rc < 0) {
+			goto out;
+		}
+	}
+	rc = (ptrdiff_t) (p - (char*) buf);
+out:
+	free(config);
+	return rc;
+}
+
 static void
 sja1105_static_config_patch_vllupformat(struct sja1105_static_config *config)
 {
@@ -384,6 +529,10 @@ void sja1105_static_config_patch_fdb(struct sja1105_static_config *config)
 {
 	int i;
 
+	/* Start from empty bins, so that packing the same config
+	 * twice places every entry at the same index */
+	memset(config->entries_in_fdb_bin, 0,
+	       sizeof(config->entries_in_fdb_bin));
 	for (i = 0; i < config->l2_lookup_count; i++) {
 		struct  sja1105_l2_lookup_entry *entry;
 		uint8_t index_in_bin;
@@ -412,6 +561,22 @@ void sja1105_static_config_patch_fdb(struct sja1105_static_config *config)
 	}
 }
 
+/* Derive the state that is not stored in the packed tables
+ * themselves, once all entries have been unpacked */
+void sja1105_static_config_finish_unpack(struct sja1105_static_config *config)
+{
+	int i;
+
+	sja1105_static_config_patch_vllupformat(config);
+	for (i = 0; i < config->l2_lookup_count; i++) {
+		struct sja1105_l2_lookup_entry *entry;
+		uint8_t bin;
+		entry = &config->l2_lookup[i];
+		bin = entry->index / SJA1105ET_FDB_BIN_SIZE;
+		config->entries_in_fdb_bin[bin]++;
+	}
+}
+
 int
 sja1105_static_config_unpack(void *buf, struct sja1105_static_config *config)
 {
@@ -421,7 +586,6 @@ sja1105_static_config_unpack(void *buf, struct sja1105_static_config *config)
 	int bytes;
 	uint64_t read_crc;
 	uint64_t computed_crc;
-	int i;
 
 	memset(config, 0, sizeof(*config));
 	/* Retrieve device_id from first 4 bytes of packed buffer */
@@ -483,14 +647,7 @@ sja1105_static_config_unpack(void *buf, struct sja1105_static_config *config)
 			goto error;
 		}
 	}
-	sja1105_static_config_patch_vllupformat(config);
-	for (i = 0; i < config->l2_lookup_count; i++) {
-		struct sja1105_l2_lookup_entry *entry;
-		uint8_t bin;
-		entry = &config->l2_lookup[i];
-		bin = entry->index / SJA1105ET_FDB_BIN_SIZE;
-		config->entries_in_fdb_bin[bin]++;
-	}
+	sja1105_static_config_finish_unpack(config);
 	return 0;
 error:
 	return -1;
@@ -515,6 +672,7 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 		p += 4;                                                      \
 	}
 
+	const struct sja1105_device_ops *ops;
 	struct sja1105_table_header header = {0};
 	char  *p = buf;
 	char  *table_start;
@@ -525,6 +683,7 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 		     PRIx64 "!", config->device_id);
 		return -EINVAL;
 	}
+	ops = sja1105_device_ops_get(config->device_id);
 
 	gtable_pack(p, &config->device_id, 31, 0, 4);
 	p += SIZE_SJA1105_DEVICE_ID;
@@ -556,19 +715,11 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 	                     BLKID_VL_FORWARDING_TABLE,
 	                     sja1105_vl_forwarding_entry_pack,
 	                     config->vl_forwarding);
-	if (IS_ET(config->device_id)) {
-		PACK_TABLE_IN_BUF_FN(config->l2_lookup_count,
-		                     SIZE_L2_LOOKUP_ENTRY_ET,
-		                     BLKID_L2_LOOKUP_TABLE,
-		                     sja1105et_l2_lookup_entry_pack,
-		                     config->l2_lookup);
-	} else {
-		PACK_TABLE_IN_BUF_FN(config->l2_lookup_count,
-		                     SIZE_L2_LOOKUP_ENTRY_PQRS,
-		                     BLKID_L2_LOOKUP_TABLE,
-		                     sja1105pqrs_l2_lookup_entry_pack,
-		                     config->l2_lookup);
-	}
+	PACK_TABLE_IN_BUF_FN(config->l2_lookup_count,
+	                     ops->l2_lookup_entry_size,
+	                     BLKID_L2_LOOKUP_TABLE,
+	                     ops->l2_lookup_entry_pack,
+	                     config->l2_lookup);
 	PACK_TABLE_IN_BUF_FN(config->l2_policing_count,
 	                     SIZE_L2_POLICING_ENTRY,
 	                     BLKID_L2_POLICING_TABLE,
@@ -584,19 +735,11 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 	                     BLKID_L2_FORWARDING_TABLE,
 	                     sja1105_l2_forwarding_entry_pack,
 	                     config->l2_forwarding);
-	if (IS_ET(config->device_id)) {
-		PACK_TABLE_IN_BUF_FN(config->mac_config_count,
-		                     SIZE_MAC_CONFIG_ENTRY_ET,
-		                     BLKID_MAC_CONFIG_TABLE,
-		                     sja1105et_mac_config_entry_pack,
-		                     config->mac_config);
-	} else {
-		PACK_TABLE_IN_BUF_FN(config->mac_config_count,
-		                     SIZE_MAC_CONFIG_ENTRY_PQRS,
-		                     BLKID_MAC_CONFIG_TABLE,
-		                     sja1105pqrs_mac_config_entry_pack,
-		                     config->mac_config);
-	}
+	PACK_TABLE_IN_BUF_FN(config->mac_config_count,
+	                     ops->mac_config_entry_size,
+	                     BLKID_MAC_CONFIG_TABLE,
+	                     ops->mac_config_entry_pack,
+	                     config->mac_config);
 	PACK_TABLE_IN_BUF_FN(config->schedule_params_count,
 	                     SIZE_SCHEDULE_PARAMS_ENTRY,
 	                     BLKID_SCHEDULE_PARAMS_TABLE,
@@ -612,50 +755,26 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 	                     BLKID_VL_FORWARDING_PARAMS_TABLE,
 	                     sja1105_vl_forwarding_params_entry_pack,
 	                     config->vl_forwarding_params);
-	if (IS_ET(config->device_id)) {
-		PACK_TABLE_IN_BUF_FN(config->l2_lookup_params_count,
-		                     SIZE_L2_LOOKUP_PARAMS_ENTRY_ET,
-		                     BLKID_L2_LOOKUP_PARAMS_TABLE,
-		                     sja1105et_l2_lookup_params_entry_pack,
-		                     config->l2_lookup_params);
-	} else {
-		PACK_TABLE_IN_BUF_FN(config->l2_lookup_params_count,
-		                     SIZE_L2_LOOKUP_PARAMS_ENTRY_PQRS,
-		                     BLKID_L2_LOOKUP_PARAMS_TABLE,
-		                     sja1105pqrs_l2_lookup_params_entry_pack,
-		                     config->l2_lookup_params);
-	}
+	PACK_TABLE_IN_BUF_FN(config->l2_lookup_params_count,
+	                     ops->l2_lookup_params_entry_size,
+	                     BLKID_L2_LOOKUP_PARAMS_TABLE,
+	                     ops->l2_lookup_params_entry_pack,
+	                     config->l2_lookup_params);
 	PACK_TABLE_IN_BUF_FN(config->l2_forwarding_params_count,
 	                     SIZE_L2_FORWARDING_PARAMS_ENTRY,
 	                     BLKID_L2_FORWARDING_PARAMS_TABLE,
 	                     sja1105_l2_forwarding_params_entry_pack,
 	                     config->l2_forwarding_params);
-	if (IS_ET(config->device_id)) {
-		PACK_TABLE_IN_BUF_FN(config->avb_params_count,
-		                     SIZE_AVB_PARAMS_ENTRY_ET,
-		                     BLKID_AVB_PARAMS_TABLE,
-		                     sja1105et_avb_params_entry_pack,
-		                     config->avb_params);
-	} else {
-		PACK_TABLE_IN_BUF_FN(config->avb_params_count,
-		                     SIZE_AVB_PARAMS_ENTRY_PQRS,
-		                     BLKID_AVB_PARAMS_TABLE,
-		                     sja1105pqrs_avb_params_entry_pack,
-		                     config->avb_params);
-	}
-	if (IS_ET(config->device_id)) {
-		PACK_TABLE_IN_BUF_FN(config->general_params_count,
-		                     SIZE_GENERAL_PARAMS_ENTRY_ET,
-		                     BLKID_GENERAL_PARAMS_TABLE,
-		                     sja1105et_general_params_entry_pack,
-		                     config->general_params);
-	} else {
-		PACK_TABLE_IN_BUF_FN(config->general_params_count,
-		                     SIZE_GENERAL_PARAMS_ENTRY_PQRS,
-		                     BLKID_GENERAL_PARAMS_TABLE,
-		                     sja1105pqrs_general_params_entry_pack,
-		                     config->general_params);
-	}
+	PACK_TABLE_IN_BUF_FN(config->avb_params_count,
+	                     ops->avb_params_entry_size,
+	                     BLKID_AVB_PARAMS_TABLE,
+	                     ops->avb_params_entry_pack,
+	                     config->avb_params);
+	PACK_TABLE_IN_BUF_FN(config->general_params_count,
+	                     ops->general_params_entry_size,
+	                     BLKID_GENERAL_PARAMS_TABLE,
+	                     ops->general_params_entry_pack,
+	                     config->general_params);
 	PACK_TABLE_IN_BUF_FN(config->xmii_params_count,
 	                     SIZE_XMII_MODE_PARAMS_ENTRY,
 	                     BLKID_XMII_MODE_PARAMS_TABLE,
@@ -677,9 +796,12 @@ sja1105_static_config_pack(void *buf, struct sja1105_static_config *config)
 unsigned int
 sja1105_static_config_get_length(struct sja1105_static_config *config)
 {
+	const struct sja1105_device_ops *ops;
 	unsigned int sum = 0;
 	unsigned int header_count = 0;
 
+	ops = sja1105_device_ops_get(config->device_id);
+
 	/* Table headers */
 	header_count += (config->schedule_count != 0);
 	header_count += (config->schedule_entry_points_count != 0);
@@ -708,18 +830,18 @@ sja1105_static_config_get_length(struct sja1105_static_config *config)
 	sum += config->vl_lookup_count * SIZE_VL_LOOKUP_ENTRY;
 	sum += config->vl_policing_count * SIZE_VL_POLICING_ENTRY;
 	sum += config->vl_forwarding_count * SIZE_VL_FORWARDING_ENTRY;
-	sum += config->l2_lookup_count * (IS_PQRS(config->device_id) ? SIZE_L2_LOOKUP_ENTRY_PQRS : SIZE_L2_LOOKUP_ENTRY_ET);
+	sum += config->l2_lookup_count * ops->l2_lookup_entry_size;
 	sum += config->l2_policing_count * SIZE_L2_POLICING_ENTRY;
 	sum += config->vlan_lookup_count * SIZE_VLAN_LOOKUP_ENTRY;
 	sum += config->l2_forwarding_count * SIZE_L2_FORWARDING_ENTRY;
-	sum += config->mac_config_count * (IS_PQRS(config->device_id) ? SIZE_MAC_CONFIG_ENTRY_PQRS : SIZE_MAC_CONFIG_ENTRY_ET);
+	sum += config->mac_config_count * ops->mac_config_entry_size;
 	sum += config->schedule_params_count * SIZE_SCHEDULE_PARAMS_ENTRY;
 	sum += config->schedule_entry_points_params_count * SIZE_SCHEDULE_ENTRY_POINTS_PARAMS_ENTRY;
 	sum += config->vl_forwarding_params_count * SIZE_VL_FORWARDING_PARAMS_ENTRY;
-	sum += config->l2_lookup_params_count * (IS_PQRS(config->device_id) ? SIZE_L2_LOOKUP_PARAMS_ENTRY_PQRS : SIZE_L2_LOOKUP_PARAMS_ENTRY_ET);
+	sum += config->l2_lookup_params_count * ops->l2_lookup_params_entry_size;
 	sum += config->l2_forwarding_params_count * SIZE_L2_FORWARDING_PARAMS_ENTRY;
-	sum += config->avb_params_count * (IS_PQRS(config->device_id) ? SIZE_AVB_PARAMS_ENTRY_PQRS : SIZE_AVB_PARAMS_ENTRY_ET);
-	sum += config->general_params_count * (IS_PQRS(config->device_id) ? SIZE_GENERAL_PARAMS_ENTRY_PQRS : SIZE_GENERAL_PARAMS_ENTRY_ET);
+	sum += config->avb_params_count * ops->avb_params_entry_size;
+	sum += config->general_params_count * ops->general_params_entry_size;
 	sum += config->xmii_params_count * SIZE_XMII_MODE_PARAMS_ENTRY;
 	sum += config->sgmii_count * SIZE_SGMII_ENTRY;
 	sum -= 4; /* Last header does not have an extra CRC because there is no data */
@@ -84,71 +84,62 @@ void sja1105_table_header_pack_with_crc(
 	gtable_pack(buf + SIZE_TABLE_HEADER - 4, &hdr->crc, 31, 0, 4);
 }
 
-void sja1105_table_header_show(struct sja1105_table_header *hdr)
+const char *sja1105_table_header_name(uint64_t block_id)
 {
-	switch (hdr->block_id) {
+	switch (block_id) {
 		case BLKID_SCHEDULE_TABLE:
-			printf("Schedule Table");
-			break;
+			return "Schedule Table";
 		case BLKID_SCHEDULE_ENTRY_POINTS_TABLE:
-			printf("Schedule Entry Points Table");
-			break;
+			return "Schedule Entry Points Table";
 		case BLKID_VL_LOOKUP_TABLE:
-			printf("VL Lookup Table");
-			break;
+			return "VL Lookup Table";
 		case BLKID_VL_POLICING_TABLE:
-			printf("VL Policing Table");
-			break;
+			return "VL Policing Table";
 		case BLKID_VL_FORWARDING_TABLE:
-			printf("VL Forwarding Table");
-			break;
+			return "VL Forwarding Table";
 		case BLKID_L2_LOOKUP_TABLE:
-			printf("L2 Lookup Table");
-			break;
+			return "L2 Lookup Table";
 		case BLKID_L2_POLICING_TABLE:
-			printf("L2 Policing Table");
-			break;
+			return "L2 Policing Table";
 		case BLKID_VLAN_LOOKUP_TABLE:
-			printf("VLAN Lookup Table");
-			break;
+			return "VLAN Lookup Table";
 		case BLKID_L2_FORWARDING_TABLE:
-			printf("L2 Forwarding Table");
-			break;
+			return "L2 Forwarding Table";
 		case BLKID_MAC_CONFIG_TABLE:
-			printf("MAC Configuration Table");
-			break;
+			return "MAC Configuration Table";
 		case BLKID_SCHEDULE_PARAMS_TABLE:
-			printf("Schedule Parameters Table");
-			break;
+			return "Schedule Parameters Table";
 		case BLKID_SCHEDULE_ENTRY_POINTS_PARAMS_TABLE:
-			printf("Schedule Entry Points Parameters Table");
-			break;
+			return "Schedule Entry Points Parameters Table";
 		case BLKID_VL_FORWARDING_PARAMS_TABLE:
-			printf("VL Forwarding Parameters Table");
-			break;
+			return "VL Forwarding Parameters Table";
 		case BLKID_L2_LOOKUP_PARAMS_TABLE:
-			printf("L2 Lookup Parameters Table");
-			break;
+			return "L2 Lookup Parameters Table";
 		case BLKID_L2_FORWARDING_PARAMS_TABLE:
-			printf("L2 Forwarding Parameters Table");
-			break;
+			return "L2 Forwarding Parameters Table";
 		case BLKID_CLK_SYNC_PARAMS_TABLE:
-			printf("Clock Synchronization Parameters Table");
-			break;
+			return "Clock Synchronization Parameters Table";
 		case BLKID_AVB_PARAMS_TABLE:
-			printf("AVB Parameters Table");
-			break;
+			return "AVB Parameters Table";
 		case BLKID_GENERAL_PARAMS_TABLE:
-			printf("General Parameters Table");
-			break;
+			return "General Parameters Table";
 		case BLKID_XMII_MODE_PARAMS_TABLE:
-			printf("xMII Mode Parameters Table");
-			break;
+			return "xMII Mode Parameters Table";
 		case BLKID_SGMII_TABLE:
-			printf("SGMII Table");
-			break;
+			return "SGMII Table";
 		default:
-			printf("Unknown Table %" PRIX64 " ", hdr->block_id);
+			return NULL;
+	}
+}
+
+void sja1105_table_header_show(struct sja1105_table_header *hdr)
+{
+	const char *name = sja1105_table_header_name(hdr->block_id);
+
+	if (name) {
+		printf("%s", name);
+	} else {
+		printf("Unknown Table %" PRIX64 " ", hdr->block_id);
 	}
 	printf(", length %" PRIu64 " bytes (%" PRIu64 " x 32-bit words), CRC %" PRIX64 "\n",
 	       hdr->len * 4, hdr->len, hdr->crc);
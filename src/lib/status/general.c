@@ -36,70 +36,82 @@
 #include <unistd.h>
 /* These are our include files */
 #include <lib/include/static-config.h>
+#include <lib/include/device.h>
 #include <lib/include/status.h>
-#include <lib/include/gtable.h>
+#include <lib/include/regmap.h>
 #include <lib/include/spi.h>
 #include <common.h>
 
-static void
-sja1105_general_status_unpack(void *buf, struct sja1105_general_status *status,
-                              uint64_t device_id)
-{
-	/* So that addition translates to 4 bytes */
-	uint32_t *p = (uint32_t*) buf;
-	memset(status, 0, sizeof(*status));
-	/* device_id is missing from the buffer, but we don't
-	 * want to diverge from the manual definition of the
-	 * register addresses, so we'll back off one step with
-	 * the register pointer, and never access p[0].
-	 */
-	p--;
-	gtable_unpack(p + 0x1, &status->configs,   31, 31, 4);
-	gtable_unpack(p + 0x1, &status->crcchkl,   30, 30, 4);
-	gtable_unpack(p + 0x1, &status->ids,       29, 29, 4);
-	gtable_unpack(p + 0x1, &status->crcchkg,   28, 28, 4);
-	gtable_unpack(p + 0x1, &status->nslot,      3,  0, 4);
-	gtable_unpack(p + 0x2, &status->vlind,     31, 16, 4);
-	gtable_unpack(p + 0x2, &status->vlparind,  15,  8, 4);
-	gtable_unpack(p + 0x2, &status->vlroutes,   1,  1, 4);
-	gtable_unpack(p + 0x2, &status->vlparts,    0,  0, 4);
-	gtable_unpack(p + 0x3, &status->macaddl,   31, 16, 4);
-	gtable_unpack(p + 0x3, &status->portenf,   15,  8, 4);
-	gtable_unpack(p + 0x3, &status->fwds_03h,   4,  4, 4);
-	gtable_unpack(p + 0x3, &status->macfds,     3,  3, 4);
-	gtable_unpack(p + 0x3, &status->enffds,     2,  2, 4);
-	gtable_unpack(p + 0x3, &status->l2busyfds,  1,  1, 4);
-	gtable_unpack(p + 0x3, &status->l2busys,    0,  0, 4);
-	gtable_unpack(p + 0x4, &status->macaddu,   31,  0, 4);
-	gtable_unpack(p + 0x5, &status->macaddhcl, 31, 16, 4);
-	gtable_unpack(p + 0x5, &status->vlanidhc,  15,  4, 4);
-	gtable_unpack(p + 0x5, &status->hashconfs,  0,  0, 4);
-	gtable_unpack(p + 0x6, &status->macaddhcu, 31,  0, 4);
-	gtable_unpack(p + 0x7, &status->wpvlanid,  31, 16, 4);
-	gtable_unpack(p + 0x7, &status->port_07h,  15,  8, 4);
-	gtable_unpack(p + 0x7, &status->vlanbusys,  4,  4, 4);
-	gtable_unpack(p + 0x7, &status->wrongports, 3,  3, 4);
-	gtable_unpack(p + 0x7, &status->vnotfounds, 2,  2, 4);
-	gtable_unpack(p + 0x8, &status->vlid,      31, 16, 4);
-	gtable_unpack(p + 0x8, &status->portvl,    15,  8, 4);
-	gtable_unpack(p + 0x8, &status->vlnotfound, 0,  0, 4);
-	gtable_unpack(p + 0x9, &status->emptys,    31, 31, 4);
-	gtable_unpack(p + 0x9, &status->buffers,   30,  0, 4);
-	if (IS_ET(device_id)) {
-		gtable_unpack(p + 0xA, &status->port_0ah,  15,  8, 4);
-		gtable_unpack(p + 0xA, &status->fwds_0ah,   1,  1, 4);
-		gtable_unpack(p + 0xA, &status->parts,      0,  0, 4);
-		gtable_unpack(p + 0xB, &status->ramparerrl,20,  0, 4);
-		gtable_unpack(p + 0xC, &status->ramparerru, 4,  0, 4);
-	} else {
-		gtable_unpack(p + 0xA, &status->buflwmark, 30,  0, 4);
-		gtable_unpack(p + 0xB, &status->port_0ah,  15,  8, 4);
-		gtable_unpack(p + 0xB, &status->fwds_0ah,   1,  1, 4);
-		gtable_unpack(p + 0xB, &status->parts,      0,  0, 4);
-		gtable_unpack(p + 0xC, &status->ramparerrl,22,  0, 4);
-		gtable_unpack(p + 0xD, &status->ramparerru, 4,  0, 4);
-	}
-}
+/* Fields of the general status registers. reg is the register
+ * number from the manual: the block is read starting at 0x01,
+ * device_id (0x00) is skipped. */
+#define GENERAL_STATUS_FIELD(field, reg, start, end) \
+	{#field, (reg) - 0x1, start, end, \
+	 offsetof(struct sja1105_general_status, field)}
+
+/* Registers 0x01 to 0x09, common to E/T and P/Q/R/S */
+#define GENERAL_STATUS_COMMON_FIELDS \
+	GENERAL_STATUS_FIELD(configs,    0x1, 31, 31), \
+	GENERAL_STATUS_FIELD(crcchkl,    0x1, 30, 30), \
+	GENERAL_STATUS_FIELD(ids,        0x1, 29, 29), \
+	GENERAL_STATUS_FIELD(crcchkg,    0x1, 28, 28), \
+	GENERAL_STATUS_FIELD(nslot,      0x1,  3,  0), \
+	GENERAL_STATUS_FIELD(vlind,      0x2, 31, 16), \
+	GENERAL_STATUS_FIELD(vlparind,   0x2, 15,  8), \
+	GENERAL_STATUS_FIELD(vlroutes,   0x2,  1,  1), \
+	GENERAL_STATUS_FIELD(vlparts,    0x2,  0,  0), \
+	GENERAL_STATUS_FIELD(macaddl,    0x3, 31, 16), \
+	GENERAL_STATUS_FIELD(portenf,    0x3, 15,  8), \
+	GENERAL_STATUS_FIELD(fwds_03h,   0x3,  4,  4), \
+	GENERAL_STATUS_FIELD(macfds,     0x3,  3,  3), \
+	GENERAL_STATUS_FIELD(enffds,     0x3,  2,  2), \
+	GENERAL_STATUS_FIELD(l2busyfds,  0x3,  1,  1), \
+	GENERAL_STATUS_FIELD(l2busys,    0x3,  0,  0), \
+	GENERAL_STATUS_FIELD(macaddu,    0x4, 31,  0), \
+	GENERAL_STATUS_FIELD(macaddhcl,  0x5, 31, 16), \
+	GENERAL_STATUS_FIELD(vlanidhc,   0x5, 15,  4), \
+	GENERAL_STATUS_FIELD(hashconfs,  0x5,  0,  0), \
+	GENERAL_STATUS_FIELD(macaddhcu,  0x6, 31,  0), \
+	GENERAL_STATUS_FIELD(wpvlanid,   0x7, 31, 16), \
+	GENERAL_STATUS_FIELD(port_07h,   0x7, 15,  8), \
+	GENERAL_STATUS_FIELD(vlanbusys,  0x7,  4,  4), \
+	GENERAL_STATUS_FIELD(wrongports, 0x7,  3,  3), \
+	GENERAL_STATUS_FIELD(vnotfounds, 0x7,  2,  2), \
+	GENERAL_STATUS_FIELD(vlid,       0x8, 31, 16), \
+	GENERAL_STATUS_FIELD(portvl,     0x8, 15,  8), \
+	GENERAL_STATUS_FIELD(vlnotfound, 0x8,  0,  0), \
+	GENERAL_STATUS_FIELD(emptys,     0x9, 31, 31), \
+	GENERAL_STATUS_FIELD(buffers,    0x9, 30,  0)
+
+static const struct sja1105_reg_field sja1105et_general_status_fields[] = {
+	GENERAL_STATUS_COMMON_FIELDS,
+	GENERAL_STATUS_FIELD(port_0ah,   0xA, 15,  8),
+	GENERAL_STATUS_FIELD(fwds_0ah,   0xA,  1,  1),
+	GENERAL_STATUS_FIELD(parts,      0xA,  0,  0),
+	GENERAL_STATUS_FIELD(ramparerrl, 0xB, 20,  0),
+	GENERAL_STATUS_FIELD(ramparerru, 0xC,  4,  0),
+};
+
+static const struct sja1105_reg_field sja1105pqrs_general_status_fields[] = {
+	GENERAL_STATUS_COMMON_FIELDS,
+	GENERAL_STATUS_FIELD(buflwmark,  0xA, 30,  0),
+	GENERAL_STATUS_FIELD(port_0ah,   0xB, 15,  8),
+	GENERAL_STATUS_FIELD(fwds_0ah,   0xB,  1,  1),
+	GENERAL_STATUS_FIELD(parts,      0xB,  0,  0),
+	GENERAL_STATUS_FIELD(ramparerrl, 0xC, 22,  0),
+	GENERAL_STATUS_FIELD(ramparerru, 0xD,  4,  0),
+};
+
+/* 0x01 to 0x0C */
+const struct sja1105_reg sja1105et_general_status_reg =
+	{"general", CORE_ADDR + 0x01, 0, 0x0C,
+	 sja1105et_general_status_fields,
+	 ARRAY_SIZE(sja1105et_general_status_fields)};
+/* 0x01 to 0x0D */
+const struct sja1105_reg sja1105pqrs_general_status_reg =
+	{"general", CORE_ADDR + 0x01, 0, 0x0D,
+	 sja1105pqrs_general_status_fields,
+	 ARRAY_SIZE(sja1105pqrs_general_status_fields)};
 
 void sja1105_general_status_show(struct sja1105_general_status *status,
                                  uint64_t device_id)
@@ -148,26 +160,19 @@ void sja1105_general_status_show(struct sja1105_general_status *status,
 int sja1105_general_status_get(struct sja1105_spi_setup *spi_setup,
                                struct sja1105_general_status *status)
 {
-	const int SIZE_GENERAL_STATUS = IS_ET(spi_setup->device_id) ?
-	                                0x0C * 4 : /* 0x01 to 0x0C */
-	                                0x0D * 4;  /* 0x01 to 0x0D */
-	uint8_t packed_buf[SIZE_GENERAL_STATUS];
+	const struct sja1105_device_ops *ops = sja1105_spi_setup_ops(spi_setup);
+	const struct sja1105_reg *reg = ops->general_status;
+	uint8_t packed_buf[reg->words * 4];
+	struct sja1105_reg_read read = {reg, 0, packed_buf};
 	int rc;
 
-	/* The base address is off-by-1 compared to UM10944,
-	 * because we are skipping device_id from the readout. */
-	rc = sja1105_spi_send_packed_buf(spi_setup,
-	                                 SPI_READ,
-	                                 CORE_ADDR + 0x01,
-	                                 packed_buf,
-	                                 SIZE_GENERAL_STATUS);
+	rc = sja1105_regmap_read(spi_setup, &read, 1, 0);
 	if (rc < 0) {
 		loge("spi read failed");
 		goto out;
 	}
-	sja1105_general_status_unpack(packed_buf, status,
-	                              spi_setup->device_id);
+	memset(status, 0, sizeof(*status));
+	sja1105_reg_unpack(reg, packed_buf, status);
 out:
 	return rc;
 }
-
@@ -28,6 +28,7 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  *****************************************************************************/
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -35,7 +36,9 @@
 #include <unistd.h>
 /* These are our include files */
 #include <lib/include/static-config.h>
+#include <lib/include/device.h>
 #include <lib/include/status.h>
+#include <lib/include/regmap.h>
 #include <lib/include/gtable.h>
 #include <lib/include/spi.h>
 #include <common.h>
@@ -164,17 +167,24 @@ sja1105_port_status_hl1_unpack(void *buf, struct
 	status->n_txbyte += status->n_txbytesh << 32;
 }
 
-static void
-sja1105_port_status_hl2_unpack(void *buf, struct
-                               sja1105_port_status *status)
-{
-	/* So that additions translate to 4 bytes */
-	uint32_t *p = (uint32_t*) buf;
-	gtable_unpack(p + 0x3, &status->n_qfull,        31,  0, 4);
-	gtable_unpack(p + 0x2, &status->n_part_drop,    31,  0, 4);
-	gtable_unpack(p + 0x1, &status->n_egr_disabled, 31,  0, 4);
-	gtable_unpack(p + 0x0, &status->n_not_reach,    31,  0, 4);
-}
+/* UM10944 Table 61 / UM11040 Table 91, registers are
+ * repeated every 0x10 words for each port */
+static const struct sja1105_reg_field port_status_hl2_fields[] = {
+	{"n_not_reach",    0x0, 31, 0, offsetof(struct sja1105_port_status, n_not_reach)},
+	{"n_egr_disabled", 0x1, 31, 0, offsetof(struct sja1105_port_status, n_egr_disabled)},
+	{"n_part_drop",    0x2, 31, 0, offsetof(struct sja1105_port_status, n_part_drop)},
+	{"n_qfull",        0x3, 31, 0, offsetof(struct sja1105_port_status, n_qfull)},
+};
+
+static const struct sja1105_reg port_status_mac =
+	{"mac",    0x200, 0x02, 0x02, NULL, 0};
+static const struct sja1105_reg port_status_hl1 =
+	{"hl1",    0x400, 0x10, 0x10, NULL, 0};
+static const struct sja1105_reg port_status_hl2 =
+	{"hl2",    0x600, 0x10, 0x04, port_status_hl2_fields,
+	 ARRAY_SIZE(port_status_hl2_fields)};
+static const struct sja1105_reg port_status_qlevel =
+	{"qlevel", 0x604, 0x10, 0x08, NULL, 0}; /* P/Q/R/S only */
 
 static void
 sja1105pqrs_port_status_qlevel_unpack(void *buf, struct
@@ -190,83 +200,79 @@ sja1105pqrs_port_status_qlevel_unpack(void *buf, struct
 	}
 }
 
-int sja1105_port_status_get(struct sja1105_spi_setup *spi_setup,
-                            struct sja1105_port_status *status,
-                            int port)
+/* Read the status of count consecutive ports, starting with first,
+ * coalescing the per-port register blocks into as few SPI
+ * bursts as possible. */
+static int
+sja1105_port_status_read(struct sja1105_spi_setup *spi_setup,
+                         struct sja1105_port_status *status,
+                         int first, int count)
 {
-	const int SIZE_MAC_AREA    = 0x02 * 4;
-	const int SIZE_HL_AREA     = 0x10 * 4;
-	const int SIZE_QLEVEL_AREA =  0x8 * 4; /* 0x4 to 0xB */
-	/* The larger of the 3. Reusing some space. */
-	const int BUF_LEN       = SIZE_HL_AREA;
-	const uint64_t mac_base_addr[]          = {0x200, 0x202, 0x204, 0x206, 0x208};
-	const uint64_t high_level_1_base_addr[] = {0x400, 0x410, 0x420, 0x430, 0x440};
-	const uint64_t high_level_2_base_addr[] = {0x600, 0x610, 0x620, 0x630, 0x640};
-	const uint64_t qlevel_base_addr[]       = {0x604, 0x614, 0x624, 0x634, 0x644};
-	uint8_t packed_buf[BUF_LEN];
-	int rc = 0;
-
-	memset(status, 0, sizeof(*status));
+	const struct sja1105_device_ops *ops = sja1105_spi_setup_ops(spi_setup);
+	struct sja1105_reg_read reads[4 * SJA1105_NUM_PORTS];
+	uint8_t mac_buf[SJA1105_NUM_PORTS][0x02 * 4];
+	uint8_t hl1_buf[SJA1105_NUM_PORTS][0x10 * 4];
+	uint8_t hl2_buf[SJA1105_NUM_PORTS][0x04 * 4];
+	uint8_t qlevel_buf[SJA1105_NUM_PORTS][0x08 * 4];
+	int num_reads = 0;
+	int port, i;
+	int rc;
 
-	/* MAC area */
-	rc = sja1105_spi_send_packed_buf(spi_setup,
-	                                 SPI_READ,
-	                                 CORE_ADDR + mac_base_addr[port],
-	                                 packed_buf,
-	                                 SIZE_MAC_AREA);
-	if (rc < 0) {
-		loge("failed to read mac registers");
-		goto out;
+	if (first < 0 || count < 1 || first + count > SJA1105_NUM_PORTS) {
+		loge("invalid port number %d", first);
+		return -EINVAL;
 	}
-	sja1105_port_status_mac_unpack(packed_buf, status);
-
-	/* High-level 1 */
-	rc = sja1105_spi_send_packed_buf(spi_setup,
-	                                 SPI_READ,
-	                                 CORE_ADDR + high_level_1_base_addr[port],
-	                                 packed_buf,
-	                                 SIZE_HL_AREA);
-	if (rc < 0) {
-		loge("failed to read high-level 1 registers");
-		goto out;
+	for (i = 0; i < count; i++) {
+		port = first + i;
+		reads[num_reads++] = (struct sja1105_reg_read)
+			{&port_status_mac, port, mac_buf[i]};
+		reads[num_reads++] = (struct sja1105_reg_read)
+			{&port_status_hl1, port, hl1_buf[i]};
+		reads[num_reads++] = (struct sja1105_reg_read)
+			{&port_status_hl2, port, hl2_buf[i]};
+		if (ops->has_qlevel) {
+			reads[num_reads++] = (struct sja1105_reg_read)
+				{&port_status_qlevel, port, qlevel_buf[i]};
+		}
 	}
-	sja1105_port_status_hl1_unpack(packed_buf, status);
-
-	/* High-level 2 */
-	rc = sja1105_spi_send_packed_buf(spi_setup,
-	                                 SPI_READ,
-	                                 CORE_ADDR + high_level_2_base_addr[port],
-	                                 packed_buf,
-	                                 SIZE_HL_AREA);
+	rc = sja1105_regmap_read(spi_setup, reads, num_reads, 0);
 	if (rc < 0) {
-		loge("failed to read high-level 2 registers");
-		goto out;
-	}
-	sja1105_port_status_hl2_unpack(packed_buf, status);
-
-	if (IS_ET(spi_setup->device_id)) {
-		/* Code below is strictly P/Q/R/S specific. */
-		goto out;
+		loge("failed to read port status registers");
+		return rc;
 	}
-	rc = sja1105_spi_send_packed_buf(spi_setup,
-	                                 SPI_READ,
-	                                 CORE_ADDR + qlevel_base_addr[port],
-	                                 packed_buf,
-	                                 SIZE_QLEVEL_AREA);
-	if (rc < 0) {
-		loge("failed to read high-level 1 registers");
-		goto out;
+	for (i = 0; i < count; i++) {
+		memset(&status[i], 0, sizeof(status[i]));
+		sja1105_port_status_mac_unpack(mac_buf[i], &status[i]);
+		sja1105_port_status_hl1_unpack(hl1_buf[i], &status[i]);
+		sja1105_reg_unpack(&port_status_hl2, hl2_buf[i], &status[i]);
+		if (ops->has_qlevel) {
+			sja1105pqrs_port_status_qlevel_unpack(qlevel_buf[i],
+			                                      &status[i]);
+		}
 	}
-	sja1105pqrs_port_status_qlevel_unpack(packed_buf, status);
-out:
-	return rc;
+	return 0;
+}
+
+int sja1105_port_status_get(struct sja1105_spi_setup *spi_setup,
+                            struct sja1105_port_status *status,
+                            int port)
+{
+	return sja1105_port_status_read(spi_setup, status, port, 1);
+}
+
+/* status must point to an array of SJA1105_NUM_PORTS elements */
+int sja1105_port_status_get_all(struct sja1105_spi_setup *spi_setup,
+                                struct sja1105_port_status *status)
+{
+	return sja1105_port_status_read(spi_setup, status, 0,
+	                                SJA1105_NUM_PORTS);
 }
 
 int sja1105_port_status_clear(struct sja1105_spi_setup *spi_setup,
                               int port)
 {
-	const int PORT_STATUS_CTRL_ADDR = IS_ET(spi_setup->device_id) ?
-	                                  0xf : 0x10;
+	const int PORT_STATUS_CTRL_ADDR =
+	          sja1105_spi_setup_ops(spi_setup)->core.port_status_ctrl;
 	const int BUF_LEN = 4;
 	uint8_t   packed_buf[BUF_LEN];
 	int       rc = 0;
@@ -0,0 +1,114 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <stdint.h>
+#include <inttypes.h>
+/* These are our include files */
+#include <lib/include/status.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+/*
+ * Config-loss watchdog. One poll is a single burst read of the
+ * general status registers. While the switch stays healthy, the
+ * period between polls doubles up to max_period_us, so that a
+ * quiet watchdog costs next to nothing on the bus. A fault or a
+ * failed read brings the period back to min_period_us.
+ */
+void sja1105_watchdog_init(struct sja1105_watchdog *wd,
+                           unsigned int min_period_us,
+                           unsigned int max_period_us)
+{
+	if (max_period_us < min_period_us) {
+		max_period_us = min_period_us;
+	}
+	wd->min_period_us = min_period_us;
+	wd->max_period_us = max_period_us;
+	wd->period_us     = min_period_us;
+	wd->last_ok_us    = sja1105_time_us();
+	wd->polls         = 0;
+}
+
+const char *sja1105_watchdog_fault_string(int fault)
+{
+	switch (fault) {
+	case SJA1105_WATCHDOG_OK:
+		return "switch is configured";
+	case SJA1105_WATCHDOG_UNCONFIGURED:
+		return "switch lost its configuration";
+	case SJA1105_WATCHDOG_DEVICE_ID:
+		return "switch reports a device id mismatch";
+	case SJA1105_WATCHDOG_PARITY:
+		return "switch reports a RAM parity error";
+	default:
+		return "unknown fault";
+	}
+}
+
+/* Returns one of enum sja1105_watchdog_fault, or a negative
+ * error code if the switch could not be read */
+int sja1105_watchdog_poll(struct sja1105_spi_setup *spi_setup,
+                          struct sja1105_watchdog *wd)
+{
+	struct sja1105_general_status *status = &wd->status;
+	uint64_t now_us;
+	int fault;
+	int rc;
+
+	now_us = sja1105_time_us();
+	wd->polls++;
+	rc = sja1105_general_status_get(spi_setup, status);
+	if (rc < 0) {
+		wd->period_us = wd->min_period_us;
+		return rc;
+	}
+	if (spi_setup->dry_run) {
+		/* Nothing meaningful was read back */
+		fault = SJA1105_WATCHDOG_OK;
+	} else if (status->configs == 0) {
+		fault = SJA1105_WATCHDOG_UNCONFIGURED;
+	} else if (status->ids) {
+		fault = SJA1105_WATCHDOG_DEVICE_ID;
+	} else if (status->ramparerrl || status->ramparerru) {
+		fault = SJA1105_WATCHDOG_PARITY;
+	} else {
+		fault = SJA1105_WATCHDOG_OK;
+	}
+	if (fault == SJA1105_WATCHDOG_OK) {
+		wd->last_ok_us = now_us;
+		wd->period_us *= 2;
+		if (wd->period_us > wd->max_period_us) {
+			wd->period_us = wd->max_period_us;
+		}
+	} else {
+		wd->period_us = wd->min_period_us;
+	}
+	return fault;
+}
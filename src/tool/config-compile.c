@@ -0,0 +1,301 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <libxml/parser.h>
+#include "xml/read/external.h"
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/staging-area.h>
+#include <lib/include/compact-config.h>
+#include <lib/include/gtable.h>
+#include <common.h>
+
+/*
+ * "config compile" turns many XML files into staging area files, the
+ * same ones that "config load" followed by "config save" would leave
+ * behind, without going through the staging area. The files are shared
+ * out to a pool of threads, each of which parses and packs one file at
+ * a time into its own staging area. A failing file is reported and does
+ * not stop the others.
+ */
+#define COMPILE_MAX_JOBS 256
+
+struct compile_file {
+	const char *xml_file;
+	char       *output_file;
+	long        xml_len;
+	long        output_len;
+	const char *step;
+	int         rc;
+};
+
+struct compile_work {
+	struct compile_file *files;
+	int   count;
+	int   next;
+	int   quirks;
+};
+
+static long compile_file_size(const char *file_name)
+{
+	struct stat st;
+
+	if (stat(file_name, &st) < 0) {
+		return 0;
+	}
+	return st.st_size;
+}
+
+static void compile_one(struct compile_file *file,
+                        struct sja1105_staging_area *staging_area)
+{
+	uint64_t xml_hash;
+	int rc;
+
+	file->xml_len = compile_file_size(file->xml_file);
+	file->step = "parse";
+	rc = sja1105_staging_area_parse_xml(file->xml_file, staging_area);
+	if (rc < 0) {
+		sja1105_err_remap(rc, SJA1105_ERR_INVALID_XML);
+		goto out;
+	}
+	if (staging_area_file_hash(file->xml_file, &xml_hash) < 0) {
+		xml_hash = 0;
+	}
+	staging_area->xml_hash = xml_hash;
+	file->step = "write";
+	rc = staging_area_save(file->output_file, staging_area);
+	if (rc < 0) {
+		sja1105_err_remap(rc, SJA1105_ERR_FILESYSTEM);
+		goto out;
+	}
+	file->output_len = compile_file_size(file->output_file);
+	logv("%s -> %s: %ld bytes", file->xml_file, file->output_file,
+	     file->output_len);
+out:
+	file->rc = rc;
+}
+
+static void *compile_worker(void *priv)
+{
+	struct sja1105_staging_area *staging_area;
+	struct compile_work *work = priv;
+	int i;
+
+	gtable_configure(work->quirks);
+	staging_area = malloc(sizeof(*staging_area));
+	if (staging_area == NULL) {
+		/* The other workers take on the files */
+		return NULL;
+	}
+	while ((i = __sync_fetch_and_add(&work->next, 1)) < work->count) {
+		compile_one(&work->files[i], staging_area);
+	}
+	free(staging_area);
+	return NULL;
+}
+
+/* "dir/board.xml" becomes "dir/board.bin", or "out/board.bin" with
+ * an output directory */
+static char *compile_output_name(const char *xml_file, const char *output_dir)
+{
+	const char *base = xml_file;
+	const char *slash;
+	char *name;
+	int len;
+
+	if (output_dir) {
+		slash = strrchr(xml_file, '/');
+		base = slash ? slash + 1 : xml_file;
+	}
+	len = strlen(base);
+	if (len > 4 && strcmp(base + len - 4, ".xml") == 0) {
+		len -= 4;
+	}
+	name = malloc((output_dir ? strlen(output_dir) + 1 : 0) + len + 5);
+	if (name == NULL) {
+		return NULL;
+	}
+	if (output_dir) {
+		sprintf(name, "%s/%.*s.bin", output_dir, len, base);
+	} else {
+		sprintf(name, "%.*s.bin", len, base);
+	}
+	return name;
+}
+
+static double compile_elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) +
+	       (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Returns -EINVAL for bad arguments, otherwise 0 or the (negated)
+ * SJA1105_ERR code of the first file that failed */
+int config_compile_parse(int argc, char **argv)
+{
+	struct compile_work work;
+	struct timespec start;
+	pthread_t *threads = NULL;
+	const char *output_dir = NULL;
+	long xml_bytes = 0;
+	long output_bytes = 0;
+	uint64_t tmp;
+	double elapsed;
+	int jobs = 0;
+	int compiled = 0;
+	int rc = 0;
+	int i, j;
+
+	while (argc && argv[0][0] == '-') {
+		if (argc >= 2 && (strcmp(argv[0], "-o") == 0 ||
+		                  strcmp(argv[0], "--output-dir") == 0)) {
+			output_dir = argv[1];
+		} else if (argc >= 2 && (strcmp(argv[0], "-j") == 0 ||
+		                         strcmp(argv[0], "--jobs") == 0)) {
+			if (reliable_uint64_from_string(&tmp, argv[1], NULL) < 0 ||
+			    tmp > COMPILE_MAX_JOBS) {
+				loge("Invalid number of jobs \"%s\"", argv[1]);
+				return -EINVAL;
+			}
+			jobs = tmp;
+		} else {
+			return -EINVAL;
+		}
+		argc -= 2; argv += 2;
+	}
+	if (argc < 1) {
+		return -EINVAL;
+	}
+	if (jobs == 0) {
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	jobs = min(jobs, argc);
+	if (jobs < 1) {
+		jobs = 1;
+	}
+
+	memset(&work, 0, sizeof(work));
+	work.count  = argc;
+	work.quirks = gtable_quirks_get();
+	work.files  = calloc(argc, sizeof(*work.files));
+	threads = calloc(jobs, sizeof(*threads));
+	if (work.files == NULL || threads == NULL) {
+		loge("calloc failed");
+		rc = -SJA1105_ERR_FILESYSTEM;
+		goto out;
+	}
+	for (i = 0; i < argc; i++) {
+		work.files[i].xml_file = argv[i];
+		work.files[i].output_file = compile_output_name(argv[i],
+		                                                output_dir);
+		if (work.files[i].output_file == NULL) {
+			loge("malloc failed");
+			rc = -SJA1105_ERR_FILESYSTEM;
+			goto out;
+		}
+		/* Two threads must never write the same file */
+		for (j = 0; j < i; j++) {
+			if (strcmp(work.files[i].output_file,
+			           work.files[j].output_file) == 0) {
+				loge("%s and %s would both be compiled to %s",
+				     argv[j], argv[i], work.files[i].output_file);
+				rc = -SJA1105_ERR_USAGE;
+				goto out;
+			}
+		}
+	}
+	/* Each file is a job of its own: packing its tables
+	 * is not split further */
+	sja1105_parallel_configure(1);
+	/* Once, before any thread parses */
+	xmlInitParser();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	/* The calling thread is one of the workers */
+	for (i = 0; i < jobs - 1; i++) {
+		if (pthread_create(&threads[i], NULL, compile_worker, &work)) {
+			break;
+		}
+	}
+	compile_worker(&work);
+	for (j = 0; j < i; j++) {
+		pthread_join(threads[j], NULL);
+	}
+	elapsed = compile_elapsed(&start);
+	xmlCleanupParser();
+
+	for (i = 0; i < argc; i++) {
+		struct compile_file *file = &work.files[i];
+
+		if (file->step == NULL) {
+			/* Never picked up: every worker ran out of memory */
+			loge("%s: not compiled", file->xml_file);
+			rc = -SJA1105_ERR_FILESYSTEM;
+			continue;
+		}
+		xml_bytes += file->xml_len;
+		if (file->rc < 0) {
+			loge("%s: %s failed: %s", file->xml_file, file->step,
+			     sja1105_err_code_to_string(-file->rc));
+			if (rc == 0) {
+				rc = file->rc;
+			}
+			continue;
+		}
+		output_bytes += file->output_len;
+		compiled++;
+	}
+	printf("compiled %d of %d files in %.3f s with %d jobs: %.1f files/s\n",
+	       compiled, argc, elapsed, jobs,
+	       elapsed > 0 ? compiled / elapsed : 0);
+	printf("read %ld bytes of XML (%.1f KB/s), wrote %ld bytes\n",
+	       xml_bytes, elapsed > 0 ? xml_bytes / elapsed / 1024 : 0,
+	       output_bytes);
+out:
+	if (work.files) {
+		for (i = 0; i < argc; i++) {
+			free(work.files[i].output_file);
+		}
+	}
+	free(work.files);
+	free(threads);
+	return rc;
+}
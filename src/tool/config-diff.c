@@ -0,0 +1,403 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include "xml/read/external.h"
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/static-config.h>
+#include <lib/include/staging-area.h>
+#include <common.h>
+
+/*
+ * config diff compares two configurations, each one either a staging
+ * area or an XML file. Tables are compared in their packed form
+ * first, and only the entries of those that differ are unpacked
+ * and compared field by field. The fields are named as config show
+ * prints them.
+ */
+#define DECLARE_TABLE_DIFF_FMT_FN(TABLE_NAME)                                 \
+	static void                                                           \
+	TABLE_NAME##_diff_fmt(char *print_buf, void *entry)                   \
+	{                                                                     \
+		sja1105_##TABLE_NAME##_entry_fmt_show(print_buf, "%s\n",      \
+		                                      entry);                 \
+	}
+
+DECLARE_TABLE_DIFF_FMT_FN(schedule)
+DECLARE_TABLE_DIFF_FMT_FN(schedule_entry_points)
+DECLARE_TABLE_DIFF_FMT_FN(vl_lookup)
+DECLARE_TABLE_DIFF_FMT_FN(vl_policing)
+DECLARE_TABLE_DIFF_FMT_FN(vl_forwarding)
+DECLARE_TABLE_DIFF_FMT_FN(l2_lookup)
+DECLARE_TABLE_DIFF_FMT_FN(l2_policing)
+DECLARE_TABLE_DIFF_FMT_FN(vlan_lookup)
+DECLARE_TABLE_DIFF_FMT_FN(l2_forwarding)
+DECLARE_TABLE_DIFF_FMT_FN(mac_config)
+DECLARE_TABLE_DIFF_FMT_FN(schedule_params)
+DECLARE_TABLE_DIFF_FMT_FN(schedule_entry_points_params)
+DECLARE_TABLE_DIFF_FMT_FN(vl_forwarding_params)
+DECLARE_TABLE_DIFF_FMT_FN(l2_lookup_params)
+DECLARE_TABLE_DIFF_FMT_FN(l2_forwarding_params)
+DECLARE_TABLE_DIFF_FMT_FN(avb_params)
+DECLARE_TABLE_DIFF_FMT_FN(general_params)
+DECLARE_TABLE_DIFF_FMT_FN(xmii_params)
+DECLARE_TABLE_DIFF_FMT_FN(sgmii)
+
+static const struct {
+	const char *name;
+	void      (*fmt)(char *print_buf, void *entry);
+} diff_tables[BLK_IDX_MAX] = {
+	[BLK_IDX_SCHEDULE]              = {"schedule-table", schedule_diff_fmt},
+	[BLK_IDX_SCHEDULE_ENTRY_POINTS] = {"schedule-entry-points-table", schedule_entry_points_diff_fmt},
+	[BLK_IDX_VL_LOOKUP]             = {"vl-lookup-table", vl_lookup_diff_fmt},
+	[BLK_IDX_VL_POLICING]           = {"vl-policing-table", vl_policing_diff_fmt},
+	[BLK_IDX_VL_FORWARDING]         = {"vl-forwarding-table", vl_forwarding_diff_fmt},
+	[BLK_IDX_L2_LOOKUP]             = {"l2-address-lookup-table", l2_lookup_diff_fmt},
+	[BLK_IDX_L2_POLICING]           = {"l2-policing-table", l2_policing_diff_fmt},
+	[BLK_IDX_VLAN_LOOKUP]           = {"vlan-lookup-table", vlan_lookup_diff_fmt},
+	[BLK_IDX_L2_FORWARDING]         = {"l2-forwarding-table", l2_forwarding_diff_fmt},
+	[BLK_IDX_MAC_CONFIG]            = {"mac-configuration-table", mac_config_diff_fmt},
+	[BLK_IDX_SCHEDULE_PARAMS]       = {"schedule-parameters-table", schedule_params_diff_fmt},
+	[BLK_IDX_SCHEDULE_ENTRY_POINTS_PARAMS] = {"schedule-entry-points-parameters-table", schedule_entry_points_params_diff_fmt},
+	[BLK_IDX_VL_FORWARDING_PARAMS]  = {"vl-forwarding-parameters-table", vl_forwarding_params_diff_fmt},
+	[BLK_IDX_L2_LOOKUP_PARAMS]      = {"l2-address-lookup-parameters-table", l2_lookup_params_diff_fmt},
+	[BLK_IDX_L2_FORWARDING_PARAMS]  = {"l2-forwarding-parameters-table", l2_forwarding_params_diff_fmt},
+	[BLK_IDX_AVB_PARAMS]            = {"avb-parameters-table", avb_params_diff_fmt},
+	[BLK_IDX_GENERAL_PARAMS]        = {"general-parameters-table", general_params_diff_fmt},
+	[BLK_IDX_XMII_PARAMS]           = {"xmii-mode-parameters-table", xmii_params_diff_fmt},
+	[BLK_IDX_SGMII]                 = {"sgmii-table", sgmii_diff_fmt},
+};
+
+struct config_diff {
+	int json;
+	int changes;
+	int fields;
+	int added;
+	int removed;
+	int tables;
+	int reset_needed;
+};
+
+static void json_string(const char *str)
+{
+	putchar('"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			putchar('\\');
+		}
+		putchar(*str);
+	}
+	putchar('"');
+}
+
+static void
+diff_print(struct config_diff *diff, const char *table, int index,
+           const char *field, const char *old_val, const char *new_val)
+{
+	if (!diff->json) {
+		if (field == NULL) {
+			printf("%s[%d]: %s\n", table, index,
+			       old_val ? "removed" : "added");
+		} else if (index < 0) {
+			printf("%s.%s: %s -> %s\n", table, field,
+			       old_val, new_val);
+		} else {
+			printf("%s[%d].%s: %s -> %s\n", table, index, field,
+			       old_val, new_val);
+		}
+		diff->changes++;
+		return;
+	}
+	printf("%s\n    {\"table\": ", diff->changes ? "," : "");
+	json_string(table);
+	if (index >= 0) {
+		printf(", \"index\": %d", index);
+	}
+	if (field == NULL) {
+		printf(", \"change\": \"%s\"}", old_val ? "removed" : "added");
+	} else {
+		printf(", \"change\": \"modified\", \"field\": ");
+		json_string(field);
+		printf(", \"old\": ");
+		json_string(old_val);
+		printf(", \"new\": ");
+		json_string(new_val);
+		printf("}");
+	}
+	diff->changes++;
+}
+
+/* Splits "NAME    value" in place, with the name lowercased */
+static char *diff_field_split(char *line, char **value)
+{
+	char *name = trimwhitespace(line);
+	char *p;
+
+	for (p = name; *p && !isspace((unsigned char) *p); p++) {
+		*p = tolower((unsigned char) *p);
+	}
+	if (*p) {
+		*p++ = '\0';
+	}
+	*value = trimwhitespace(p);
+	for (p = *value; *p; p++) {
+		*p = tolower((unsigned char) *p);
+	}
+	return name;
+}
+
+static void
+diff_entry_fields(struct config_diff *diff, int blk_idx, int index,
+                  char *old_buf, char *new_buf)
+{
+	char *old_line, *new_line;
+	char *old_next, *new_next;
+	char *old_val, *new_val;
+	char *field;
+
+	old_line = old_buf;
+	new_line = new_buf;
+	while (old_line && new_line && *old_line && *new_line) {
+		old_next = strchr(old_line, '\n');
+		new_next = strchr(new_line, '\n');
+		if (old_next) {
+			*old_next++ = '\0';
+		}
+		if (new_next) {
+			*new_next++ = '\0';
+		}
+		if (strcmp(old_line, new_line) != 0) {
+			field = diff_field_split(old_line, &old_val);
+			diff_field_split(new_line, &new_val);
+			diff_print(diff, diff_tables[blk_idx].name, index,
+			           field, old_val, new_val);
+			diff->fields++;
+		}
+		old_line = old_next;
+		new_line = new_next;
+	}
+}
+
+static int
+diff_table(struct config_diff *diff, int blk_idx,
+           struct sja1105_compact_config *old_config,
+           struct sja1105_compact_config *new_config)
+{
+	const struct sja1105_table_desc *desc = sja1105_table_desc_get(blk_idx);
+	struct sja1105_compact_table *old = &old_config->tables[blk_idx];
+	struct sja1105_compact_table *new = &new_config->tables[blk_idx];
+	char  old_buf[MAX_LINE_SIZE];
+	char  new_buf[MAX_LINE_SIZE];
+	void *old_entry;
+	void *new_entry;
+	char  old_count[32];
+	char  new_count[32];
+	int   same_size;
+	int   i;
+	int   rc = 0;
+
+	same_size = (old->entry_size == new->entry_size);
+	if (old->count == new->count && same_size &&
+	    memcmp(old->entries, new->entries,
+	           old->count * old->entry_size) == 0) {
+		return 0;
+	}
+	diff->tables++;
+	if (!staging_area_delta_supported(desc->block_id,
+	                                  old->count * old->entry_size,
+	                                  new->count * new->entry_size)) {
+		diff->reset_needed = 1;
+	}
+	old_entry = calloc(1, desc->entry_struct_size);
+	new_entry = calloc(1, desc->entry_struct_size);
+	if (old_entry == NULL || new_entry == NULL) {
+		loge("calloc failed");
+		rc = -ENOMEM;
+		goto out;
+	}
+	if (old->count != new->count) {
+		snprintf(old_count, sizeof(old_count), "%d", old->count);
+		snprintf(new_count, sizeof(new_count), "%d", new->count);
+		diff_print(diff, diff_tables[blk_idx].name, -1,
+		           "entry-count", old_count, new_count);
+	}
+	for (i = 0; i < old->count || i < new->count; i++) {
+		if (i >= new->count) {
+			diff_print(diff, diff_tables[blk_idx].name, i,
+			           NULL, "", NULL);
+			diff->removed++;
+			continue;
+		}
+		if (i >= old->count) {
+			diff_print(diff, diff_tables[blk_idx].name, i,
+			           NULL, NULL, "");
+			diff->added++;
+			continue;
+		}
+		if (same_size && memcmp(old->entries + i * old->entry_size,
+		                        new->entries + i * new->entry_size,
+		                        old->entry_size) == 0) {
+			continue;
+		}
+		sja1105_compact_config_get_entry(old_config, blk_idx, i,
+		                                 old_entry);
+		sja1105_compact_config_get_entry(new_config, blk_idx, i,
+		                                 new_entry);
+		old_buf[0] = new_buf[0] = '\0';
+		diff_tables[blk_idx].fmt(old_buf, old_entry);
+		diff_tables[blk_idx].fmt(new_buf, new_entry);
+		diff_entry_fields(diff, blk_idx, i, old_buf, new_buf);
+	}
+out:
+	free(old_entry);
+	free(new_entry);
+	return rc;
+}
+
+/* XML files start with '<' once whitespace is skipped,
+ * anything else is taken for a staging area */
+static int
+diff_config_load(const char *file_name, struct sja1105_staging_area *staging_area,
+                 struct sja1105_compact_config *compact)
+{
+	FILE *fp;
+	int   c;
+	int   rc;
+
+	fp = fopen(file_name, "rb");
+	if (fp == NULL) {
+		loge("could not open %s", file_name);
+		return -errno;
+	}
+	do {
+		c = fgetc(fp);
+	} while (c != EOF && isspace(c));
+	fclose(fp);
+	if (c == '<') {
+		rc = sja1105_staging_area_from_xml(file_name, staging_area);
+	} else {
+		rc = staging_area_load(file_name, staging_area);
+	}
+	if (rc < 0) {
+		loge("could not read %s", file_name);
+		return rc;
+	}
+	return staging_area_compact(staging_area, compact);
+}
+
+int config_diff_parse(int argc, char **argv)
+{
+	struct sja1105_staging_area   *staging_areas[2] = {NULL, NULL};
+	struct sja1105_compact_config  compacts[2];
+	struct config_diff diff;
+	char   old_id[32];
+	char   new_id[32];
+	int    loaded = 0;
+	int    blk_idx;
+	int    rc = 0;
+
+	memset(&diff, 0, sizeof(diff));
+	if (argc && (strcmp(argv[0], "-j") == 0 ||
+	             strcmp(argv[0], "--json") == 0)) {
+		diff.json = 1;
+		argc--; argv++;
+	}
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	for (loaded = 0; loaded < 2; loaded++) {
+		staging_areas[loaded] = calloc(1, sizeof(struct sja1105_staging_area));
+		if (staging_areas[loaded] == NULL) {
+			loge("calloc failed");
+			rc = -ENOMEM;
+			goto out;
+		}
+		rc = diff_config_load(argv[loaded], staging_areas[loaded],
+		                      &compacts[loaded]);
+		if (rc < 0) {
+			goto out;
+		}
+	}
+	if (diff.json) {
+		printf("{\n  \"changes\": [");
+	}
+	if (compacts[0].device_id != compacts[1].device_id) {
+		snprintf(old_id, sizeof(old_id), "0x%08" PRIx64,
+		         compacts[0].device_id);
+		snprintf(new_id, sizeof(new_id), "0x%08" PRIx64,
+		         compacts[1].device_id);
+		diff_print(&diff, "device-id", -1, "value", old_id, new_id);
+		diff.reset_needed = 1;
+	}
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		rc = diff_table(&diff, blk_idx, &compacts[0], &compacts[1]);
+		if (rc < 0) {
+			goto out_json;
+		}
+	}
+out_json:
+	if (diff.json) {
+		printf("%s],\n", diff.changes ? "\n  " : "");
+		printf("  \"tables_changed\": %d,\n", diff.tables);
+		printf("  \"fields_changed\": %d,\n", diff.fields);
+		printf("  \"entries_added\": %d,\n", diff.added);
+		printf("  \"entries_removed\": %d,\n", diff.removed);
+		printf("  \"reset_needed\": %s\n}\n",
+		       diff.reset_needed ? "true" : "false");
+	} else if (rc == 0) {
+		if (diff.changes == 0) {
+			printf("Configurations are identical\n");
+		} else {
+			printf("%d tables changed: %d fields, %d entries added, "
+			       "%d removed\n", diff.tables, diff.fields,
+			       diff.added, diff.removed);
+			printf("Applying the changes %s\n", diff.reset_needed ?
+			       "needs a switch reset" :
+			       "is possible without a switch reset");
+		}
+	}
+out:
+	while (loaded-- > 0) {
+		sja1105_compact_config_free(&compacts[loaded]);
+	}
+	for (blk_idx = 0; blk_idx < 2; blk_idx++) {
+		if (staging_areas[blk_idx]) {
+			staging_area_release(staging_areas[blk_idx]);
+			free(staging_areas[blk_idx]);
+		}
+	}
+	return rc;
+}
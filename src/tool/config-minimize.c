@@ -0,0 +1,289 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/static-config.h>
+#include <lib/include/staging-area.h>
+#include <lib/include/compact-config.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+/*
+ * "config minimize" drops the entries that cannot make a difference to
+ * the switch, since every byte of the configuration is packed, CRC'd
+ * and clocked over SPI on each upload:
+ *
+ * - VLAN lookup entries with no member port (and no mirroring), whose
+ *   frames are dropped just as if the VLAN were not in the table.
+ * - Static FDB entries identical to an earlier one. Their index is
+ *   assigned again when packing anyway.
+ * - VL policing and VL forwarding entries past the end of the VL
+ *   lookup table, unless still reached through the sharindx of a VL
+ *   policing entry or the vlindex of a schedule entry. Those that are
+ *   kept move down, and the references to them are renumbered.
+ * - Schedule entry points whose address is past the end of the
+ *   schedule.
+ *
+ * Nothing is saved if the result would not pass the validity check
+ * done before an upload.
+ */
+struct minimize_stats {
+	int vlan;
+	int fdb;
+	int vl;
+	int entry_points;
+};
+
+static void minimize_vlan(struct sja1105_static_config *config,
+                          struct minimize_stats *stats)
+{
+	int i, count = 0;
+
+	for (i = 0; i < config->vlan_lookup_count; i++) {
+		struct sja1105_vlan_lookup_entry *entry = &config->vlan_lookup[i];
+
+		if (entry->vmemb_port == 0 && entry->ving_mirr == 0 &&
+		    entry->vegr_mirr == 0) {
+			logv("vlan-lookup-table[%d]: vlanid %" PRIu64
+			     " has no member ports", i, entry->vlanid);
+			continue;
+		}
+		config->vlan_lookup[count++] = *entry;
+	}
+	stats->vlan = config->vlan_lookup_count - count;
+	config->vlan_lookup_count = count;
+}
+
+static int fdb_entry_equal(const struct sja1105_l2_lookup_entry *a,
+                           const struct sja1105_l2_lookup_entry *b)
+{
+	struct sja1105_l2_lookup_entry x = *a;
+	struct sja1105_l2_lookup_entry y = *b;
+
+	x.index = y.index = 0;
+	return memcmp(&x, &y, sizeof(x)) == 0;
+}
+
+static void minimize_fdb(struct sja1105_static_config *config,
+                         struct minimize_stats *stats)
+{
+	int i, j, count = 0;
+
+	for (i = 0; i < config->l2_lookup_count; i++) {
+		struct sja1105_l2_lookup_entry *entry = &config->l2_lookup[i];
+
+		for (j = 0; j < count; j++) {
+			if (fdb_entry_equal(&config->l2_lookup[j], entry)) {
+				break;
+			}
+		}
+		if (j < count) {
+			logv("l2-address-lookup-table[%d]: same as entry %d", i, j);
+			continue;
+		}
+		config->l2_lookup[count++] = *entry;
+	}
+	stats->fdb = config->l2_lookup_count - count;
+	config->l2_lookup_count = count;
+}
+
+static void minimize_vl(struct sja1105_static_config *config,
+                        struct minimize_stats *stats)
+{
+	int used[MAX_VL_POLICING_COUNT];
+	int map[MAX_VL_POLICING_COUNT];
+	uint64_t ref;
+	int size = config->vl_policing_count;
+	int changed;
+	int count;
+	int i;
+
+	if (config->vl_forwarding_count > size) {
+		size = config->vl_forwarding_count;
+	}
+	for (i = 0; i < size; i++) {
+		/* Every VL lookup entry has its VL index */
+		used[i] = (i < config->vl_lookup_count);
+	}
+	for (i = 0; i < config->schedule_count; i++) {
+		ref = config->schedule[i].vlindex;
+		if (ref < (uint64_t) size) {
+			used[ref] = 1;
+		}
+	}
+	/* A policing entry kept for its sharindx may share another one */
+	do {
+		changed = 0;
+		for (i = 0; i < config->vl_policing_count; i++) {
+			ref = config->vl_policing[i].sharindx;
+			if (used[i] && ref < (uint64_t) size && !used[ref]) {
+				used[ref] = 1;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	for (i = 0, count = 0; i < size; i++) {
+		map[i] = used[i] ? count++ : -1;
+	}
+	stats->vl = size - count;
+	if (stats->vl == 0) {
+		return;
+	}
+	logv("dropping %d VL policing/forwarding indices past the "
+	     "%d VL lookup entries", stats->vl, config->vl_lookup_count);
+	/* Entries only ever move down: map[i] <= i */
+	for (i = 0, count = 0; i < config->vl_policing_count; i++) {
+		if (map[i] < 0) {
+			continue;
+		}
+		config->vl_policing[count] = config->vl_policing[i];
+		ref = config->vl_policing[count].sharindx;
+		if (ref < (uint64_t) size) {
+			config->vl_policing[count].sharindx = map[ref];
+		}
+		count++;
+	}
+	config->vl_policing_count = count;
+	for (i = 0, count = 0; i < config->vl_forwarding_count; i++) {
+		if (map[i] >= 0) {
+			config->vl_forwarding[count++] = config->vl_forwarding[i];
+		}
+	}
+	config->vl_forwarding_count = count;
+	for (i = 0; i < config->schedule_count; i++) {
+		ref = config->schedule[i].vlindex;
+		if (ref < (uint64_t) size) {
+			config->schedule[i].vlindex = map[ref];
+		}
+	}
+}
+
+static void minimize_entry_points(struct sja1105_static_config *config,
+                                  struct minimize_stats *stats)
+{
+	int i, count = 0;
+
+	for (i = 0; i < config->schedule_entry_points_count; i++) {
+		struct sja1105_schedule_entry_points_entry *entry;
+
+		entry = &config->schedule_entry_points[i];
+		if (entry->address >= (uint64_t) config->schedule_count) {
+			logv("schedule-entry-points-table[%d]: address %" PRIu64
+			     " is past the schedule", i, entry->address);
+			continue;
+		}
+		config->schedule_entry_points[count++] = *entry;
+	}
+	stats->entry_points = config->schedule_entry_points_count - count;
+	config->schedule_entry_points_count = count;
+}
+
+static int minimize_length(struct sja1105_staging_area *staging_area)
+{
+	struct sja1105_compact_config compact;
+	int rc;
+
+	rc = staging_area_compact(staging_area, &compact);
+	if (rc < 0) {
+		return rc;
+	}
+	rc = sja1105_compact_config_get_length(&compact);
+	sja1105_compact_config_free(&compact);
+	return rc;
+}
+
+/* Microseconds to clock out a config of len bytes, split into
+ * SPI messages of up to SIZE_SPI_MSG_MAXLEN bytes plus a header */
+static double minimize_upload_us(int len, unsigned int speed)
+{
+	int maxlen = SIZE_SPI_MSG_MAXLEN;
+	int messages = (len + maxlen - 1) / maxlen;
+
+	return (len + messages * SIZE_SPI_MSG_HEADER) * 8 * 1e6 / speed;
+}
+
+/* Returns the number of entries removed */
+int staging_area_minimize(struct sja1105_staging_area *staging_area,
+                          unsigned int spi_speed)
+{
+	struct sja1105_static_config *config = &staging_area->static_config;
+	struct minimize_stats stats;
+	double old_us, new_us;
+	int old_len, new_len;
+	int rc;
+
+	/* The validity check looks at every table */
+	rc = staging_area_tables_get_all(staging_area);
+	if (rc < 0) {
+		return rc;
+	}
+	old_len = minimize_length(staging_area);
+	if (old_len < 0) {
+		return old_len;
+	}
+	memset(&stats, 0, sizeof(stats));
+	minimize_vlan(config, &stats);
+	minimize_fdb(config, &stats);
+	minimize_vl(config, &stats);
+	minimize_entry_points(config, &stats);
+	/* E.g. no VLAN left at all, or a schedule without entry points */
+	rc = sja1105_static_config_check_valid(config);
+	if (rc < 0) {
+		loge("the minimized config would not be valid for upload, "
+		     "leaving the staging area as is");
+		return -EINVAL;
+	}
+	new_len = minimize_length(staging_area);
+	if (new_len < 0) {
+		return new_len;
+	}
+	if (spi_speed == 0) {
+		spi_speed = 1000000;
+	}
+	old_us = minimize_upload_us(old_len, spi_speed);
+	new_us = minimize_upload_us(new_len, spi_speed);
+
+	printf("VLAN lookup entries without member ports: %d\n", stats.vlan);
+	printf("duplicate static FDB entries: %d\n", stats.fdb);
+	printf("unused VL policing/forwarding indices: %d\n", stats.vl);
+	printf("schedule entry points past the schedule: %d\n",
+	       stats.entry_points);
+	printf("config size: %d -> %d bytes, %d bytes saved\n",
+	       old_len, new_len, old_len - new_len);
+	printf("upload time at %u Hz: %.0f -> %.0f us, %.0f us saved\n",
+	       spi_speed, old_us, new_us, old_us - new_us);
+	return stats.vlan + stats.fdb + stats.vl + stats.entry_points;
+}
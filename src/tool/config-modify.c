@@ -32,9 +32,12 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "internal.h"
 /* From libsja1105 */
 #include <lib/include/staging-area.h>
+#include <lib/include/device.h>
+#include <lib/include/gtable.h>
 #include <common.h>
 
 static void print_usage(const char *prog)
@@ -43,6 +46,105 @@ static void print_usage(const char *prog)
 	printf("Please run \"%s config modify help\" to see more details\n", prog);
 }
 
+/* Set while a predicate is evaluated: instead of changing the field,
+ * generic_table_entry_modify only reports where it is */
+static struct {
+	int       active;
+	uint64_t *field_addr;
+	int       field_count;
+} field_probe;
+
+/*
+ * Set while the changes made by a command are recorded so that they
+ * can be undone. Before a field is written, a line that sets it back,
+ * "<table>[<index>]\t<field>\t<old value>", is added to the log.
+ * Undoing a command replays its lines in reverse order.
+ */
+static struct {
+	int         active;
+	int         error;
+	/* What is being modified */
+	const char *table_name;
+	int         entry_index;
+	const char *field_name;
+	char       *buf;
+	size_t      len;
+	size_t      size;
+} change_log;
+
+static void change_log_append(const char *table_name, int entry_index,
+                              const char *field_name, const char *value)
+{
+	size_t need;
+	char  *buf;
+
+	need = strlen(table_name) + strlen(field_name) + strlen(value) + 32;
+	if (change_log.len + need > change_log.size) {
+		buf = realloc(change_log.buf, 2 * change_log.size + need);
+		if (buf == NULL) {
+			loge("realloc failed");
+			change_log.error = -ENOMEM;
+			return;
+		}
+		change_log.buf  = buf;
+		change_log.size = 2 * change_log.size + need;
+	}
+	if (entry_index < 0) {
+		change_log.len += sprintf(change_log.buf + change_log.len,
+		                          "%s\t%s\t%s\n", table_name,
+		                          field_name, value);
+	} else {
+		change_log.len += sprintf(change_log.buf + change_log.len,
+		                          "%s[%d]\t%s\t%s\n", table_name,
+		                          entry_index, field_name, value);
+	}
+}
+
+static void change_log_field(uint64_t *field_addr, int field_count)
+{
+	char value[MAX_LINE_SIZE];
+	int  len;
+	int  i;
+
+	if (field_count == 1) {
+		snprintf(value, sizeof(value), "0x%" PRIx64, *field_addr);
+	} else {
+		len = sprintf(value, "[");
+		for (i = 0; i < field_count; i++) {
+			len += snprintf(value + len, sizeof(value) - len,
+			                i ? " 0x%" PRIx64 : "0x%" PRIx64,
+			                field_addr[i]);
+		}
+		snprintf(value + len, sizeof(value) - len, "]");
+	}
+	change_log_append(change_log.table_name, change_log.entry_index,
+	                  change_log.field_name, value);
+}
+
+void staging_area_change_log_start(void)
+{
+	free(change_log.buf);
+	memset(&change_log, 0, sizeof(change_log));
+	change_log.active = 1;
+}
+
+/* Hands over the lines recorded since staging_area_change_log_start,
+ * NULL if nothing was changed. Returns a negative error code if some
+ * could not be recorded. */
+int staging_area_change_log_stop(char **changes)
+{
+	int rc = change_log.error;
+
+	*changes = NULL;
+	if (rc == 0 && change_log.len) {
+		*changes = change_log.buf;
+	} else {
+		free(change_log.buf);
+	}
+	memset(&change_log, 0, sizeof(change_log));
+	return rc;
+}
+
 static int generic_table_entry_modify(
 		uint64_t *field_addr,
 		int       entry_index,
@@ -52,6 +154,11 @@ static int generic_table_entry_modify(
 {
 	int rc;
 
+	if (field_probe.active) {
+		field_probe.field_addr  = field_addr;
+		field_probe.field_count = entry_field_count;
+		return 0;
+	}
 	if (entry_index < 0 || entry_index >= entry_count) {
 		loge("Index out of bounds!");
 		loge("Please adjust the entry count of the table:");
@@ -59,6 +166,9 @@ static int generic_table_entry_modify(
 		rc = -ERANGE;
 		goto out;
 	}
+	if (change_log.active) {
+		change_log_field(field_addr, entry_field_count);
+	}
 	if (entry_field_count == 1) {
 		/* Entry is single element */
 		rc = reliable_uint64_from_string(field_addr, field_val, NULL);
@@ -1002,77 +1112,856 @@ out:
 	return rc;
 }
 
+typedef int (*table_modify_fn)(struct sja1105_static_config*,
+                               int, char*, char*);
+
+static const char *static_config_options[] = {
+	"schedule-table",
+	"schedule-entry-points-table",
+	"vl-lookup-table",
+	"vl-policing-table",
+	"vl-forwarding-table",
+	"l2-address-lookup-table",
+	"l2-policing-table",
+	"vlan-lookup-table",
+	"l2-forwarding-table",
+	"mac-configuration-table",
+	"schedule-parameters-table",
+	"schedule-entry-points-parameters-table",
+	"vl-forwarding-parameters-table",
+	"l2-address-lookup-parameters-table",
+	"l2-forwarding-parameters-table",
+	"clock-synchronization-parameters-table",
+	"avb-parameters-table",
+	"general-parameters-table",
+	"xmii-mode-parameters-table",
+	"sgmii-table",
+};
+static table_modify_fn next_static_table_modify[] = {
+	schedule_table_entry_modify,
+	schedule_entry_points_table_entry_modify,
+	vl_lookup_table_entry_modify,
+	vl_policing_table_entry_modify,
+	vl_fw_table_entry_modify,
+	l2_lookup_table_entry_modify,
+	l2_policing_table_entry_modify,
+	vlan_lookup_table_entry_modify,
+	l2_fw_table_entry_modify,
+	mac_config_table_entry_modify,
+	schedule_params_table_entry_modify,
+	schedule_entry_points_params_table_entry_modify,
+	vl_fw_params_table_entry_modify,
+	l2_lookup_params_table_entry_modify,
+	l2_fw_params_table_entry_modify,
+	clock_sync_params_table_entry_modify,
+	avb_params_table_entry_modify,
+	general_params_table_entry_modify,
+	xmii_table_entry_modify,
+	sgmii_table_entry_modify,
+};
+/* Block ID of each of the tables above */
+static const uint64_t blk_ids[] = {
+	BLKID_SCHEDULE_TABLE,
+	BLKID_SCHEDULE_ENTRY_POINTS_TABLE,
+	BLKID_VL_LOOKUP_TABLE,
+	BLKID_VL_POLICING_TABLE,
+	BLKID_VL_FORWARDING_TABLE,
+	BLKID_L2_LOOKUP_TABLE,
+	BLKID_L2_POLICING_TABLE,
+	BLKID_VLAN_LOOKUP_TABLE,
+	BLKID_L2_FORWARDING_TABLE,
+	BLKID_MAC_CONFIG_TABLE,
+	BLKID_SCHEDULE_PARAMS_TABLE,
+	BLKID_SCHEDULE_ENTRY_POINTS_PARAMS_TABLE,
+	BLKID_VL_FORWARDING_PARAMS_TABLE,
+	BLKID_L2_LOOKUP_PARAMS_TABLE,
+	BLKID_L2_FORWARDING_PARAMS_TABLE,
+	BLKID_CLK_SYNC_PARAMS_TABLE,
+	BLKID_AVB_PARAMS_TABLE,
+	BLKID_GENERAL_PARAMS_TABLE,
+	BLKID_XMII_MODE_PARAMS_TABLE,
+	BLKID_SGMII_TABLE,
+};
+
+/* "entry-bytes" is not a field: it carries the whole entry, as hex
+ * bytes of its struct. It is what the change log uses to bring back
+ * the entries that a smaller entry count dropped. */
+#define ENTRY_BYTES "entry-bytes"
+
+static int
+modify_entry_bytes(struct sja1105_static_config *config, int match,
+                   int entry_index, char *field_val)
+{
+	const struct sja1105_table_desc *desc;
+	unsigned int byte;
+	size_t i;
+	char *entry;
+	int blk_idx;
+
+	blk_idx = sja1105_blk_idx_from_id(blk_ids[match]);
+	if (blk_idx < 0) {
+		return -EINVAL;
+	}
+	desc = sja1105_table_desc_get(blk_idx);
+	if (entry_index < 0 || entry_index >= desc->max_count) {
+		loge("Index %d out of bounds", entry_index);
+		return -ERANGE;
+	}
+	if (strlen(field_val) != 2 * desc->entry_struct_size) {
+		loge("%s of %s must be %zu bytes long", ENTRY_BYTES,
+		     static_config_options[match], desc->entry_struct_size);
+		return -EINVAL;
+	}
+	entry = (char*) config + desc->array_offset +
+	        entry_index * desc->entry_struct_size;
+	for (i = 0; i < desc->entry_struct_size; i++) {
+		if (sscanf(field_val + 2 * i, "%2x", &byte) != 1) {
+			loge("Invalid %s", ENTRY_BYTES);
+			return -EINVAL;
+		}
+		entry[i] = byte;
+	}
+	return 0;
+}
+
+/* Records how to bring a table back to its current entry count */
+static int
+change_log_entry_count(struct sja1105_static_config *config, int match,
+                       char *field_val)
+{
+	const struct sja1105_table_desc *desc;
+	uint64_t new_count;
+	char    *value;
+	char    *entry;
+	char     old_count[32];
+	int      entry_count;
+	int      blk_idx;
+	int      i;
+	size_t   j;
+	int      rc;
+
+	blk_idx = sja1105_blk_idx_from_id(blk_ids[match]);
+	if (blk_idx < 0) {
+		return 0;
+	}
+	desc = sja1105_table_desc_get(blk_idx);
+	entry_count = *(int*) ((char*) config + desc->count_offset);
+	rc = reliable_uint64_from_string(&new_count, field_val, NULL);
+	if (rc < 0) {
+		return rc;
+	}
+	value = malloc(2 * desc->entry_struct_size + 1);
+	if (value == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	for (i = (new_count < (uint64_t) entry_count) ? (int) new_count :
+	     entry_count; i < entry_count; i++) {
+		entry = (char*) config + desc->array_offset +
+		        i * desc->entry_struct_size;
+		for (j = 0; j < desc->entry_struct_size; j++) {
+			sprintf(value + 2 * j, "%02x", (uint8_t) entry[j]);
+		}
+		change_log_append(static_config_options[match], i,
+		                  ENTRY_BYTES, value);
+	}
+	free(value);
+	snprintf(old_count, sizeof(old_count), "%d", entry_count);
+	change_log_append(static_config_options[match], -1,
+	                  "entry-count", old_count);
+	return change_log.error;
+}
+
+/* Every change to an entry of a table goes through here */
+static int
+modify_table_entry(struct sja1105_static_config *config, int match,
+                   int entry_index, char *field_name, char *field_val)
+{
+	int rc;
+
+	if (change_log.active) {
+		change_log.table_name  = static_config_options[match];
+		change_log.entry_index = entry_index;
+		change_log.field_name  = field_name;
+		if (matches(field_name, "entry-count") == 0) {
+			rc = change_log_entry_count(config, match, field_val);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+	}
+	return next_static_table_modify[match](config, entry_index,
+	                                       field_name, field_val);
+}
+
+/*
+ * What is between the brackets after the table name:
+ * - an index list, made of indices and inclusive ranges separated
+ *   by commas: "5", "0-4095", "0,8,16", "0-3,10"
+ * - or a predicate on fields of the entry: "vlanid>=100". Several
+ *   conditions separated by commas must all hold:
+ *   "macaddr=00:04:9f:00:00:01,vlanid=1".
+ *   The operators are ==, =, !=, <, <=, > and >=.
+ *   When the predicate is prefixed with '+' and only made of
+ *   equalities, an entry holding that key is appended to the table
+ *   if none matches: "+vlanid=100".
+ */
+#define MODIFY_MAX_RANGES 256
+#define MODIFY_MAX_CONDS  4
+
+enum modify_op {
+	MODIFY_OP_EQ,
+	MODIFY_OP_NE,
+	MODIFY_OP_LT,
+	MODIFY_OP_LE,
+	MODIFY_OP_GT,
+	MODIFY_OP_GE,
+};
+
+/* Keys that are not fields of the entry, but follow from its index */
+enum modify_key {
+	MODIFY_KEY_FIELD = 0,
+	MODIFY_KEY_PORT,
+	MODIFY_KEY_PRIO,
+};
+
+struct modify_cond {
+	char          *field_name;
+	enum modify_key key;
+	enum modify_op op;
+	uint64_t       value;
+	/* Address of the field in entry 0 */
+	uint64_t      *field_addr;
+};
+
+struct modify_selector {
+	int is_predicate;
+	int insert;
+	/* Index list */
+	int range_count;
+	struct {
+		uint64_t first;
+		uint64_t last;
+	} ranges[MODIFY_MAX_RANGES];
+	/* Predicate */
+	int cond_count;
+	struct modify_cond conds[MODIFY_MAX_CONDS];
+};
+
+/* Names by which the keys of some tables are better known */
+static const struct {
+	table_modify_fn table_modify;
+	const char     *alias;
+	const char     *field_name;
+	enum modify_key key;
+} modify_key_aliases[] = {
+	{l2_lookup_table_entry_modify,   "mac",  "macaddr", MODIFY_KEY_FIELD},
+	{l2_lookup_table_entry_modify,   "vid",  "vlanid",  MODIFY_KEY_FIELD},
+	{vlan_lookup_table_entry_modify, "vid",  "vlanid",  MODIFY_KEY_FIELD},
+	{l2_policing_table_entry_modify, "port", NULL,      MODIFY_KEY_PORT},
+	{l2_policing_table_entry_modify, "prio", NULL,      MODIFY_KEY_PRIO},
+};
+
+static int
+modify_cond_parse(char *str, struct modify_cond *cond)
+{
+	const struct {
+		const char    *name;
+		enum modify_op op;
+	} ops[] = {
+		/* Two-character operators first */
+		{"==", MODIFY_OP_EQ},
+		{"!=", MODIFY_OP_NE},
+		{"<=", MODIFY_OP_LE},
+		{">=", MODIFY_OP_GE},
+		{"=",  MODIFY_OP_EQ},
+		{"<",  MODIFY_OP_LT},
+		{">",  MODIFY_OP_GT},
+	};
+	char *op_ptr = str + strcspn(str, "=!<>");
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (strncmp(op_ptr, ops[i].name, strlen(ops[i].name)) == 0) {
+			break;
+		}
+	}
+	if (i == ARRAY_SIZE(ops)) {
+		loge("Invalid operator in \"%s\"", str);
+		return -EINVAL;
+	}
+	cond->op = ops[i].op;
+	rc = reliable_uint64_from_string(&cond->value, trimwhitespace(
+	                                 op_ptr + strlen(ops[i].name)), NULL);
+	if (rc < 0) {
+		loge("Invalid value in \"%s\"", str);
+		return rc;
+	}
+	*op_ptr = '\0';
+	cond->field_name = trimwhitespace(str);
+	if (matches(cond->field_name, "entry-count") == 0) {
+		loge("entry-count cannot be used in a predicate");
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int
+modify_predicate_parse(char *str, struct modify_selector *sel)
+{
+	char *item;
+	int rc;
+
+	sel->is_predicate = 1;
+	for (item = strtok(str, ","); item; item = strtok(NULL, ",")) {
+		if (sel->cond_count == MODIFY_MAX_CONDS) {
+			loge("No more than %d conditions may be given",
+			     MODIFY_MAX_CONDS);
+			return -ERANGE;
+		}
+		rc = modify_cond_parse(item, &sel->conds[sel->cond_count++]);
+		if (rc < 0) {
+			return rc;
+		}
+	}
+	if (sel->cond_count == 0) {
+		loge("Empty predicate");
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int
+modify_index_list_parse(char *str, struct modify_selector *sel)
+{
+	char *item;
+	char *p;
+	int rc;
+
+	for (item = strtok(str, ","); item; item = strtok(NULL, ",")) {
+		if (sel->range_count == MODIFY_MAX_RANGES) {
+			loge("No more than %d indices or ranges may be given",
+			     MODIFY_MAX_RANGES);
+			return -ERANGE;
+		}
+		rc = reliable_uint64_from_string(
+		        &sel->ranges[sel->range_count].first, item, &p);
+		if (rc < 0) {
+			goto parse_error;
+		}
+		p = trimwhitespace(p);
+		if (*p == '-') {
+			rc = reliable_uint64_from_string(
+			        &sel->ranges[sel->range_count].last, p + 1, NULL);
+			if (rc < 0) {
+				goto parse_error;
+			}
+		} else if (*p == '\0') {
+			sel->ranges[sel->range_count].last =
+			        sel->ranges[sel->range_count].first;
+		} else {
+			goto parse_error;
+		}
+		if (sel->ranges[sel->range_count].last <
+		    sel->ranges[sel->range_count].first) {
+			goto parse_error;
+		}
+		sel->range_count++;
+	}
+	if (sel->range_count == 0) {
+		goto parse_error;
+	}
+	return 0;
+parse_error:
+	loge("Invalid entry index \"%s\"", item ? item : str);
+	return -EINVAL;
+}
+
+/* Cuts the selector off table_name, which then only holds the name */
+static int modify_selector_parse(char *table_name, struct modify_selector *sel)
+{
+	char *start = strchr(table_name, '[');
+	char *end;
+
+	memset(sel, 0, sizeof(*sel));
+	if (start == NULL) {
+		/* Entry 0 */
+		sel->range_count = 1;
+		return 0;
+	}
+	*start++ = '\0';
+	end = strrchr(start, ']');
+	if (end == NULL || end[1] != '\0') {
+		loge("Entry index must be enclosed in brackets");
+		return -EINVAL;
+	}
+	*end = '\0';
+	if (*start == '+') {
+		sel->insert = 1;
+		start++;
+	}
+	if (start[strcspn(start, "=!<>")] != '\0') {
+		return modify_predicate_parse(start, sel);
+	}
+	if (sel->insert) {
+		loge("Only a key can be inserted, not an index");
+		return -EINVAL;
+	}
+	return modify_index_list_parse(start, sel);
+}
+
+/* Turns aliases into field names and finds where the fields are */
+static int
+modify_predicate_resolve(table_modify_fn table_modify,
+                         struct sja1105_static_config *config,
+                         struct modify_selector *sel)
+{
+	struct modify_cond *cond;
+	unsigned int j;
+	int i, rc;
+
+	for (i = 0; i < sel->cond_count; i++) {
+		cond = &sel->conds[i];
+		for (j = 0; j < ARRAY_SIZE(modify_key_aliases); j++) {
+			if (modify_key_aliases[j].table_modify == table_modify &&
+			    strcmp(modify_key_aliases[j].alias,
+			           cond->field_name) == 0) {
+				break;
+			}
+		}
+		if (j < ARRAY_SIZE(modify_key_aliases)) {
+			cond->key = modify_key_aliases[j].key;
+			if (cond->key != MODIFY_KEY_FIELD) {
+				continue;
+			}
+			cond->field_name = (char*) modify_key_aliases[j].field_name;
+		}
+		field_probe.active = 1;
+		rc = table_modify(config, 0, cond->field_name, "0");
+		field_probe.active = 0;
+		if (rc < 0) {
+			loge("Unknown field %s", cond->field_name);
+			return rc;
+		}
+		if (field_probe.field_count != 1) {
+			loge("Array field %s cannot be used in a predicate",
+			     cond->field_name);
+			return -EINVAL;
+		}
+		cond->field_addr = field_probe.field_addr;
+	}
+	return 0;
+}
+
+/* Returns 0 if the entry has no such key */
+static int
+modify_cond_value(const struct modify_cond *cond, int entry_index,
+                  size_t entry_size, uint64_t *value)
+{
+	const int prio_policers = SJA1105_NUM_PORTS * SJA1105_NUM_TC;
+
+	switch (cond->key) {
+	case MODIFY_KEY_PORT:
+		/* The per-priority policers of each port come first,
+		 * followed by the broadcast policer of each port */
+		if (entry_index < prio_policers) {
+			*value = entry_index / SJA1105_NUM_TC;
+		} else {
+			*value = entry_index - prio_policers;
+		}
+		return 1;
+	case MODIFY_KEY_PRIO:
+		if (entry_index >= prio_policers) {
+			return 0;
+		}
+		*value = entry_index % SJA1105_NUM_TC;
+		return 1;
+	case MODIFY_KEY_FIELD:
+	default:
+		*value = *(uint64_t*) ((char*) cond->field_addr +
+		                       entry_index * entry_size);
+		return 1;
+	}
+}
+
+/* Returns 1 if the entry satisfies all conditions, 0 if not */
+static int
+modify_predicate_eval(const struct modify_selector *sel, int entry_index,
+                      size_t entry_size)
+{
+	const struct modify_cond *cond;
+	uint64_t value;
+	int i, holds;
+
+	for (i = 0; i < sel->cond_count; i++) {
+		cond = &sel->conds[i];
+		if (!modify_cond_value(cond, entry_index, entry_size, &value)) {
+			return 0;
+		}
+		switch (cond->op) {
+		case MODIFY_OP_EQ: holds = (value == cond->value); break;
+		case MODIFY_OP_NE: holds = (value != cond->value); break;
+		case MODIFY_OP_LT: holds = (value <  cond->value); break;
+		case MODIFY_OP_LE: holds = (value <= cond->value); break;
+		case MODIFY_OP_GT: holds = (value >  cond->value); break;
+		case MODIFY_OP_GE: holds = (value >= cond->value); break;
+		default:           holds = 0;
+		}
+		if (!holds) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Hash index of a table on the fields of a key (a predicate made only
+ * of equalities on fields), so that looking up an entry by its key
+ * does not scan the table. There is one per table, built on the first
+ * lookup by key and kept while the tool runs (config modify --batch,
+ * journal replay) until the entry count or one of the key fields of
+ * that table is modified. Entries holding the same key are chained in
+ * index order.
+ */
+struct modify_key_index {
+	int       valid;
+	struct sja1105_static_config *config;
+	int       entry_count;
+	int       field_count;
+	/* Addresses in entry 0, in increasing order */
+	uint64_t *field_addrs[MODIFY_MAX_CONDS];
+	int       bucket_count;
+	int      *buckets;
+	int      *next;
+};
+
+static struct modify_key_index modify_key_indexes[BLK_IDX_MAX];
+
+static uint64_t
+modify_key_hash(uint64_t *values, int count)
+{
+	return sja1105_fnv1a64(values, count * sizeof(*values));
+}
+
+static uint64_t
+modify_key_index_entry_hash(struct modify_key_index *index, int entry_index,
+                            size_t entry_size)
+{
+	uint64_t values[MODIFY_MAX_CONDS];
+	int i;
+
+	for (i = 0; i < index->field_count; i++) {
+		values[i] = *(uint64_t*) ((char*) index->field_addrs[i] +
+		                          entry_index * entry_size);
+	}
+	return modify_key_hash(values, index->field_count);
+}
+
+static int
+modify_key_index_build(struct modify_key_index *index,
+                       struct sja1105_static_config *config,
+                       uint64_t **field_addrs, int field_count,
+                       int entry_count, size_t entry_size)
+{
+	int bucket;
+	int i;
+
+	free(index->buckets);
+	free(index->next);
+	memset(index, 0, sizeof(*index));
+	index->bucket_count = 16;
+	while (index->bucket_count < 2 * entry_count) {
+		index->bucket_count <<= 1;
+	}
+	index->buckets = malloc(index->bucket_count * sizeof(int));
+	index->next = malloc((entry_count + 1) * sizeof(int));
+	if (index->buckets == NULL || index->next == NULL) {
+		loge("malloc failed");
+		free(index->buckets);
+		free(index->next);
+		memset(index, 0, sizeof(*index));
+		return -ENOMEM;
+	}
+	memset(index->buckets, -1, index->bucket_count * sizeof(int));
+	index->config = config;
+	index->entry_count = entry_count;
+	index->field_count = field_count;
+	memcpy(index->field_addrs, field_addrs,
+	       field_count * sizeof(*field_addrs));
+	/* Going backwards leaves the chains in index order */
+	for (i = entry_count - 1; i >= 0; i--) {
+		bucket = modify_key_index_entry_hash(index, i, entry_size) &
+		         (index->bucket_count - 1);
+		index->next[i] = index->buckets[bucket];
+		index->buckets[bucket] = i;
+	}
+	index->valid = 1;
+	logv("Built key index of %d entries", entry_count);
+	return 0;
+}
+
+/* Forget the index of a table whose key may have been modified */
+static void
+modify_key_index_invalidate(int blk_idx, table_modify_fn table_modify,
+                            struct sja1105_static_config *config,
+                            char *field_name)
+{
+	struct modify_key_index *index;
+	uint64_t *first, *last;
+	int rc, i;
+
+	if (blk_idx < 0 || !modify_key_indexes[blk_idx].valid) {
+		return;
+	}
+	index = &modify_key_indexes[blk_idx];
+	if (matches(field_name, "entry-count") != 0) {
+		field_probe.active = 1;
+		rc = table_modify(config, 0, field_name, "0");
+		field_probe.active = 0;
+		if (rc >= 0) {
+			first = field_probe.field_addr;
+			last  = first + field_probe.field_count - 1;
+			for (i = 0; i < index->field_count; i++) {
+				if (index->field_addrs[i] >= first &&
+				    index->field_addrs[i] <= last) {
+					break;
+				}
+			}
+			if (i == index->field_count) {
+				/* Not a key field */
+				return;
+			}
+		}
+	}
+	index->valid = 0;
+}
+
+/* Fills indices with the entries that hold the key, in index order,
+ * and returns how many there are */
+static int
+modify_key_lookup(int blk_idx, struct sja1105_static_config *config,
+                  int entry_count, size_t entry_size,
+                  struct modify_selector *sel, int *indices)
+{
+	struct modify_key_index *index = &modify_key_indexes[blk_idx];
+	uint64_t *field_addrs[MODIFY_MAX_CONDS];
+	uint64_t  values[MODIFY_MAX_CONDS];
+	uint64_t *tmp_addr;
+	uint64_t  tmp_value;
+	int count = 0;
+	int i, j, rc;
+
+	/* Sorted by address, the fields of a key are the same
+	 * whatever the order they were given in */
+	for (i = 0; i < sel->cond_count; i++) {
+		field_addrs[i] = sel->conds[i].field_addr;
+		values[i] = sel->conds[i].value;
+		for (j = i; j > 0 && field_addrs[j] < field_addrs[j - 1]; j--) {
+			tmp_addr = field_addrs[j];
+			field_addrs[j] = field_addrs[j - 1];
+			field_addrs[j - 1] = tmp_addr;
+			tmp_value = values[j];
+			values[j] = values[j - 1];
+			values[j - 1] = tmp_value;
+		}
+	}
+	if (!index->valid || index->config != config ||
+	    index->entry_count != entry_count ||
+	    index->field_count != sel->cond_count ||
+	    memcmp(index->field_addrs, field_addrs,
+	           sel->cond_count * sizeof(*field_addrs)) != 0) {
+		rc = modify_key_index_build(index, config, field_addrs,
+		                            sel->cond_count, entry_count,
+		                            entry_size);
+		if (rc < 0) {
+			return rc;
+		}
+	}
+	i = index->buckets[modify_key_hash(values, sel->cond_count) &
+	                   (index->bucket_count - 1)];
+	for (; i >= 0; i = index->next[i]) {
+		/* Other keys may share the bucket */
+		if (modify_predicate_eval(sel, i, entry_size)) {
+			indices[count++] = i;
+		}
+	}
+	return count;
+}
+
+/* Same as modify_key_lookup, for any predicate */
+static int
+modify_predicate_lookup(int blk_idx, struct sja1105_static_config *config,
+                        int entry_count, size_t entry_size,
+                        struct modify_selector *sel, int *indices)
+{
+	int is_key = 1;
+	int port = -1;
+	int prio = -1;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < sel->cond_count; i++) {
+		if (sel->conds[i].op != MODIFY_OP_EQ) {
+			is_key = 0;
+		} else if (sel->conds[i].key == MODIFY_KEY_PORT) {
+			port = i;
+		} else if (sel->conds[i].key == MODIFY_KEY_PRIO) {
+			prio = i;
+		}
+		if (sel->conds[i].key != MODIFY_KEY_FIELD) {
+			is_key = 0;
+		}
+	}
+	if (is_key) {
+		return modify_key_lookup(blk_idx, config, entry_count,
+		                         entry_size, sel, indices);
+	}
+	if (port >= 0 && prio >= 0) {
+		/* The index of a policer follows from its port and priority */
+		if (sel->conds[port].value < SJA1105_NUM_PORTS &&
+		    sel->conds[prio].value < SJA1105_NUM_TC) {
+			i = sel->conds[port].value * SJA1105_NUM_TC +
+			    sel->conds[prio].value;
+			if (i < entry_count &&
+			    modify_predicate_eval(sel, i, entry_size)) {
+				indices[count++] = i;
+			}
+		}
+		return count;
+	}
+	/* One pass over the table */
+	for (i = 0; i < entry_count; i++) {
+		if (modify_predicate_eval(sel, i, entry_size)) {
+			indices[count++] = i;
+		}
+	}
+	return count;
+}
+
+/* Appends an entry holding the key of the predicate.
+ * Returns its index. */
+static int
+modify_key_insert(struct sja1105_static_config *config, int match,
+                  const struct sja1105_table_desc *desc,
+                  struct modify_selector *sel)
+{
+	int *entry_count = (int*) ((char*) config + desc->count_offset);
+	char value[32];
+	int rc, i;
+
+	for (i = 0; i < sel->cond_count; i++) {
+		if (sel->conds[i].op != MODIFY_OP_EQ ||
+		    sel->conds[i].key != MODIFY_KEY_FIELD) {
+			loge("Only a key made of field equalities can be inserted");
+			return -EINVAL;
+		}
+	}
+	if (*entry_count >= desc->max_count) {
+		loge("%s is full (%d entries)", static_config_options[match],
+		     desc->max_count);
+		return -ERANGE;
+	}
+	if (change_log.active) {
+		snprintf(value, sizeof(value), "%d", *entry_count);
+		change_log_append(static_config_options[match], -1,
+		                  "entry-count", value);
+	}
+	memset((char*) config + desc->array_offset +
+	       *entry_count * desc->entry_struct_size, 0,
+	       desc->entry_struct_size);
+	(*entry_count)++;
+	for (i = 0; i < sel->cond_count; i++) {
+		snprintf(value, sizeof(value), "0x%" PRIx64, sel->conds[i].value);
+		rc = modify_table_entry(config, match, *entry_count - 1,
+		                        sel->conds[i].field_name, value);
+		if (rc < 0) {
+			(*entry_count)--;
+			return rc;
+		}
+	}
+	logv("Inserted entry %d in %s", *entry_count - 1,
+	     static_config_options[match]);
+	return *entry_count - 1;
+}
+
+/* Finds the entries of the table selected by a predicate, inserting
+ * one if asked to. *indices is allocated and must be freed by the
+ * caller. Returns the number of entries. */
+static int
+modify_predicate_select(struct sja1105_static_config *static_config,
+                        int match, struct modify_selector *sel,
+                        int **indices)
+{
+	const struct sja1105_table_desc *desc;
+	int blk_idx;
+	int entry_count;
+	int count;
+	int rc;
+
+	*indices = NULL;
+	blk_idx = sja1105_blk_idx_from_id(blk_ids[match]);
+	if (blk_idx < 0) {
+		loge("Entries of %s cannot be selected",
+		     static_config_options[match]);
+		return -EINVAL;
+	}
+	desc = sja1105_table_desc_get(blk_idx);
+	entry_count = *(int*) ((char*) static_config + desc->count_offset);
+	rc = modify_predicate_resolve(next_static_table_modify[match],
+	                              static_config, sel);
+	if (rc < 0) {
+		return rc;
+	}
+	/* Room for one inserted entry */
+	*indices = malloc((entry_count + 1) * sizeof(int));
+	if (*indices == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	count = modify_predicate_lookup(blk_idx, static_config, entry_count,
+	                                desc->entry_struct_size, sel, *indices);
+	if (count == 0 && sel->insert) {
+		rc = modify_key_insert(static_config, match, desc, sel);
+		if (rc < 0) {
+			count = rc;
+		} else {
+			(*indices)[count++] = rc;
+			modify_key_index_invalidate(blk_idx,
+			                            next_static_table_modify[match],
+			                            static_config, "entry-count");
+		}
+	}
+	if (count < 0) {
+		free(*indices);
+		*indices = NULL;
+	}
+	return count;
+}
+
 int
 staging_area_modify(struct sja1105_staging_area *staging_area,
                     char *table_name,
                     char *field_name,
                     char *field_val)
 {
-	const char *static_config_options[] = {
-		"schedule-table",
-		"schedule-entry-points-table",
-		"vl-lookup-table",
-		"vl-policing-table",
-		"vl-forwarding-table",
-		"l2-address-lookup-table",
-		"l2-policing-table",
-		"vlan-lookup-table",
-		"l2-forwarding-table",
-		"mac-configuration-table",
-		"schedule-parameters-table",
-		"schedule-entry-points-parameters-table",
-		"vl-forwarding-parameters-table",
-		"l2-address-lookup-parameters-table",
-		"l2-forwarding-parameters-table",
-		"clock-synchronization-parameters-table",
-		"avb-parameters-table",
-		"general-parameters-table",
-		"xmii-mode-parameters-table",
-		"sgmii-table",
-	};
-	int (*next_static_table_modify[])(struct sja1105_static_config*, \
-	                                  int, char*, char*) = {
-		schedule_table_entry_modify,
-		schedule_entry_points_table_entry_modify,
-		vl_lookup_table_entry_modify,
-		vl_policing_table_entry_modify,
-		vl_fw_table_entry_modify,
-		l2_lookup_table_entry_modify,
-		l2_policing_table_entry_modify,
-		vlan_lookup_table_entry_modify,
-		l2_fw_table_entry_modify,
-		mac_config_table_entry_modify,
-		schedule_params_table_entry_modify,
-		schedule_entry_points_params_table_entry_modify,
-		vl_fw_params_table_entry_modify,
-		l2_lookup_params_table_entry_modify,
-		l2_fw_params_table_entry_modify,
-		clock_sync_params_table_entry_modify,
-		avb_params_table_entry_modify,
-		general_params_table_entry_modify,
-		xmii_table_entry_modify,
-		sgmii_table_entry_modify,
-	};
 	struct   sja1105_static_config *static_config;
+	struct   modify_selector sel;
 	uint64_t entry_index;
-	char    *index_ptr;
+	int      entry_count;
+	int      modified = 0;
+	int     *indices = NULL;
+	int      match;
 	int      rc;
+	int      i;
 
 	static_config = &staging_area->static_config;
 
-	index_ptr = strchr(table_name, '[');
-	if (index_ptr == NULL) {
-		entry_index = 0;
-	} else {
-		/* Little trick to reuse the code, since the index
-		 * is surrounded by [ ], same as an array would be */
-		rc = read_array(index_ptr, &entry_index, 1);
-		if (rc < 0) {
-			goto out;
-		}
-		/* So we only match on the table field_name, but not on the entry index */
-		*index_ptr = '\0';
+	rc = modify_selector_parse(table_name, &sel);
+	if (rc < 0) {
+		goto out;
 	}
+	entry_index = sel.ranges[0].first;
 	rc = get_match(table_name, static_config_options,
 	               ARRAY_SIZE(static_config_options));
 	if (rc < 0) {
@@ -1089,12 +1978,125 @@ staging_area_modify(struct sja1105_staging_area *staging_area,
 		printf("Please supply a value for field %s!\n", field_name);
 		goto out;
 	}
-	rc = next_static_table_modify[rc](static_config, entry_index,
-	                                  field_name, field_val);
+	match = rc;
+	if (staging_area == NULL) {
+		/* Called by staging_area_modify_parse only to list the
+		 * fields of the table: there are no entries to select */
+		rc = next_static_table_modify[match](static_config, entry_index,
+		                                     field_name, field_val);
+		goto out;
+	}
+	rc = staging_area_table_get(staging_area, blk_ids[match]);
+	if (rc < 0) {
+		goto out;
+	}
+	if (strcmp(field_name, ENTRY_BYTES) == 0) {
+		if (sel.is_predicate || sel.range_count != 1 ||
+		    sel.ranges[0].first != sel.ranges[0].last) {
+			loge("%s takes a single entry index", ENTRY_BYTES);
+			rc = -EINVAL;
+			goto out;
+		}
+		rc = modify_entry_bytes(static_config, match, entry_index,
+		                        field_val);
+		goto out_invalidate;
+	}
+	if (!sel.is_predicate && (matches(field_name, "entry-count") == 0 ||
+	    (sel.range_count == 1 && sel.ranges[0].first == sel.ranges[0].last))) {
+		/* A single entry, or the table itself */
+		rc = modify_table_entry(static_config, match, entry_index,
+		                        field_name, field_val);
+		if (rc < 0) {
+			loge("modify failed!");
+		}
+		goto out_invalidate;
+	}
+	if (sel.is_predicate) {
+		rc = modify_predicate_select(static_config, match, &sel,
+		                             &indices);
+		if (rc < 0) {
+			goto out;
+		}
+		entry_count = rc;
+		for (i = 0; i < entry_count; i++) {
+			rc = modify_table_entry(static_config, match,
+			                        indices[i], field_name,
+			                        field_val);
+			if (rc < 0) {
+				loge("modify failed at entry %d!", indices[i]);
+				goto out_invalidate;
+			}
+			modified++;
+		}
+	} else {
+		entry_count = *(int*) ((char*) static_config +
+		              sja1105_table_desc_get(sja1105_blk_idx_from_id(
+		              blk_ids[match]))->count_offset);
+		/* Nothing is changed unless all entries exist */
+		for (i = 0; i < sel.range_count; i++) {
+			if (sel.ranges[i].last >= (uint64_t) entry_count) {
+				loge("Index %" PRIu64 " out of bounds, %s has "
+				     "%d entries", sel.ranges[i].last,
+				     static_config_options[match], entry_count);
+				rc = -ERANGE;
+				goto out;
+			}
+		}
+		for (i = 0; i < sel.range_count; i++) {
+			for (entry_index = sel.ranges[i].first;
+			     entry_index <= sel.ranges[i].last; entry_index++) {
+				rc = modify_table_entry(static_config, match,
+				                        entry_index, field_name,
+				                        field_val);
+				if (rc < 0) {
+					loge("modify failed at entry %" PRIu64 "!",
+					     entry_index);
+					goto out_invalidate;
+				}
+				modified++;
+			}
+		}
+	}
+	logv("%d entries modified", modified);
+	rc = 0;
+out_invalidate:
+	modify_key_index_invalidate(sja1105_blk_idx_from_id(blk_ids[match]),
+	                            next_static_table_modify[match],
+	                            static_config, field_name);
+out:
+	free(indices);
+	return rc;
+}
+
+int staging_area_select(struct sja1105_staging_area *staging_area,
+                        char *table_name, int **indices)
+{
+	struct modify_selector sel;
+	int match;
+	int rc;
+
+	*indices = NULL;
+	rc = modify_selector_parse(table_name, &sel);
+	if (rc < 0) {
+		goto out;
+	}
+	if (!sel.is_predicate || sel.insert) {
+		loge("A key such as %s[vlanid=100] is expected", table_name);
+		rc = -EINVAL;
+		goto out;
+	}
+	rc = get_match(table_name, static_config_options,
+	               ARRAY_SIZE(static_config_options));
 	if (rc < 0) {
-		loge("modify failed!");
 		goto out;
 	}
+	match = rc;
+	rc = staging_area_table_get(staging_area, blk_ids[match]);
+	if (rc < 0) {
+		goto out;
+	}
+	rc = modify_predicate_select(&staging_area->static_config, match,
+	                             &sel, indices);
 out:
 	return rc;
 }
@@ -1135,3 +2137,94 @@ out:
 	return rc;
 }
 
+/* Split a "<table>[<index>] <field> <value>" line in place. The value
+ * is the rest of the line, so that arrays need no quotes, but quotes
+ * around it are accepted the same, as found in shell scripts. */
+static int modify_line_split(char *line, char **table_name,
+                             char **field_name, char **field_val)
+{
+	char *p = line;
+	size_t len;
+
+	*table_name = p + strspn(p, " \t");
+	p = *table_name + strcspn(*table_name, " \t");
+	if (*p == '\0') {
+		return -EINVAL;
+	}
+	*p++ = '\0';
+	*field_name = p + strspn(p, " \t");
+	p = *field_name + strcspn(*field_name, " \t");
+	if (*p == '\0') {
+		return -EINVAL;
+	}
+	*p++ = '\0';
+	*field_val = p + strspn(p, " \t");
+	len = strlen(*field_val);
+	while (len && strchr(" \t\r\n", (*field_val)[len - 1])) {
+		(*field_val)[--len] = '\0';
+	}
+	if (len >= 2 && (*field_val)[0] == '"' && (*field_val)[len - 1] == '"') {
+		(*field_val)[len - 1] = '\0';
+		(*field_val)++;
+		len -= 2;
+	}
+	return len ? 0 : -EINVAL;
+}
+
+/*
+ * Apply the modify commands read from file_name ("-" for stdin), one
+ * "<table>[<index>] <field> <value>" per line, to the staging area in
+ * memory. Blank lines and lines starting with '#' are skipped.
+ * Stops at the first command that fails.
+ * Returns the number of commands applied, or a negative error code.
+ */
+int staging_area_modify_batch(struct sja1105_staging_area *staging_area,
+                              const char *file_name)
+{
+	char line[MAX_LINE_SIZE];
+	char *table_name;
+	char *field_name;
+	char *field_val;
+	char *p;
+	FILE *fp;
+	int   line_no = 0;
+	int   count = 0;
+	int   rc = 0;
+
+	if (strcmp(file_name, "-") == 0) {
+		fp = stdin;
+	} else {
+		fp = fopen(file_name, "r");
+		if (fp == NULL) {
+			loge("could not open %s", file_name);
+			return -errno;
+		}
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		line_no++;
+		p = line + strspn(line, " \t\r\n");
+		if (*p == '\0' || *p == '#') {
+			continue;
+		}
+		rc = modify_line_split(p, &table_name, &field_name, &field_val);
+		if (rc < 0) {
+			loge("%s:%d: expected <table>[<index>] <field> <value>",
+			     file_name, line_no);
+			goto out;
+		}
+		rc = staging_area_modify(staging_area, table_name,
+		                         field_name, field_val);
+		if (rc < 0) {
+			loge("%s:%d: modify failed", file_name, line_no);
+			goto out;
+		}
+		count++;
+	}
+	logv("%d modify commands applied from %s", count, file_name);
+	rc = count;
+out:
+	if (fp != stdin) {
+		fclose(fp);
+	}
+	return rc;
+}
@@ -164,17 +164,47 @@ sja1105_staging_area_show(struct sja1105_staging_area *staging_area,
 		xmii_params_table_show,
 		sgmii_table_show,
 	};
+	/* Block ID of each of the tables above */
+	const uint64_t blk_ids[] = {
+		BLKID_SCHEDULE_TABLE,
+		BLKID_SCHEDULE_ENTRY_POINTS_TABLE,
+		BLKID_VL_LOOKUP_TABLE,
+		BLKID_VL_POLICING_TABLE,
+		BLKID_VL_FORWARDING_TABLE,
+		BLKID_L2_LOOKUP_TABLE,
+		BLKID_L2_POLICING_TABLE,
+		BLKID_VLAN_LOOKUP_TABLE,
+		BLKID_L2_FORWARDING_TABLE,
+		BLKID_MAC_CONFIG_TABLE,
+		BLKID_SCHEDULE_PARAMS_TABLE,
+		BLKID_SCHEDULE_ENTRY_POINTS_PARAMS_TABLE,
+		BLKID_VL_FORWARDING_PARAMS_TABLE,
+		BLKID_L2_LOOKUP_PARAMS_TABLE,
+		BLKID_L2_FORWARDING_PARAMS_TABLE,
+		BLKID_CLK_SYNC_PARAMS_TABLE,
+		BLKID_AVB_PARAMS_TABLE,
+		BLKID_GENERAL_PARAMS_TABLE,
+		BLKID_XMII_MODE_PARAMS_TABLE,
+		BLKID_SGMII_TABLE,
+	};
 	struct sja1105_static_config *static_config;
 	char *index_ptr;
 	uint64_t entry_index_u64;
 	int entry_index;
+	int entry_count;
+	int *indices = NULL;
+	size_t name_len;
 	unsigned int i;
+	int match;
 	int rc = 0;
 
 	static_config = &staging_area->static_config;
 
 	if (table_name == NULL || strlen(table_name) == 0) {
 		logv("Showing all config tables");
+		rc = staging_area_tables_get_all(staging_area);
+		if (rc < 0)
+			goto out;
 		printf("Device ID is 0x%08" PRIx64 " (%s)\n",
 		       static_config->device_id, sja1105_device_id_string_get(
 		       static_config->device_id, SJA1105_PART_NR_DONT_CARE));
@@ -183,6 +213,32 @@ sja1105_staging_area_show(struct sja1105_staging_area *staging_area,
 			if (rc < 0)
 				goto out;
 		}
+	} else if (strpbrk(table_name, "=!<>") != NULL) {
+		/* Entries given by their key */
+		index_ptr = strchr(table_name, '[');
+		name_len = index_ptr ? (size_t) (index_ptr - table_name) : 0;
+		rc = staging_area_select(staging_area, table_name, &indices);
+		if (rc <= 0) {
+			if (rc == 0) {
+				loge("No entry of %.*s matches", (int) name_len,
+				     table_name);
+				rc = -EINVAL;
+			}
+			goto out;
+		}
+		entry_count = rc;
+		rc = get_match(table_name, options, ARRAY_SIZE(options));
+		if (rc < 0) {
+			goto out;
+		}
+		match = rc;
+		for (i = 0; i < (unsigned int) entry_count; i++) {
+			rc = next_config_table_show[match](static_config,
+			                                   indices[i]);
+			if (rc < 0) {
+				goto out;
+			}
+		}
 	} else {
 		index_ptr = strchr(table_name, '[');
 		if (index_ptr == NULL) {
@@ -205,9 +261,15 @@ sja1105_staging_area_show(struct sja1105_staging_area *staging_area,
 		if (rc < 0) {
 			goto out;
 		}
-		rc = next_config_table_show[rc](static_config, entry_index);
+		match = rc;
+		rc = staging_area_table_get(staging_area, blk_ids[match]);
+		if (rc < 0) {
+			goto out;
+		}
+		rc = next_config_table_show[match](static_config, entry_index);
 	}
 out:
+	free(indices);
 	return rc;
 }
 
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/status.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+#define WATCHDOG_MIN_PERIOD_MS 10
+#define WATCHDOG_MAX_PERIOD_MS 1000
+/* Periods are kept in microseconds, in an unsigned int that must
+ * also hold twice the largest one */
+#define WATCHDOG_PERIOD_LIMIT_MS 1000000
+
+static int
+watchdog_option_get(int *argc, char ***argv, const char *short_opt,
+                    const char *long_opt, uint64_t *value)
+{
+	if (*argc < 2 || (strcmp((*argv)[0], short_opt) != 0 &&
+	                  strcmp((*argv)[0], long_opt) != 0)) {
+		return 0;
+	}
+	if (reliable_uint64_from_string(value, (*argv)[1], NULL) < 0) {
+		loge("Invalid value \"%s\" for %s", (*argv)[1], long_opt);
+		return -EINVAL;
+	}
+	*argc -= 2;
+	*argv += 2;
+	return 1;
+}
+
+/* The switch lost or corrupted its configuration: upload again the
+ * last one it had accepted, which is kept ready to send. */
+static int
+watchdog_recover(struct sja1105_spi_setup *spi_setup,
+                 struct sja1105_watchdog *wd, int fault)
+{
+	uint64_t detected_us = sja1105_time_us();
+	uint64_t recovered_us;
+	int rc;
+
+	logi("watchdog: %s, detected at most %" PRIu64 " us after "
+	     "the last healthy poll", sja1105_watchdog_fault_string(fault),
+	     detected_us - wd->last_ok_us);
+	rc = staging_area_rollback(spi_setup);
+	recovered_us = sja1105_time_us();
+	if (rc < 0) {
+		loge("watchdog: recovery failed after %" PRIu64 " us",
+		     recovered_us - detected_us);
+		return rc;
+	}
+	logi("watchdog: configuration restored %" PRIu64 " us after "
+	     "detection", recovered_us - detected_us);
+	return 0;
+}
+
+/*
+ * sja1105-tool config watchdog [-i|--interval <ms>]
+ *                              [-m|--max-interval <ms>]
+ *                              [-n|--count <polls>]
+ * Runs in the foreground until <polls> polls were made, or forever
+ * if no count is given.
+ */
+int config_watchdog_parse(struct sja1105_spi_setup *spi_setup,
+                          int argc, char **argv)
+{
+	struct sja1105_watchdog wd;
+	uint64_t min_ms = WATCHDOG_MIN_PERIOD_MS;
+	uint64_t max_ms = WATCHDOG_MAX_PERIOD_MS;
+	uint64_t count = 0;
+	unsigned int retry_us = 0;
+	int fault;
+	int rc;
+
+	while (argc) {
+		rc = watchdog_option_get(&argc, &argv, "-i", "--interval",
+		                         &min_ms);
+		if (rc == 0) {
+			rc = watchdog_option_get(&argc, &argv, "-m",
+			                         "--max-interval", &max_ms);
+		}
+		if (rc == 0) {
+			rc = watchdog_option_get(&argc, &argv, "-n", "--count",
+			                         &count);
+		}
+		if (rc <= 0) {
+			return -EINVAL;
+		}
+	}
+	if (min_ms == 0) {
+		loge("The polling interval must not be zero");
+		return -EINVAL;
+	}
+	if (min_ms > WATCHDOG_PERIOD_LIMIT_MS ||
+	    max_ms > WATCHDOG_PERIOD_LIMIT_MS) {
+		loge("Polling intervals cannot be longer than %d ms",
+		     WATCHDOG_PERIOD_LIMIT_MS);
+		return -EINVAL;
+	}
+	rc = sja1105_ctx_open(spi_setup->ctx);
+	if (rc < 0) {
+		loge("sja1105_ctx_open failed");
+		return rc;
+	}
+	sja1105_watchdog_init(&wd, min_ms * 1000, max_ms * 1000);
+	logi("watchdog: polling every %" PRIu64 " to %" PRIu64 " ms",
+	     min_ms, max_ms);
+	while (count == 0 || wd.polls < count) {
+		fault = sja1105_watchdog_poll(spi_setup, &wd);
+		if (fault < 0) {
+			loge("watchdog: could not read the general status");
+		} else if (fault != SJA1105_WATCHDOG_OK) {
+			if (watchdog_recover(spi_setup, &wd, fault) < 0) {
+				/* Nothing to recover with (no .applied copy,
+				 * for example) won't change by retrying at
+				 * once: back off as for a healthy switch */
+				retry_us = retry_us ? retry_us * 2 :
+				                      wd.min_period_us * 2;
+				if (retry_us > wd.max_period_us) {
+					retry_us = wd.max_period_us;
+				}
+				wd.period_us = retry_us;
+				logv("watchdog: retrying in %u us", retry_us);
+			} else {
+				retry_us = 0;
+			}
+		} else {
+			retry_us = 0;
+			logv("watchdog: switch is configured, next poll "
+			     "in %u us", wd.period_us);
+		}
+		if (count && wd.polls >= count) {
+			break;
+		}
+		usleep(wd.period_us);
+	}
+	return 0;
+}
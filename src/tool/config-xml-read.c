@@ -45,6 +45,15 @@ sja1105_staging_area_from_xml(__attribute__((unused)) const char *xml_file,
 	return -1;
 }
 
+int
+sja1105_staging_area_parse_xml(__attribute__((unused)) const char *xml_file,
+                               __attribute__((unused)) struct
+                               sja1105_staging_area *staging_area)
+{
+	loge("Tree support is not compiled in libxml2!");
+	return -1;
+}
+
 #else
 
 int xml_read_field(void *where, char *field_name, xmlNode *node)
@@ -252,34 +261,48 @@ out:
 	return rc;
 }
 
+/* Safe to call from several threads at once, provided that
+ * xmlInitParser was called beforehand */
 int
-sja1105_staging_area_from_xml(const char *xml_file,
-                              struct sja1105_staging_area *staging_area)
+sja1105_staging_area_parse_xml(const char *xml_file,
+                               struct sja1105_staging_area *staging_area)
 {
 	xmlNode *root = NULL;
 	xmlDoc  *doc = NULL;
 	int      rc = 0;
 
-	/*
-	 * this initializes the library and checks potential ABI mismatches
-	 * between the version it was compiled for and the actual shared
-	 * library used.
-	 */
-	LIBXML_TEST_VERSION;
-
 	doc = xmlReadFile(xml_file, NULL, 0);
 	if (doc == NULL) {
 		loge("could not parse file %s", xml_file);
+		return -EINVAL;
 	}
 	root = xmlDocGetRootElement(doc);
 	if (!root) {
 		loge("failed to get root element");
+		rc = -EINVAL;
 		goto out;
 	}
 	memset(staging_area, 0, sizeof(*staging_area));
 	rc = parse_root(root, staging_area);
 out:
 	xmlFreeDoc(doc);
+	return rc;
+}
+
+int
+sja1105_staging_area_from_xml(const char *xml_file,
+                              struct sja1105_staging_area *staging_area)
+{
+	int rc;
+
+	/*
+	 * this initializes the library and checks potential ABI mismatches
+	 * between the version it was compiled for and the actual shared
+	 * library used.
+	 */
+	LIBXML_TEST_VERSION;
+
+	rc = sja1105_staging_area_parse_xml(xml_file, staging_area);
 	xmlCleanupParser();
 	return rc;
 }
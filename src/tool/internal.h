@@ -32,12 +32,16 @@
 #define _SJA1105_TOOL_INTERNAL
 
 #include <common.h>
+#include <lib/include/context.h>
 #include <lib/include/staging-area.h>
+#include <lib/include/compact-config.h>
 #include <lib/include/spi.h>
 
 struct general_config {
 	char *staging_area;
 	int   screen_width;
+	int   threads;
+	char *compile_cache;
 	int   entries_per_line;
 	int   verbose;
 	int   debug;
@@ -57,13 +61,88 @@ int reg_parse_args(struct sja1105_spi_setup*, int argc, char **argv);
 int staging_area_modify(struct sja1105_staging_area*, char*, char*, char*);
 int staging_area_modify_parse(struct sja1105_staging_area*,
                               int *argc, char ***argv);
+int staging_area_select(struct sja1105_staging_area*, char *table_name,
+                        int **indices);
+int staging_area_modify_batch(struct sja1105_staging_area*,
+                              const char *file_name);
 int sja1105_staging_area_show(struct sja1105_staging_area*, char *table_name);
 
 int staging_area_load(const char*, struct sja1105_staging_area*);
+int staging_area_table_get(struct sja1105_staging_area*, uint64_t block_id);
+int staging_area_tables_get_all(struct sja1105_staging_area*);
+void staging_area_release(struct sja1105_staging_area*);
+int staging_area_compact(struct sja1105_staging_area*,
+                         struct sja1105_compact_config*);
+uint64_t staging_area_image_id(struct sja1105_staging_area*);
 int staging_area_save(const char*, struct sja1105_staging_area*);
 int staging_area_flush(struct sja1105_spi_setup*,
                        struct sja1105_staging_area*);
 int staging_area_hexdump(const char*);
+int staging_area_verify(const char*, int check_valid);
+int staging_area_rollback(struct sja1105_spi_setup*);
+int staging_area_journal_append(const char *staging_area_file,
+                                uint64_t image_id,
+                                const char *table_name,
+                                const char *field_name,
+                                const char *field_val);
+int staging_area_journal_replay(const char *staging_area_file,
+                                struct sja1105_staging_area*);
+int staging_area_journal_pending(const char *staging_area_file);
+void staging_area_journal_clear(const char *staging_area_file);
+int staging_area_journal_compact(const char *staging_area_file,
+                                 struct sja1105_staging_area*);
+void staging_area_change_log_start(void);
+int staging_area_change_log_stop(char **changes);
+int staging_area_undo_push(const char *staging_area_file, const char *changes);
+int staging_area_undo(const char *staging_area_file,
+                      struct sja1105_staging_area*, int count);
+void staging_area_undo_clear(const char *staging_area_file);
+int staging_area_txn_begin(const char *staging_area_file);
+int staging_area_txn_open(const char *staging_area_file);
+void staging_area_txn_end(const char *staging_area_file);
+void staging_area_undo_drop(const char *staging_area_file);
+int staging_area_cache_get(const char *staging_area_file, uint64_t xml_hash,
+                           struct sja1105_staging_area*);
+void staging_area_cache_put(const char *staging_area_file, uint64_t xml_hash);
+int config_watchdog_parse(struct sja1105_spi_setup*, int argc, char **argv);
+int config_diff_parse(int argc, char **argv);
+int config_compile_parse(int argc, char **argv);
+int staging_area_minimize(struct sja1105_staging_area*, unsigned int spi_speed);
+/* Staging area format v2, see staging-area-trailer.c */
+struct staging_area_toc_entry {
+	uint32_t offset;
+	uint32_t len;
+	uint32_t block_id;
+	uint32_t count;
+	uint64_t hash;
+};
+
+struct staging_area_trailer {
+	uint64_t xml_hash;
+	uint64_t timestamp;
+	uint32_t image_len;
+	int      toc_count;
+	struct staging_area_toc_entry toc[BLK_IDX_MAX];
+};
+
+int staging_area_trailer_build(const char *image, unsigned int image_len,
+                               uint64_t xml_hash, char **buf, int *len);
+int staging_area_trailer_parse(const char *buf, size_t len,
+                               struct staging_area_trailer*);
+void staging_area_trailer_show(const struct staging_area_trailer*);
+int staging_area_file_hash(const char *file_name, uint64_t *hash);
+int staging_area_delta_flush(struct sja1105_spi_setup*,
+                             char *old_buf, int old_len,
+                             char *config_buf, int config_buf_len);
+int staging_area_delta_supported(int blk_id, int old_len, int new_len);
+int staging_area_applied_load(struct sja1105_spi_setup*,
+                              char **config_buf, int *config_buf_len);
+void staging_area_applied_save(struct sja1105_spi_setup*,
+                               char *config_buf, int config_buf_len);
+void staging_area_applied_clear(struct sja1105_spi_setup*);
+FILE *staging_area_applied_open(struct sja1105_spi_setup*);
+void staging_area_applied_commit(struct sja1105_spi_setup*);
+void staging_area_applied_discard(struct sja1105_spi_setup*);
 
 /* From strings.c, mainly */
 char *trimwhitespace(char *str);
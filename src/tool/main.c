@@ -29,12 +29,16 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  *****************************************************************************/
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <lib/include/spi.h>
 #include <lib/include/static-config.h>
 #include <lib/include/gtable.h>
+#include <lib/include/compact-config.h>
+#include <lib/include/context.h>
 #include <common.h>
 #include "internal.h"
 
@@ -153,9 +157,6 @@ void cleanup(struct sja1105_spi_setup *spi_setup)
 	    spi_setup->staging_area != default_staging_area) {
 		free((char*) spi_setup->staging_area);
 	}
-	if (spi_setup->fd) {
-		close(spi_setup->fd);
-	}
 }
 
 static int reinterpreted_return_code(int rc)
@@ -167,6 +168,8 @@ int main(int argc, char *argv[])
 {
 	char *sja1105_conf_file = (char*) default_sja1105_conf_file;
 	struct sja1105_spi_setup spi_setup;
+	struct sja1105_ctx_stats stats;
+	struct sja1105_ctx *ctx;
 	int rc = SJA1105_ERR_OK;
 
 	/* discard program name */
@@ -179,13 +182,29 @@ int main(int argc, char *argv[])
 	if (rc < 0) {
 		goto out;
 	}
+	memset(&spi_setup, 0, sizeof(spi_setup));
 	read_config_file(sja1105_conf_file, &spi_setup, &general_config);
+	sja1105_parallel_configure(general_config.threads);
+	ctx = sja1105_ctx_new(&spi_setup);
+	if (ctx == NULL) {
+		rc = -ENOMEM;
+		goto out_cleanup;
+	}
 	/* Adjust gtable for SJA1105 SPI memory layout */
 	gtable_configure(QUIRK_LSW32_IS_FIRST);
-	rc = parse_args(&spi_setup, argc, argv);
+	sja1105_ctx_set_quirks(ctx, QUIRK_LSW32_IS_FIRST);
+	rc = parse_args(sja1105_ctx_spi_setup(ctx), argc, argv);
 	if (rc == SJA1105_ERR_OK) {
 		logv("ok");
 	}
+	sja1105_ctx_stats_get(ctx, &stats);
+	if (stats.transfers) {
+		logv("spi: %" PRIu64 " transfers, %" PRIu64 " bytes, "
+		     "%" PRIu64 " errors", stats.transfers, stats.bytes,
+		     stats.errors);
+	}
+	sja1105_ctx_free(ctx);
+out_cleanup:
 	cleanup(&spi_setup);
 out:
 	return reinterpreted_return_code(rc);
@@ -31,6 +31,7 @@
 #include "xml/read/external.h"
 #include "xml/write/external.h"
 #include "internal.h"
+#include <stdlib.h>
 #include <string.h>
 
 static void print_usage()
@@ -43,9 +44,27 @@ static void print_usage()
 	printf("* default [-f|--flush] <config>, which can be:\n");
 	printf("    * ls1021atsn - load a built-in config compatible with the NXP LS1021ATSN board\n");
 	printf("* modify [-f|--flush] <table>[<entry_index>] <field> <value>\n");
+	printf("* modify [-f|--flush] -b|--batch <file>, with one \"<table>[<entry_index>]\n");
+	printf("  <field> <value>\" per line, or from stdin if <file> is \"-\"\n");
 	printf("* upload\n");
 	printf("* show [<table>]. If no table is specified, shows entire config.\n");
 	printf("* hexdump [<table>]. If no table is specified, dumps entire config.\n");
+	printf("* verify [-c|--check]. Checks the CRCs of the staging area, and with\n");
+	printf("  --check, also that the config is valid for upload.\n");
+	printf("* rollback. Uploads the last config that the switch accepted again.\n");
+	printf("* watchdog [-i|--interval <ms>] [-m|--max-interval <ms>] [-n|--count <polls>].\n");
+	printf("  Watches for the switch losing its config, and uploads it again.\n");
+	printf("* begin. Opens a transaction: flushes are held back until commit.\n");
+	printf("* commit. Closes the transaction and uploads the staging area once.\n");
+	printf("* abort. Closes the transaction and undoes the changes made in it.\n");
+	printf("* undo [-f|--flush] [<count>]. Undoes the last <count> modify\n");
+	printf("  commands, 1 by default.\n");
+	printf("* diff [-j|--json] <old> <new>. Shows the fields that differ between\n");
+	printf("  two configs, each either a staging area or an XML file.\n");
+	printf("* compile [-o|--output-dir <dir>] [-j|--jobs <n>] <file.xml>...\n");
+	printf("  Packs many XML files to staging area files, in parallel.\n");
+	printf("* minimize [-f|--flush] [-n|--dry-run]. Drops unused and duplicate\n");
+	printf("  entries from the staging area, and shows the bytes saved.\n");
 }
 
 static void
@@ -58,7 +77,54 @@ get_flush_mode(struct sja1105_spi_setup *spi_setup, int *argc, char ***argv)
 	}
 }
 
-int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv)
+/* Inside a transaction, the upload waits for config commit */
+static void
+config_txn_hold_flush(struct sja1105_spi_setup *spi_setup)
+{
+	if (spi_setup->flush && staging_area_txn_open(spi_setup->staging_area)) {
+		logi("Transaction open, flush held back until config commit");
+		spi_setup->flush = 0;
+	}
+}
+
+/* For the commands that replace the staging area or upload it */
+static int
+config_txn_check(struct sja1105_spi_setup *spi_setup, const char *command)
+{
+	if (staging_area_txn_open(spi_setup->staging_area)) {
+		loge("A transaction is open. Run \"config commit\" or "
+		     "\"config abort\" before \"config %s\"", command);
+		return -EBUSY;
+	}
+	return 0;
+}
+
+/* For the commands that read the staging area file directly */
+static int
+config_journal_compact(struct sja1105_spi_setup *spi_setup,
+                       struct sja1105_staging_area *staging_area)
+{
+	int rc;
+
+	if (!staging_area_journal_pending(spi_setup->staging_area)) {
+		return 0;
+	}
+	rc = staging_area_load(spi_setup->staging_area, staging_area);
+	if (rc < 0) {
+		return rc;
+	}
+	rc = staging_area_journal_compact(spi_setup->staging_area,
+	                                  staging_area);
+	if (rc < 0) {
+		sja1105_err_remap(rc, SJA1105_ERR_FILESYSTEM);
+	}
+	return rc;
+}
+
+static int
+config_parse_staging_area(struct sja1105_spi_setup *spi_setup,
+                          struct sja1105_staging_area *staging_area,
+                          int argc, char **argv)
 {
 	const char *options[] = {
 		"help",
@@ -70,8 +136,19 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 		"upload",
 		"show",
 		"hexdump",
+		"verify",
+		"rollback",
+		"watchdog",
+		"begin",
+		"commit",
+		"abort",
+		"undo",
+		"diff",
+		"compile",
+		"minimize",
 	};
-	struct sja1105_staging_area staging_area;
+	uint64_t xml_hash;
+	int cached;
 	int match;
 	int rc = SJA1105_ERR_OK;
 
@@ -89,27 +166,49 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 		if (argc != 1) {
 			goto parse_error;
 		}
-		rc = sja1105_staging_area_from_xml(argv[0], &staging_area);
+		rc = config_txn_check(spi_setup, "load");
 		if (rc < 0) {
-			goto invalid_xml_error;
+			goto usage_error;
+		}
+		if (staging_area_file_hash(argv[0], &xml_hash) < 0) {
+			xml_hash = 0;
+		}
+		/* Built from this very XML file before: skip parsing and packing */
+		cached = xml_hash && staging_area_cache_get(spi_setup->staging_area,
+		                                            xml_hash, staging_area);
+		if (!cached) {
+			rc = sja1105_staging_area_from_xml(argv[0], staging_area);
+			if (rc < 0) {
+				goto invalid_xml_error;
+			}
+			staging_area->xml_hash = xml_hash;
 		}
-		rc = staging_area_save(spi_setup->staging_area, &staging_area);
+		rc = staging_area_save(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto filesystem_error;
 		}
+		if (!cached && xml_hash) {
+			staging_area_cache_put(spi_setup->staging_area, xml_hash);
+		}
+		/* Nothing that was modified before can be undone */
+		staging_area_undo_clear(spi_setup->staging_area);
 		if (spi_setup->flush) {
-			rc = sja1105_spi_configure(spi_setup);
+			rc = sja1105_ctx_open(spi_setup->ctx);
 			if (rc < 0) {
-				loge("sja1105_spi_configure failed");
+				loge("sja1105_ctx_open failed");
 				goto hardware_not_responding_error;
 			}
-			rc = staging_area_flush(spi_setup, &staging_area);
+			rc = staging_area_flush(spi_setup, staging_area);
 			if (rc < 0) {
 				loge("staging_area_flush failed");
 				/* We have enough context to know that the staging
 				 * area is dirty, so we force this error instead of
-				 * propagating the return code from staging_area_flush
+				 * propagating the return code from staging_area_flush,
+				 * unless the switch could be rolled back
 				 */
+				if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+					goto propagated_error;
+				}
 				goto hardware_left_floating_staging_area_dirty_error;
 			}
 		}
@@ -117,11 +216,20 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 		if (argc != 1) {
 			goto parse_error;
 		}
-		rc = staging_area_load(spi_setup->staging_area, &staging_area);
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_journal_compact(spi_setup->staging_area,
+		                                  staging_area);
+		if (rc < 0) {
+			goto filesystem_error;
+		}
+		rc = staging_area_tables_get_all(staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
-		rc = sja1105_staging_area_to_xml(argv[0], &staging_area);
+		rc = sja1105_staging_area_to_xml(argv[0], staging_area);
 		if (rc < 0) {
 			goto invalid_xml_error;
 		}
@@ -142,27 +250,36 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 			loge("Unrecognized default config %s", argv[0]);
 			goto parse_error;
 		}
-		rc = sja1105_default_staging_area(&staging_area,
+		rc = config_txn_check(spi_setup, "default");
+		if (rc < 0) {
+			goto usage_error;
+		}
+		rc = sja1105_default_staging_area(staging_area,
 		                                  default_configs[match]);
 		if (rc < 0) {
 			goto invalid_staging_area_error;
 		}
-		rc = staging_area_save(spi_setup->staging_area, &staging_area);
+		rc = staging_area_save(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto filesystem_error;
 		}
+		staging_area_undo_clear(spi_setup->staging_area);
 		if (spi_setup->flush) {
-			rc = sja1105_spi_configure(spi_setup);
+			rc = sja1105_ctx_open(spi_setup->ctx);
 			if (rc < 0) {
-				loge("sja1105_spi_configure failed");
+				loge("sja1105_ctx_open failed");
 				goto hardware_not_responding_staging_area_dirty_error;
 			}
-			rc = staging_area_flush(spi_setup, &staging_area);
+			rc = staging_area_flush(spi_setup, staging_area);
 			if (rc < 0) {
 				/* We have enough context to know that the staging
 				 * area is dirty, so we force this error instead of
-				 * propagating the return code from staging_area_flush
+				 * propagating the return code from staging_area_flush,
+				 * unless the switch could be rolled back
 				 */
+				if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+					goto propagated_error;
+				}
 				goto hardware_left_floating_staging_area_dirty_error;
 			}
 		}
@@ -170,45 +287,116 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 		if (argc != 0) {
 			goto parse_error;
 		}
-		rc = staging_area_load(spi_setup->staging_area, &staging_area);
+		rc = config_txn_check(spi_setup, "upload");
+		if (rc < 0) {
+			goto usage_error;
+		}
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
-		rc = sja1105_spi_configure(spi_setup);
+		rc = staging_area_journal_compact(spi_setup->staging_area,
+		                                  staging_area);
+		if (rc < 0) {
+			goto filesystem_error;
+		}
+		rc = sja1105_ctx_open(spi_setup->ctx);
 		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
+			loge("sja1105_ctx_open failed");
 			goto hardware_not_responding_error;
 		}
-		rc = staging_area_flush(spi_setup, &staging_area);
+		rc = staging_area_flush(spi_setup, staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
 	} else if (strcmp(options[match], "modify") == 0) {
+		char **modify_args;
+		char  *table_name;
+		char  *changes;
+		int    undo_rc;
+
 		get_flush_mode(spi_setup, &argc, &argv);
-		rc = staging_area_load(spi_setup->staging_area, &staging_area);
+		config_txn_hold_flush(spi_setup);
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
-		rc = staging_area_modify_parse(&staging_area, &argc, &argv);
+		if (argc == 2 && (strcmp(argv[0], "-b") == 0 ||
+		                  strcmp(argv[0], "--batch") == 0)) {
+			/* All or nothing, and saved once at the end */
+			modify_args = NULL;
+			table_name = NULL;
+			staging_area_change_log_start();
+			rc = staging_area_modify_batch(staging_area, argv[1]);
+			undo_rc = staging_area_change_log_stop(&changes);
+			if (rc < 0) {
+				free(changes);
+				goto propagated_error;
+			}
+		} else {
+			/* The table name loses its index while being parsed */
+			modify_args = argv;
+			table_name = argc ? strdup(argv[0]) : NULL;
+			staging_area_change_log_start();
+			rc = staging_area_modify_parse(staging_area, &argc, &argv);
+			undo_rc = staging_area_change_log_stop(&changes);
+			if (rc < 0) {
+				free(table_name);
+				free(changes);
+				goto propagated_error;
+			}
+			if (table_name == NULL) {
+				free(changes);
+				rc = -ENOMEM;
+				goto filesystem_error;
+			}
+		}
+		/* One step for config undo. Recorded first, so that
+		 * it can be dropped if the change is not kept. */
+		rc = (undo_rc < 0) ? undo_rc :
+		     staging_area_undo_push(spi_setup->staging_area, changes);
+		free(changes);
 		if (rc < 0) {
-			goto propagated_error;
+			free(table_name);
+			goto filesystem_error;
+		}
+		if (modify_args == NULL || spi_setup->flush) {
+			/* A batch, or about to be uploaded */
+			rc = 1;
+		} else {
+			rc = staging_area_journal_append(spi_setup->staging_area,
+			                 staging_area_image_id(staging_area),
+			                 table_name, modify_args[1],
+			                 modify_args[2]);
+		}
+		free(table_name);
+		/* No longer what the XML file describes */
+		staging_area->xml_hash = 0;
+		if (rc > 0) {
+			/* Or the journal grew long */
+			rc = staging_area_save(spi_setup->staging_area,
+			                       staging_area);
 		}
-		rc = staging_area_save(spi_setup->staging_area, &staging_area);
 		if (rc < 0) {
+			staging_area_undo_drop(spi_setup->staging_area);
 			goto filesystem_error;
 		}
 		if (spi_setup->flush) {
-			rc = sja1105_spi_configure(spi_setup);
+			rc = sja1105_ctx_open(spi_setup->ctx);
 			if (rc < 0) {
-				loge("sja1105_spi_configure failed");
+				loge("sja1105_ctx_open failed");
 				goto hardware_not_responding_staging_area_dirty_error;
 			}
-			rc = staging_area_flush(spi_setup, &staging_area);
+			rc = staging_area_flush(spi_setup, staging_area);
 			if (rc < 0) {
 				/* We have enough context to know that the staging
 				 * area is dirty, so we force this error instead of
-				 * propagating the return code from staging_area_flush
+				 * propagating the return code from staging_area_flush,
+				 * unless the switch could be rolled back
 				 */
+				if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+					goto propagated_error;
+				}
 				goto hardware_left_floating_staging_area_dirty_error;
 			}
 		}
@@ -220,12 +408,15 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 			 */
 			goto parse_error;
 		}
-		memset(&staging_area, 0, sizeof(staging_area));
+		rc = config_txn_check(spi_setup, "new");
+		if (rc < 0) {
+			goto usage_error;
+		}
 		if (argc == 2) {
 			if ((matches(argv[0], "-d") == 0) ||
 			    (matches(argv[0], "--device-id") == 0)) {
 				/* sja1105-config new -d <device_id> was provided */
-				rc = reliable_uint64_from_string(&staging_area.static_config.device_id,
+				rc = reliable_uint64_from_string(&staging_area->static_config.device_id,
 				                                 argv[1], NULL);
 				if (rc < 0) {
 					loge("Invalid device id provided: %s", argv[1]);
@@ -234,21 +425,27 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 			}
 		} else {
 			logv("No device id provided, defaulting to SJA1105T");
-			staging_area.static_config.device_id = SJA1105T_DEVICE_ID;
+			staging_area->static_config.device_id = SJA1105T_DEVICE_ID;
 		}
-		rc = staging_area_save(spi_setup->staging_area, &staging_area);
+		rc = staging_area_save(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto filesystem_error;
 		}
+		staging_area_undo_clear(spi_setup->staging_area);
 	} else if (strcmp(options[match], "show") == 0) {
 		if (argc != 0 && argc != 1) {
 			goto parse_error;
 		}
-		rc = staging_area_load(spi_setup->staging_area, &staging_area);
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
-		rc = sja1105_staging_area_show(&staging_area, argv[0]);
+		rc = staging_area_journal_compact(spi_setup->staging_area,
+		                                  staging_area);
+		if (rc < 0) {
+			goto filesystem_error;
+		}
+		rc = sja1105_staging_area_show(staging_area, argv[0]);
 		if (rc < 0) {
 			goto invalid_staging_area_error;
 		}
@@ -256,10 +453,220 @@ int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv
 		if (argc != 0) {
 			goto parse_error;
 		}
+		rc = config_journal_compact(spi_setup, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
 		rc = staging_area_hexdump(spi_setup->staging_area);
 		if (rc < 0) {
 			goto propagated_error;
 		}
+	} else if (strcmp(options[match], "verify") == 0) {
+		int check_valid = 0;
+
+		if (argc == 1 && (strcmp(argv[0], "-c") == 0 ||
+		                  strcmp(argv[0], "--check") == 0)) {
+			check_valid = 1;
+			argc--; argv++;
+		}
+		if (argc != 0) {
+			goto parse_error;
+		}
+		rc = config_journal_compact(spi_setup, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_verify(spi_setup->staging_area, check_valid);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+	} else if (strcmp(options[match], "rollback") == 0) {
+		if (argc != 0) {
+			goto parse_error;
+		}
+		rc = sja1105_ctx_open(spi_setup->ctx);
+		if (rc < 0) {
+			loge("sja1105_ctx_open failed");
+			goto hardware_not_responding_error;
+		}
+		rc = staging_area_rollback(spi_setup);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+	} else if (strcmp(options[match], "watchdog") == 0) {
+		rc = config_watchdog_parse(spi_setup, argc, argv);
+		if (rc == -EINVAL) {
+			goto parse_error;
+		}
+		if (rc < 0) {
+			goto hardware_not_responding_error;
+		}
+	} else if (strcmp(options[match], "begin") == 0) {
+		if (argc != 0) {
+			goto parse_error;
+		}
+		rc = staging_area_txn_begin(spi_setup->staging_area);
+		if (rc == -EBUSY) {
+			goto usage_error;
+		}
+		if (rc < 0) {
+			goto filesystem_error;
+		}
+	} else if (strcmp(options[match], "commit") == 0) {
+		if (argc != 0) {
+			goto parse_error;
+		}
+		if (!staging_area_txn_open(spi_setup->staging_area)) {
+			loge("No transaction is open");
+			rc = -EINVAL;
+			goto usage_error;
+		}
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_journal_compact(spi_setup->staging_area,
+		                                  staging_area);
+		if (rc < 0) {
+			goto filesystem_error;
+		}
+		staging_area_txn_end(spi_setup->staging_area);
+		/* All the changes of the transaction, uploaded at once */
+		rc = sja1105_ctx_open(spi_setup->ctx);
+		if (rc < 0) {
+			loge("sja1105_ctx_open failed");
+			goto hardware_not_responding_staging_area_dirty_error;
+		}
+		rc = staging_area_flush(spi_setup, staging_area);
+		if (rc < 0) {
+			if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+				goto propagated_error;
+			}
+			goto hardware_left_floating_staging_area_dirty_error;
+		}
+	} else if (strcmp(options[match], "abort") == 0) {
+		if (argc != 0) {
+			goto parse_error;
+		}
+		if (!staging_area_txn_open(spi_setup->staging_area)) {
+			loge("No transaction is open");
+			rc = -EINVAL;
+			goto usage_error;
+		}
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_undo(spi_setup->staging_area, staging_area, 0);
+		if (rc < 0) {
+			goto invalid_staging_area_error;
+		}
+		logi("%d changes undone", rc);
+		staging_area_txn_end(spi_setup->staging_area);
+	} else if (strcmp(options[match], "undo") == 0) {
+		uint64_t count = 1;
+
+		get_flush_mode(spi_setup, &argc, &argv);
+		config_txn_hold_flush(spi_setup);
+		if (argc > 1) {
+			goto parse_error;
+		}
+		if (argc == 1) {
+			rc = reliable_uint64_from_string(&count, argv[0], NULL);
+			if (rc < 0 || count == 0 || count > INT32_MAX) {
+				loge("Invalid count %s", argv[0]);
+				goto parse_error;
+			}
+		}
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_undo(spi_setup->staging_area, staging_area,
+		                       count);
+		if (rc < 0) {
+			goto invalid_staging_area_error;
+		}
+		if (spi_setup->flush) {
+			rc = sja1105_ctx_open(spi_setup->ctx);
+			if (rc < 0) {
+				loge("sja1105_ctx_open failed");
+				goto hardware_not_responding_staging_area_dirty_error;
+			}
+			rc = staging_area_flush(spi_setup, staging_area);
+			if (rc < 0) {
+				if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+					goto propagated_error;
+				}
+				goto hardware_left_floating_staging_area_dirty_error;
+			}
+		}
+	} else if (strcmp(options[match], "diff") == 0) {
+		rc = config_diff_parse(argc, argv);
+		if (rc == -EINVAL) {
+			goto parse_error;
+		}
+		if (rc < 0) {
+			goto invalid_staging_area_error;
+		}
+	} else if (strcmp(options[match], "minimize") == 0) {
+		int dry_run = 0;
+
+		get_flush_mode(spi_setup, &argc, &argv);
+		if (argc && (strcmp(argv[0], "-n") == 0 ||
+		             strcmp(argv[0], "--dry-run") == 0)) {
+			dry_run = 1;
+			spi_setup->flush = 0;
+			argc--; argv++;
+		}
+		if (argc != 0) {
+			goto parse_error;
+		}
+		if (!dry_run) {
+			rc = config_txn_check(spi_setup, "minimize");
+			if (rc < 0) {
+				goto usage_error;
+			}
+		}
+		rc = staging_area_load(spi_setup->staging_area, staging_area);
+		if (rc < 0) {
+			goto propagated_error;
+		}
+		rc = staging_area_minimize(staging_area, spi_setup->speed);
+		if (rc < 0) {
+			goto invalid_staging_area_error;
+		}
+		if (rc > 0 && !dry_run) {
+			staging_area->xml_hash = 0;
+			rc = staging_area_save(spi_setup->staging_area, staging_area);
+			if (rc < 0) {
+				goto filesystem_error;
+			}
+			/* Entries have moved: what was logged no longer undoes */
+			staging_area_undo_clear(spi_setup->staging_area);
+		}
+		if (spi_setup->flush) {
+			rc = sja1105_ctx_open(spi_setup->ctx);
+			if (rc < 0) {
+				loge("sja1105_ctx_open failed");
+				goto hardware_not_responding_staging_area_dirty_error;
+			}
+			rc = staging_area_flush(spi_setup, staging_area);
+			if (rc < 0) {
+				if (rc == -SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK) {
+					goto propagated_error;
+				}
+				goto hardware_left_floating_staging_area_dirty_error;
+			}
+		}
+	} else if (strcmp(options[match], "compile") == 0) {
+		rc = config_compile_parse(argc, argv);
+		if (rc == -EINVAL) {
+			goto parse_error;
+		}
+		if (rc < 0) {
+			goto propagated_error;
+		}
 	} else {
 		goto parse_error;
 	}
@@ -283,6 +690,9 @@ filesystem_error:
 invalid_xml_error:
 	sja1105_err_remap(rc, SJA1105_ERR_INVALID_XML);
 	return rc;
+usage_error:
+	sja1105_err_remap(rc, SJA1105_ERR_USAGE);
+	return rc;
 parse_error:
 	sja1105_err_remap(rc, SJA1105_ERR_CMDLINE_PARSE);
 	print_usage();
@@ -290,3 +700,22 @@ parse_error:
 propagated_error:
 	return rc;
 }
+
+int config_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv)
+{
+	struct sja1105_staging_area *staging_area;
+	int rc;
+
+	/* With every table sized for its hardware maximum, the staging
+	 * area is too large for the stack. calloc leaves the pages that
+	 * are never written to untouched. */
+	staging_area = calloc(1, sizeof(*staging_area));
+	if (!staging_area) {
+		loge("calloc failed");
+		return -ENOMEM;
+	}
+	rc = config_parse_staging_area(spi_setup, staging_area, argc, argv);
+	staging_area_release(staging_area);
+	free(staging_area);
+	return rc;
+}
@@ -75,7 +75,7 @@ int rgu_parse_args(struct sja1105_spi_setup *spi_setup, int argc, char **argv)
 	if (match < 0) {
 		goto out_parse_error;
 	}
-	rc = sja1105_spi_configure(spi_setup);
+	rc = sja1105_ctx_open(spi_setup->ctx);
 	if (rc < 0) {
 		loge("failed to open spi device");
 		goto out_spi_configure_failed;
@@ -46,7 +46,7 @@ static void print_usage()
 static int status_ports(struct sja1105_spi_setup *spi_setup,
                         int port_no)
 {
-	struct sja1105_port_status status;
+	struct sja1105_port_status status[5];
 	char *print_buf[5];
 	/* XXX Maybe not quite right? */
 	int   size = 10 * MAX_LINE_SIZE;
@@ -58,13 +58,13 @@ static int status_ports(struct sja1105_spi_setup *spi_setup,
 		for (i = 0; i < 5; i++) {
 			print_buf[i] = (char*) calloc(size, sizeof(char));
 		}
+		rc = sja1105_port_status_get_all(spi_setup, status);
+		if (rc < 0) {
+			loge("sja1105_port_status_get_all failed");
+			goto out;
+		}
 		for (i = 0; i < 5; i++) {
-			rc = sja1105_port_status_get(spi_setup, &status, i);
-			if (rc < 0) {
-				loge("sja1105_port_status_get failed");
-				goto out;
-			}
-			sja1105_port_status_show(&status, i, print_buf[i],
+			sja1105_port_status_show(&status[i], i, print_buf[i],
 			                         spi_setup->device_id);
 		}
 		linewise_concat(print_buf, 5);
@@ -75,12 +75,12 @@ static int status_ports(struct sja1105_spi_setup *spi_setup,
 	} else {
 		/* Show for single port */
 		print_buf[0] = (char*) calloc(size, sizeof(char));
-		rc = sja1105_port_status_get(spi_setup, &status, port_no);
+		rc = sja1105_port_status_get(spi_setup, &status[0], port_no);
 		if (rc < 0) {
 			loge("sja1105_port_status_get failed");
 			goto out;
 		}
-		sja1105_port_status_show(&status, port_no, print_buf[0],
+		sja1105_port_status_show(&status[0], port_no, print_buf[0],
 		                         spi_setup->device_id);
 		printf("%s\n", print_buf[0]);
 		free(print_buf[0]);
@@ -112,9 +112,9 @@ int status_parse_args(struct sja1105_spi_setup *spi_setup,
 		goto parse_error;
 	} else if (matches(options[match], "general") == 0) {
 		struct sja1105_general_status status;
-		rc = sja1105_spi_configure(spi_setup);
+		rc = sja1105_ctx_open(spi_setup->ctx);
 		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
+			loge("sja1105_ctx_open failed");
 			goto error;
 		}
 		rc = sja1105_general_status_get(spi_setup, &status);
@@ -147,9 +147,9 @@ int status_parse_args(struct sja1105_spi_setup *spi_setup,
 			rc = -EINVAL;
 			goto parse_error;
 		}
-		rc = sja1105_spi_configure(spi_setup);
+		rc = sja1105_ctx_open(spi_setup->ctx);
 		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
+			loge("sja1105_ctx_open failed");
 			goto error;
 		}
 		if (clear) {
@@ -5,9 +5,12 @@
  *      Author: tescott
  */
 #include "internal.h"
+#include <stdlib.h>
 #include <string.h>
 #include <lib/include/status.h>
 #include <lib/include/spi.h>
+#include <lib/include/gtable.h>
+#include <errno.h>
 #include <inttypes.h>
 
 static void print_usage()
@@ -17,6 +20,177 @@ static void print_usage()
 	       "Read or write register\n");
 	printf(" * sja1105-tool reg dump <address> <count>    :"
 	       "Incrementally dump registers starting at the given address\n");
+	printf(" * sja1105-tool reg save <address> <count> <file> :"
+	       "Save registers starting at the given address to a binary file\n");
+	printf(" * sja1105-tool reg load [-c|--compare] <address> <file> :"
+	       "Write registers starting at the given address from a binary\n"
+	       "   file. With --compare, only the words that differ from the\n"
+	       "   current register contents are written\n");
+}
+
+/* Read count registers in as few SPI messages as possible.
+ * The returned buffer holds them in wire order and must be freed. */
+static int reg_read_block(struct sja1105_spi_setup *spi_setup,
+                          uint64_t address, uint64_t count, char **buf)
+{
+	int rc;
+
+	*buf = calloc(count, 4);
+	if (*buf == NULL) {
+		loge("failed to allocate %" PRIu64 " words", count);
+		return -ENOMEM;
+	}
+	rc = sja1105_spi_send_long_packed_buf(spi_setup, SPI_READ, address,
+	                                      *buf, count * 4);
+	if (rc < 0) {
+		loge("failed to read %" PRIu64 " registers from 0x%" PRIx64,
+		     count, address);
+		free(*buf);
+		*buf = NULL;
+	}
+	return rc;
+}
+
+static int reg_dump(struct sja1105_spi_setup *spi_setup,
+                    uint64_t address, uint64_t count)
+{
+	uint64_t data;
+	uint64_t i;
+	char *buf;
+	int rc;
+
+	rc = reg_read_block(spi_setup, address, count, &buf);
+	if (rc < 0) {
+		return rc;
+	}
+	for (i = 0; i < count; i++) {
+		gtable_unpack(buf + 4 * i, &data, 31, 0, 4);
+		printf("0x%08" PRIx64 ": %08" PRIx64 "\n", address + i, data);
+	}
+	free(buf);
+	return 0;
+}
+
+static int reg_save(struct sja1105_spi_setup *spi_setup, uint64_t address,
+                    uint64_t count, const char *filename)
+{
+	char *buf;
+	FILE *fp;
+	int rc;
+
+	rc = reg_read_block(spi_setup, address, count, &buf);
+	if (rc < 0) {
+		return rc;
+	}
+	fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		loge("could not open %s for writing", filename);
+		rc = -errno;
+		goto out;
+	}
+	if (fwrite(buf, 4, count, fp) != count) {
+		loge("could not write %s", filename);
+		rc = -EIO;
+	}
+	fclose(fp);
+out:
+	free(buf);
+	return rc;
+}
+
+/* Write the words of buf that differ from the current register
+ * contents, one SPI burst per run of consecutive differing words */
+static int reg_write_changed(struct sja1105_spi_setup *spi_setup,
+                             uint64_t address, char *buf, uint64_t count)
+{
+	uint64_t start, end;
+	uint64_t written = 0;
+	int runs = 0;
+	char *old;
+	int rc;
+
+	rc = reg_read_block(spi_setup, address, count, &old);
+	if (rc < 0) {
+		return rc;
+	}
+	start = 0;
+	while (start < count) {
+		if (memcmp(old + 4 * start, buf + 4 * start, 4) == 0) {
+			start++;
+			continue;
+		}
+		end = start + 1;
+		while (end < count && memcmp(old + 4 * end, buf + 4 * end, 4)) {
+			end++;
+		}
+		rc = sja1105_spi_send_long_packed_buf(spi_setup, SPI_WRITE,
+		                                      address + start,
+		                                      buf + 4 * start,
+		                                      (end - start) * 4);
+		if (rc < 0) {
+			loge("failed to write registers at 0x%" PRIx64,
+			     address + start);
+			goto out;
+		}
+		written += end - start;
+		runs++;
+		start = end;
+	}
+	logv("%" PRIu64 " of %" PRIu64 " words differed, written in %d bursts",
+	     written, count, runs);
+out:
+	free(old);
+	return rc;
+}
+
+static int reg_load(struct sja1105_spi_setup *spi_setup, uint64_t address,
+                    const char *filename, int compare)
+{
+	char *buf = NULL;
+	long  size;
+	FILE *fp;
+	int   rc = 0;
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		loge("could not open %s", filename);
+		return -errno;
+	}
+	if (fseek(fp, 0, SEEK_END) < 0 || (size = ftell(fp)) < 0) {
+		loge("could not determine size of %s", filename);
+		rc = -EIO;
+		goto out;
+	}
+	rewind(fp);
+	if (size == 0 || size % 4) {
+		loge("%s must contain a nonzero number of 32-bit words",
+		     filename);
+		rc = -EINVAL;
+		goto out;
+	}
+	buf = malloc(size);
+	if (buf == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	if (fread(buf, 1, size, fp) != (size_t) size) {
+		loge("could not read %s", filename);
+		rc = -EIO;
+		goto out;
+	}
+	if (compare) {
+		rc = reg_write_changed(spi_setup, address, buf, size / 4);
+	} else {
+		rc = sja1105_spi_send_long_packed_buf(spi_setup, SPI_WRITE,
+		                                      address, buf, size);
+		if (rc < 0) {
+			loge("failed to write registers at 0x%" PRIx64, address);
+		}
+	}
+out:
+	free(buf);
+	fclose(fp);
+	return rc;
 }
 
 int reg_parse_args(struct sja1105_spi_setup *spi_setup,
@@ -28,8 +202,8 @@ int reg_parse_args(struct sja1105_spi_setup *spi_setup,
 		uint64_t count;
 		uint64_t size;
 	} reg_cmd;
+	int compare = 0;
 	int rc = 0;
-	uint64_t i;
 
 	if (argc < 1) {
 		rc = -EINVAL;
@@ -38,18 +212,17 @@ int reg_parse_args(struct sja1105_spi_setup *spi_setup,
 
 	/* Make this assumption for now */
 	reg_cmd.size = 4;
-	if (matches(argv[0], "dump") == 0) {
-		/* consume the 'dump' parameter */
+	if (matches(argv[0], "dump") == 0 ||
+	    matches(argv[0], "save") == 0) {
+		int save = (matches(argv[0], "save") == 0);
+
+		/* consume the 'dump' or 'save' parameter */
 		argc--; argv++;
-		if (argc != 2) {
-			loge("Please supply 2 parameters.");
+		if (argc != 2 + save) {
+			loge("Please supply %d parameters.", 2 + save);
+			rc = -EINVAL;
 			goto out_parse_error;
 		}
-		rc = sja1105_spi_configure(spi_setup);
-		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
-			goto out_spi_configure_failed;
-		}
 		rc = reliable_uint64_from_string(&reg_cmd.address,
 		                                 argv[0], NULL);
 		if (rc < 0) {
@@ -58,28 +231,59 @@ int reg_parse_args(struct sja1105_spi_setup *spi_setup,
 		}
 		rc = reliable_uint64_from_string(&reg_cmd.count,
 		                                 argv[1], NULL);
-		if (rc < 0) {
+		if (rc < 0 || reg_cmd.count == 0) {
 			loge("could not read count param %s", argv[1]);
+			rc = -EINVAL;
+			goto out_parse_error;
+		}
+		rc = sja1105_ctx_open(spi_setup->ctx);
+		if (rc < 0) {
+			loge("sja1105_ctx_open failed");
+			goto out_spi_configure_failed;
+		}
+		if (save) {
+			rc = reg_save(spi_setup, reg_cmd.address,
+			              reg_cmd.count, argv[2]);
+		} else {
+			rc = reg_dump(spi_setup, reg_cmd.address,
+			              reg_cmd.count);
+		}
+		if (rc < 0) {
+			goto out_read_failed;
+		}
+	} else if (matches(argv[0], "load") == 0) {
+		/* consume the 'load' parameter */
+		argc--; argv++;
+		if (argc > 0 && (matches(argv[0], "-c") == 0 ||
+		                 matches(argv[0], "--compare") == 0)) {
+			compare = 1;
+			argc--; argv++;
+		}
+		if (argc != 2) {
+			loge("Please supply 2 parameters.");
+			rc = -EINVAL;
+			goto out_parse_error;
+		}
+		rc = reliable_uint64_from_string(&reg_cmd.address,
+		                                 argv[0], NULL);
+		if (rc < 0) {
+			loge("could not read address param %s", argv[0]);
 			goto out_parse_error;
 		}
-		for (i = 0; i < reg_cmd.count; i++) {
-			rc = sja1105_spi_send_int(spi_setup,
-			                          SPI_READ,
-			                          reg_cmd.address + i,
-			                          &reg_cmd.data,
-			                          reg_cmd.size);
-			if (rc < 0) {
-				loge("register address not read");
-				goto out_read_failed;
-			}
-			printf("0x%08" PRIx64 ": %08" PRIx64 "\n",
-			       reg_cmd.address + i, reg_cmd.data);
+		rc = sja1105_ctx_open(spi_setup->ctx);
+		if (rc < 0) {
+			loge("sja1105_ctx_open failed");
+			goto out_spi_configure_failed;
+		}
+		rc = reg_load(spi_setup, reg_cmd.address, argv[1], compare);
+		if (rc < 0) {
+			goto out_write_failed;
 		}
 	} else if (argc == 1) {
 		// perform a read...
-		rc = sja1105_spi_configure(spi_setup);
+		rc = sja1105_ctx_open(spi_setup->ctx);
 		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
+			loge("sja1105_ctx_open failed");
 			goto out_spi_configure_failed;
 		}
 
@@ -103,9 +307,9 @@ int reg_parse_args(struct sja1105_spi_setup *spi_setup,
 		       reg_cmd.address, reg_cmd.data);
 	} else if (argc == 2) {
 		// perform a write
-		rc = sja1105_spi_configure(spi_setup);
+		rc = sja1105_ctx_open(spi_setup->ctx);
 		if (rc < 0) {
-			loge("sja1105_spi_configure failed");
+			loge("sja1105_ctx_open failed");
 			goto out_spi_configure_failed;
 		}
 
@@ -0,0 +1,291 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <inttypes.h>
+#include <errno.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/staging-area.h>
+#include <lib/include/gtable.h>
+#include <common.h>
+
+/*
+ * "config load" keeps the staging areas it builds from XML files in a
+ * cache directory, under a name made from the hash of the XML bytes and
+ * of the tool version. Loading the same XML file again copies the
+ * staging area out of the cache, without parsing and packing anything.
+ * Since the entries are ordinary staging area files, they are checked
+ * (trailer, CRC, XML hash) as such before being used. Only the
+ * COMPILE_CACHE_MAX_ENTRIES most recently used entries are kept.
+ */
+#define COMPILE_CACHE_SUFFIX      ".cache"
+#define COMPILE_CACHE_MAX_ENTRIES 32
+
+/* The cache directory, or NULL if the cache is disabled */
+static char *compile_cache_dir(const char *staging_area_file)
+{
+	const char *dir = general_config.compile_cache;
+	char *name;
+
+	if (dir != NULL) {
+		if (strlen(dir) == 0 || strcmp(dir, "none") == 0) {
+			return NULL;
+		}
+		return strdup(dir);
+	}
+	name = malloc(strlen(staging_area_file) +
+	              strlen(COMPILE_CACHE_SUFFIX) + 1);
+	if (name) {
+		sprintf(name, "%s%s", staging_area_file, COMPILE_CACHE_SUFFIX);
+	}
+	return name;
+}
+
+static char *compile_cache_entry(const char *dir, uint64_t xml_hash)
+{
+	char key[64 + sizeof(VERSION)];
+	char *name;
+
+	/* A different tool may pack the same XML differently */
+	snprintf(key, sizeof(key), "%016" PRIx64 " %s", xml_hash, VERSION);
+	name = malloc(strlen(dir) + 22);
+	if (name) {
+		sprintf(name, "%s/%016" PRIx64 ".bin", dir,
+		        sja1105_fnv1a64(key, strlen(key)));
+	}
+	return name;
+}
+
+static int compile_cache_copy(const char *from, const char *to)
+{
+	char *tmp = NULL;
+	char *buf = NULL;
+	FILE *in = NULL;
+	FILE *out;
+	long size;
+	int rc = -EIO;
+
+	in = fopen(from, "rb");
+	if (in == NULL) {
+		return -errno;
+	}
+	if (fseek(in, 0, SEEK_END) < 0 || (size = ftell(in)) <= 0) {
+		goto out;
+	}
+	rewind(in);
+	buf = malloc(size);
+	tmp = malloc(strlen(to) + 16);
+	if (buf == NULL || tmp == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	if (fread(buf, 1, size, in) != (size_t) size) {
+		goto out;
+	}
+	/* Concurrent loads of the same file may race to store it:
+	 * write aside and rename, so that no one sees half an entry */
+	sprintf(tmp, "%s.%d", to, (int) getpid());
+	out = fopen(tmp, "wb");
+	if (out == NULL) {
+		rc = -errno;
+		goto out;
+	}
+	rc = (fwrite(buf, 1, size, out) == (size_t) size) ? 0 : -EIO;
+	if (fclose(out) != 0 && rc == 0) {
+		rc = -EIO;
+	}
+	if (rc == 0 && rename(tmp, to) < 0) {
+		rc = -errno;
+	}
+	if (rc < 0) {
+		unlink(tmp);
+	}
+out:
+	fclose(in);
+	free(tmp);
+	free(buf);
+	return rc;
+}
+
+struct compile_cache_file {
+	char   name[NAME_MAX + 1];
+	time_t mtime;
+};
+
+static int compile_cache_file_cmp(const void *a, const void *b)
+{
+	const struct compile_cache_file *fa = a;
+	const struct compile_cache_file *fb = b;
+
+	return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/* Drop the least recently used entries past COMPILE_CACHE_MAX_ENTRIES.
+ * The directory is read once and the excess deleted in a single pass:
+ * an entry that cannot be deleted is only reported. */
+static void compile_cache_trim(const char *dir)
+{
+	struct compile_cache_file *files = NULL;
+	struct compile_cache_file *tmp;
+	char path[PATH_MAX];
+	struct dirent *de;
+	struct stat st;
+	int count = 0;
+	int size = 0;
+	int i;
+	DIR *d;
+
+	d = opendir(dir);
+	if (d == NULL) {
+		return;
+	}
+	while ((de = readdir(d)) != NULL) {
+		int len = strlen(de->d_name);
+
+		if (len < 5 || strcmp(de->d_name + len - 4, ".bin") != 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (stat(path, &st) < 0) {
+			continue;
+		}
+		if (count == size) {
+			size = size ? size * 2 : COMPILE_CACHE_MAX_ENTRIES * 2;
+			tmp = realloc(files, size * sizeof(*files));
+			if (tmp == NULL) {
+				loge("realloc failed");
+				goto out;
+			}
+			files = tmp;
+		}
+		snprintf(files[count].name, sizeof(files[count].name),
+		         "%s", de->d_name);
+		files[count].mtime = st.st_mtime;
+		count++;
+	}
+	if (count <= COMPILE_CACHE_MAX_ENTRIES) {
+		goto out;
+	}
+	qsort(files, count, sizeof(*files), compile_cache_file_cmp);
+	for (i = 0; i < count - COMPILE_CACHE_MAX_ENTRIES; i++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+		logv("compile cache: dropping %s", path);
+		if (unlink(path) < 0) {
+			logv("compile cache: cannot drop %s: %s", path,
+			     strerror(errno));
+		}
+	}
+out:
+	closedir(d);
+	free(files);
+}
+
+/*
+ * Fill the staging area from the cache entry of an XML file with the
+ * given hash. Returns 1 on a hit, 0 if the staging area still needs to
+ * be built from the XML file. Cache errors are never fatal.
+ */
+int staging_area_cache_get(const char *staging_area_file, uint64_t xml_hash,
+                           struct sja1105_staging_area *staging_area)
+{
+	char *dir;
+	char *entry = NULL;
+	int rc = 0;
+
+	dir = compile_cache_dir(staging_area_file);
+	if (dir == NULL) {
+		return 0;
+	}
+	entry = compile_cache_entry(dir, xml_hash);
+	if (entry == NULL || access(entry, R_OK) < 0) {
+		logv("compile cache miss");
+		goto out;
+	}
+	if (staging_area_verify(entry, 0) < 0 ||
+	    staging_area_load(entry, staging_area) < 0) {
+		logv("compile cache: ignoring bad entry %s", entry);
+		unlink(entry);
+		goto out;
+	}
+	if (staging_area->xml_hash != xml_hash) {
+		logv("compile cache: entry %s is for another file", entry);
+		staging_area_release(staging_area);
+		goto out;
+	}
+	/* Mark as recently used */
+	utime(entry, NULL);
+	logv("compile cache hit: %s", entry);
+	rc = 1;
+out:
+	free(entry);
+	free(dir);
+	return rc;
+}
+
+/* Keep a copy of the staging area, just built from an XML file with
+ * the given hash, for the next time that file is loaded */
+void staging_area_cache_put(const char *staging_area_file, uint64_t xml_hash)
+{
+	char *dir;
+	char *entry = NULL;
+	int rc;
+
+	dir = compile_cache_dir(staging_area_file);
+	if (dir == NULL) {
+		return;
+	}
+	if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+		logv("compile cache: cannot create %s: %s", dir, strerror(errno));
+		goto out;
+	}
+	entry = compile_cache_entry(dir, xml_hash);
+	if (entry == NULL) {
+		goto out;
+	}
+	rc = compile_cache_copy(staging_area_file, entry);
+	if (rc < 0) {
+		logv("compile cache: cannot store %s: %s", entry, strerror(-rc));
+		goto out;
+	}
+	logv("compile cache: stored %s", entry);
+	compile_cache_trim(dir);
+out:
+	free(entry);
+	free(dir);
+}
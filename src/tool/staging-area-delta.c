@@ -0,0 +1,516 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/static-config.h>
+#include <lib/include/dynamic-config.h>
+#include <lib/include/staging-area.h>
+#include <lib/include/status.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+/*
+ * The last configuration that made it to the switch is kept next to
+ * the staging area, exactly as it was sent over SPI. On flush, the
+ * new configuration is compared to it table by table. If only tables
+ * that the switch can reconfigure at runtime differ, they are applied
+ * entry by entry through the dynamic reconfiguration interface, and
+ * the switch is neither reset nor does it stop forwarding traffic.
+ */
+#define APPLIED_SUFFIX ".applied"
+#define APPLIED_TMP    ".tmp"
+#define NUM_BLK_IDS    0x100
+
+struct config_table {
+	char *data;
+	int   len;
+};
+
+static char *applied_file_name(struct sja1105_spi_setup *spi_setup,
+                               const char *suffix)
+{
+	char *name;
+
+	name = malloc(strlen(spi_setup->staging_area) +
+	              strlen(APPLIED_SUFFIX) + strlen(suffix) + 1);
+	if (name) {
+		sprintf(name, "%s" APPLIED_SUFFIX "%s",
+		        spi_setup->staging_area, suffix);
+	}
+	return name;
+}
+
+int staging_area_applied_load(struct sja1105_spi_setup *spi_setup,
+                              char **buf, int *len)
+{
+	struct staging_area_trailer trailer;
+	char *name;
+	FILE *fp;
+	long  size;
+	int   rc = -1;
+
+	*buf = NULL;
+	name = applied_file_name(spi_setup, "");
+	if (name == NULL) {
+		return -ENOMEM;
+	}
+	fp = fopen(name, "rb");
+	if (fp == NULL) {
+		logv("%s not found", name);
+		goto out_free_name;
+	}
+	if (fseek(fp, 0, SEEK_END) < 0 || (size = ftell(fp)) <= 0) {
+		goto out_close;
+	}
+	rewind(fp);
+	*buf = malloc(size);
+	if (*buf == NULL) {
+		goto out_close;
+	}
+	if (fread(*buf, 1, size, fp) != (size_t) size) {
+		goto out_free_buf;
+	}
+	/* Only an upload that reached the switch writes the trailer.
+	 * Without it, there is no telling that the switch ever ran it. */
+	rc = staging_area_trailer_parse(*buf, size, &trailer);
+	if (rc <= 0) {
+		logv("%s was not recorded by an upload, ignoring it", name);
+		rc = -EINVAL;
+		goto out_free_buf;
+	}
+	*len = trailer.image_len;
+	rc = 0;
+	goto out_close;
+out_free_buf:
+	free(*buf);
+	*buf = NULL;
+out_close:
+	fclose(fp);
+out_free_name:
+	free(name);
+	return rc;
+}
+
+void staging_area_applied_save(struct sja1105_spi_setup *spi_setup,
+                               char *config_buf, int config_buf_len)
+{
+	char *trailer = NULL;
+	int   trailer_len;
+	char *name;
+	FILE *fp;
+
+	if (spi_setup->dry_run) {
+		/* Nothing reached the switch, so what it runs is unchanged */
+		logv("dry run: %s" APPLIED_SUFFIX " left as is",
+		     spi_setup->staging_area);
+		return;
+	}
+	name = applied_file_name(spi_setup, "");
+	if (name == NULL) {
+		return;
+	}
+	/* Saved like a staging area, trailer included, which also marks
+	 * the copy as coming from an upload */
+	if (staging_area_trailer_build(config_buf, config_buf_len, 0,
+	                               &trailer, &trailer_len) < 0) {
+		logv("could not index the configuration uploaded");
+		staging_area_applied_clear(spi_setup);
+		goto out;
+	}
+	fp = fopen(name, "wb");
+	if (fp == NULL) {
+		/* Not fatal: the next flush will be a full one */
+		logv("could not open %s for writing", name);
+		goto out;
+	}
+	if (fwrite(config_buf, 1, config_buf_len, fp) !=
+	    (size_t) config_buf_len ||
+	    fwrite(trailer, 1, trailer_len, fp) != (size_t) trailer_len) {
+		logv("could not write %s", name);
+		fclose(fp);
+		/* A partial copy must not be taken for the real one */
+		unlink(name);
+		goto out;
+	}
+	fclose(fp);
+out:
+	free(trailer);
+	free(name);
+}
+
+/*
+ * A configuration that is packed while it is being uploaded is not
+ * kept in memory: it is written to a temporary file as it goes out
+ * (staging_area_applied_open), which becomes the .applied copy once
+ * the upload succeeded (staging_area_applied_commit), or is dropped
+ * (staging_area_applied_discard).
+ */
+FILE *staging_area_applied_open(struct sja1105_spi_setup *spi_setup)
+{
+	char *name;
+	FILE *fp;
+
+	if (spi_setup->dry_run) {
+		return NULL;
+	}
+	name = applied_file_name(spi_setup, APPLIED_TMP);
+	if (name == NULL) {
+		return NULL;
+	}
+	fp = fopen(name, "wb");
+	if (fp == NULL) {
+		logv("could not open %s for writing", name);
+	}
+	free(name);
+	return fp;
+}
+
+void staging_area_applied_discard(struct sja1105_spi_setup *spi_setup)
+{
+	char *name;
+
+	if (spi_setup->dry_run) {
+		return;
+	}
+	name = applied_file_name(spi_setup, APPLIED_TMP);
+	if (name) {
+		unlink(name);
+		free(name);
+	}
+}
+
+/* The trailer is built from the image mapped from the temporary
+ * file, appended to it, and the file is renamed over the copy */
+void staging_area_applied_commit(struct sja1105_spi_setup *spi_setup)
+{
+	char *trailer = NULL;
+	int   trailer_len;
+	char *tmp_name;
+	char *name = NULL;
+	struct stat st;
+	void *image;
+	int   fd = -1;
+	int   rc = -1;
+
+	if (spi_setup->dry_run) {
+		return;
+	}
+	tmp_name = applied_file_name(spi_setup, APPLIED_TMP);
+	name = applied_file_name(spi_setup, "");
+	if (tmp_name == NULL || name == NULL) {
+		goto out;
+	}
+	fd = open(tmp_name, O_RDWR);
+	if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+		goto out;
+	}
+	image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (image == MAP_FAILED) {
+		goto out;
+	}
+	rc = staging_area_trailer_build(image, st.st_size, 0,
+	                                &trailer, &trailer_len);
+	munmap(image, st.st_size);
+	if (rc < 0) {
+		goto out;
+	}
+	rc = -1;
+	if (lseek(fd, 0, SEEK_END) < 0 ||
+	    write(fd, trailer, trailer_len) != trailer_len) {
+		goto out;
+	}
+	if (close(fd) < 0) {
+		fd = -1;
+		goto out;
+	}
+	fd = -1;
+	rc = rename(tmp_name, name);
+out:
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (rc < 0) {
+		/* The switch no longer runs the previous copy either */
+		logv("could not record the configuration uploaded");
+		if (tmp_name) {
+			unlink(tmp_name);
+		}
+		staging_area_applied_clear(spi_setup);
+	}
+	free(trailer);
+	free(tmp_name);
+	free(name);
+}
+
+void staging_area_applied_clear(struct sja1105_spi_setup *spi_setup)
+{
+	char *name;
+
+	if (spi_setup->dry_run) {
+		return;
+	}
+	name = applied_file_name(spi_setup, "");
+	if (name == NULL) {
+		return;
+	}
+	unlink(name);
+	free(name);
+}
+
+/* Find where each table starts within a packed config */
+static int
+config_tables_index(char *buf, int len, struct config_table *tables)
+{
+	struct sja1105_table_header hdr;
+	char *end = buf + len;
+	char *p = buf + SIZE_SJA1105_DEVICE_ID;
+
+	memset(tables, 0, NUM_BLK_IDS * sizeof(*tables));
+	while (p + SIZE_TABLE_HEADER <= end) {
+		sja1105_table_header_unpack(p, &hdr);
+		if (hdr.len == 0) {
+			return 0;
+		}
+		p += SIZE_TABLE_HEADER;
+		if (p + hdr.len * 4 + 4 > end) {
+			break;
+		}
+		tables[hdr.block_id].data = p;
+		tables[hdr.block_id].len  = hdr.len * 4;
+		p += hdr.len * 4 + 4;
+	}
+	return -1;
+}
+
+static int tables_differ(struct config_table *a, struct config_table *b)
+{
+	return (a->len != b->len || memcmp(a->data, b->data, a->len) != 0);
+}
+
+/* Index the entries of a VLAN lookup table by VLAN ID: index[vlanid]
+ * is the offset of its entry in the table, or -1 */
+static void
+vlan_lookup_index(struct config_table *table, int *index)
+{
+	struct sja1105_vlan_lookup_entry entry;
+	int i;
+
+	for (i = 0; i < MAX_VLAN_LOOKUP_COUNT; i++) {
+		index[i] = -1;
+	}
+	for (i = 0; i < table->len; i += SIZE_VLAN_LOOKUP_ENTRY) {
+		sja1105_vlan_lookup_entry_unpack(table->data + i, &entry);
+		index[entry.vlanid % MAX_VLAN_LOOKUP_COUNT] = i;
+	}
+}
+
+/* Both tables are indexed once, then compared VLAN by VLAN */
+static int
+vlan_lookup_apply(struct sja1105_spi_setup *spi_setup,
+                  struct config_table *old, struct config_table *new,
+                  int *commands)
+{
+	struct sja1105_vlan_lookup_entry entry;
+	int *old_index;
+	int *new_index;
+	int vlanid;
+	int rc = 0;
+
+	old_index = malloc(2 * MAX_VLAN_LOOKUP_COUNT * sizeof(int));
+	if (old_index == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	new_index = old_index + MAX_VLAN_LOOKUP_COUNT;
+	vlan_lookup_index(old, old_index);
+	vlan_lookup_index(new, new_index);
+	for (vlanid = 0; vlanid < MAX_VLAN_LOOKUP_COUNT; vlanid++) {
+		if (new_index[vlanid] < 0) {
+			if (old_index[vlanid] < 0) {
+				continue;
+			}
+			/* Remove the VLANs that are gone */
+			logv("vlan lookup: delete vlanid %d", vlanid);
+			rc = sja1105_vlan_lookup_del(spi_setup, vlanid);
+		} else {
+			/* Add the new ones and rewrite the ones that changed */
+			if (old_index[vlanid] >= 0 &&
+			    memcmp(old->data + old_index[vlanid],
+			           new->data + new_index[vlanid],
+			           SIZE_VLAN_LOOKUP_ENTRY) == 0) {
+				continue;
+			}
+			sja1105_vlan_lookup_entry_unpack(new->data +
+			                                 new_index[vlanid],
+			                                 &entry);
+			logv("vlan lookup: write vlanid %d", vlanid);
+			rc = sja1105_vlan_lookup_set(spi_setup, &entry);
+		}
+		if (rc < 0) {
+			goto out;
+		}
+		(*commands)++;
+	}
+out:
+	free(old_index);
+	return rc;
+}
+
+static int
+l2_forwarding_apply(struct sja1105_spi_setup *spi_setup,
+                    struct config_table *old, struct config_table *new,
+                    int *commands)
+{
+	struct sja1105_l2_forwarding_entry entry;
+	int i, rc;
+
+	for (i = 0; i < new->len; i += SIZE_L2_FORWARDING_ENTRY) {
+		if (memcmp(old->data + i, new->data + i,
+		           SIZE_L2_FORWARDING_ENTRY) == 0) {
+			continue;
+		}
+		sja1105_l2_forwarding_entry_unpack(new->data + i, &entry);
+		logv("l2 forwarding: write index %d",
+		     i / SIZE_L2_FORWARDING_ENTRY);
+		rc = sja1105_l2_forwarding_set(spi_setup, &entry,
+		                               i / SIZE_L2_FORWARDING_ENTRY);
+		if (rc < 0) {
+			return rc;
+		}
+		(*commands)++;
+	}
+	return 0;
+}
+
+/* Whether a table that went from old_len to new_len bytes can be
+ * changed by staging_area_delta_flush, without a reset */
+int staging_area_delta_supported(int blk_id, int old_len, int new_len)
+{
+	if (blk_id == BLKID_VLAN_LOOKUP_TABLE) {
+		return 1;
+	}
+	if (blk_id == BLKID_L2_FORWARDING_TABLE && old_len == new_len) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * old_buf is the configuration the switch runs, as returned by
+ * staging_area_applied_load.
+ * Returns 1 if the new configuration is now active on the switch,
+ * 0 if a full flush is needed, and a negative value if the dynamic
+ * reconfiguration was attempted but failed half-way (in which case
+ * a full flush is needed as well).
+ */
+int staging_area_delta_flush(struct sja1105_spi_setup *spi_setup,
+                             char *old_buf, int old_len,
+                             char *config_buf, int config_buf_len)
+{
+	struct config_table *old_tables = NULL;
+	struct config_table *new_tables = NULL;
+	struct sja1105_general_status status;
+	int   commands = 0;
+	int   blk_id;
+	int   rc = 0;
+
+	old_tables = calloc(NUM_BLK_IDS, sizeof(*old_tables));
+	new_tables = calloc(NUM_BLK_IDS, sizeof(*new_tables));
+	if (!old_tables || !new_tables) {
+		goto out;
+	}
+	if (memcmp(old_buf, config_buf, SIZE_SJA1105_DEVICE_ID) != 0 ||
+	    config_tables_index(old_buf, old_len, old_tables) < 0 ||
+	    config_tables_index(config_buf, config_buf_len, new_tables) < 0) {
+		logi("flush: configuration running on the switch "
+		     "is for another device");
+		goto out;
+	}
+	/* Plan: every table that changed must support dynamic
+	 * reconfiguration, otherwise the whole config is uploaded */
+	for (blk_id = 0; blk_id < NUM_BLK_IDS; blk_id++) {
+		if (!tables_differ(&old_tables[blk_id], &new_tables[blk_id])) {
+			continue;
+		}
+		if (staging_area_delta_supported(blk_id,
+		                                 old_tables[blk_id].len,
+		                                 new_tables[blk_id].len)) {
+			continue;
+		}
+		logi("flush: %s changed, it cannot be reconfigured "
+		     "dynamically", sja1105_table_header_name(blk_id) ?
+		     sja1105_table_header_name(blk_id) : "unknown table");
+		goto out;
+	}
+	/* The switch must still be running the config we think it is.
+	 * A reset since the last flush leaves it unconfigured. */
+	if (spi_setup->dry_run == 0) {
+		rc = sja1105_general_status_get(spi_setup, &status);
+		if (rc < 0 || status.configs == 0) {
+			logi("flush: switch is not configured");
+			rc = 0;
+			goto out;
+		}
+	}
+	rc = vlan_lookup_apply(spi_setup,
+	                       &old_tables[BLKID_VLAN_LOOKUP_TABLE],
+	                       &new_tables[BLKID_VLAN_LOOKUP_TABLE],
+	                       &commands);
+	if (rc < 0) {
+		goto out;
+	}
+	rc = l2_forwarding_apply(spi_setup,
+	                         &old_tables[BLKID_L2_FORWARDING_TABLE],
+	                         &new_tables[BLKID_L2_FORWARDING_TABLE],
+	                         &commands);
+	if (rc < 0) {
+		goto out;
+	}
+	if (commands) {
+		logi("flush: dynamic reconfiguration, %d entries "
+		     "written without reset", commands);
+	} else {
+		logi("flush: configuration unchanged, nothing to do");
+	}
+	rc = 1;
+out:
+	free(old_tables);
+	free(new_tables);
+	return rc;
+}
@@ -0,0 +1,227 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <sys/stat.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/staging-area.h>
+#include <common.h>
+
+/*
+ * "config modify" does not rewrite the staging area. It appends the
+ * change to a journal next to it, one "<table>\t<field>\t<value>"
+ * line per command, which staging_area_load replays on top of the
+ * packed image. The journal is folded into a new image (compacted)
+ * whenever the staging area is saved: by upload, show, save, hexdump
+ * and verify, and by modify itself once the journal grows past
+ * JOURNAL_MAX_BYTES.
+ *
+ * The changes are journaled as typed, and a selector such as
+ * "[vlanid>=100]" or "[+vlanid=100]" does not give the same result
+ * twice, so the journal must never be replayed on top of a file that
+ * it was already folded into. Its first line holds the id of the
+ * file it applies to (staging_area_image_id), and it is dropped if
+ * the file has been replaced since, e.g. because the journal could
+ * not be removed after a save was interrupted.
+ */
+#define JOURNAL_SUFFIX    ".journal"
+#define JOURNAL_MAX_BYTES (64 * 1024)
+#define JOURNAL_BASE      "#base"
+
+static char *journal_file_name(const char *staging_area_file)
+{
+	char *name;
+
+	name = malloc(strlen(staging_area_file) + strlen(JOURNAL_SUFFIX) + 1);
+	if (name) {
+		sprintf(name, "%s" JOURNAL_SUFFIX, staging_area_file);
+	}
+	return name;
+}
+
+/* Returns 1 if the journal asks for compaction, 0 if not,
+ * or a negative error code */
+int staging_area_journal_append(const char *staging_area_file,
+                                uint64_t image_id,
+                                const char *table_name,
+                                const char *field_name,
+                                const char *field_val)
+{
+	const char *args[] = {table_name, field_name, field_val};
+	unsigned int i;
+	char *name;
+	FILE *fp;
+	long  size;
+	int   empty;
+	int   rc = 0;
+
+	for (i = 0; i < ARRAY_SIZE(args); i++) {
+		if (strpbrk(args[i], "\t\n")) {
+			loge("\"%s\" cannot contain tabs or newlines", args[i]);
+			return -EINVAL;
+		}
+	}
+	name = journal_file_name(staging_area_file);
+	if (name == NULL) {
+		return -ENOMEM;
+	}
+	empty = !staging_area_journal_pending(staging_area_file);
+	fp = fopen(name, "a");
+	if (fp == NULL) {
+		loge("could not open %s for writing", name);
+		rc = -errno;
+		goto out;
+	}
+	if (empty) {
+		fprintf(fp, JOURNAL_BASE "\t%016" PRIx64 "\n", image_id);
+	}
+	fprintf(fp, "%s\t%s\t%s\n", table_name, field_name, field_val);
+	size = ftell(fp);
+	if (fclose(fp) != 0 || size < 0) {
+		loge("could not write %s", name);
+		rc = -EIO;
+		goto out;
+	}
+	rc = (size > JOURNAL_MAX_BYTES);
+out:
+	free(name);
+	return rc;
+}
+
+/* Returns the number of changes replayed, or a negative error code */
+int staging_area_journal_replay(const char *staging_area_file,
+                                struct sja1105_staging_area *staging_area)
+{
+	char line[MAX_LINE_SIZE];
+	char *table_name;
+	char *field_name;
+	char *field_val;
+	char *name;
+	FILE *fp;
+	uint64_t base;
+	int   count = 0;
+	int   rc = 0;
+
+	name = journal_file_name(staging_area_file);
+	if (name == NULL) {
+		return -ENOMEM;
+	}
+	fp = fopen(name, "r");
+	if (fp == NULL) {
+		/* Nothing was modified since the last save */
+		goto out;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (strncmp(line, JOURNAL_BASE "\t", strlen(JOURNAL_BASE) + 1) == 0) {
+			base = strtoull(line + strlen(JOURNAL_BASE) + 1, NULL, 16);
+			if (base != staging_area_image_id(staging_area)) {
+				logv("%s is for an older %s, dropping it",
+				     name, staging_area_file);
+				fclose(fp);
+				staging_area_journal_clear(staging_area_file);
+				goto out;
+			}
+			continue;
+		}
+		table_name = line;
+		field_name = strchr(table_name, '\t');
+		field_val  = field_name ? strchr(field_name + 1, '\t') : NULL;
+		if (field_val == NULL) {
+			loge("%s: malformed entry %d", name, count + 1);
+			rc = -EINVAL;
+			goto out_close;
+		}
+		*field_name++ = '\0';
+		*field_val++  = '\0';
+		rc = staging_area_modify(staging_area, table_name,
+		                         field_name, field_val);
+		if (rc < 0) {
+			loge("%s: could not replay entry %d", name, count + 1);
+			goto out_close;
+		}
+		count++;
+	}
+	if (count) {
+		logv("replayed %d changes from %s", count, name);
+		/* No longer what the XML file describes */
+		staging_area->xml_hash = 0;
+	}
+	rc = count;
+out_close:
+	fclose(fp);
+out:
+	free(name);
+	return rc;
+}
+
+int staging_area_journal_pending(const char *staging_area_file)
+{
+	struct stat st;
+	char *name;
+	int   pending;
+
+	name = journal_file_name(staging_area_file);
+	if (name == NULL) {
+		return 0;
+	}
+	pending = (stat(name, &st) == 0 && st.st_size > 0);
+	free(name);
+	return pending;
+}
+
+void staging_area_journal_clear(const char *staging_area_file)
+{
+	char *name;
+
+	name = journal_file_name(staging_area_file);
+	if (name == NULL) {
+		return;
+	}
+	unlink(name);
+	free(name);
+}
+
+/* Fold the journal into the staging area file, if there is one.
+ * The staging area must have been loaded (and the journal replayed). */
+int staging_area_journal_compact(const char *staging_area_file,
+                                 struct sja1105_staging_area *staging_area)
+{
+	if (!staging_area_journal_pending(staging_area_file)) {
+		return 0;
+	}
+	logv("compacting the staging area journal");
+	return staging_area_save(staging_area_file, staging_area);
+}
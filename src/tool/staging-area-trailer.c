@@ -0,0 +1,271 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/static-config.h>
+#include <lib/include/compact-config.h>
+#include <lib/include/gtable.h>
+#include <lib/include/spi.h>
+#include <common.h>
+
+/*
+ * Staging area format v2 is the upload image, unchanged, followed by:
+ *
+ *   toc_count x { u32 offset, u32 len, u32 block_id, u32 count, u64 hash }
+ *   u64 xml_hash
+ *   u64 timestamp
+ *   u32 image_len
+ *   u32 toc_count
+ *   u32 version
+ *   u32 magic
+ *
+ * All trailer fields are little endian. offset and len describe the
+ * table data (without header and data CRC) within the image, and hash
+ * is the FNV-1a hash of that data. The fixed-size footer at the end of
+ * the file is what identifies the format: files without it are taken
+ * to be plain (legacy) upload images.
+ */
+#define STAGING_AREA_MAGIC     0x32414A53 /* "SJA2" */
+#define STAGING_AREA_VERSION   2
+#define SIZE_TOC_ENTRY         24
+#define SIZE_TRAILER_FOOTER    32
+
+static void put_le(char *p, uint64_t val, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++) {
+		p[i] = (val >> (8 * i)) & 0xFF;
+	}
+}
+
+static uint64_t get_le(const char *p, int bytes)
+{
+	uint64_t val = 0;
+	int i;
+
+	for (i = 0; i < bytes; i++) {
+		val |= (uint64_t) (uint8_t) p[i] << (8 * i);
+	}
+	return val;
+}
+
+/* Fill in the table of contents by walking the table headers
+ * of a packed image */
+static int
+staging_area_toc_build(const char *image, unsigned int image_len,
+                       struct staging_area_trailer *trailer)
+{
+	struct sja1105_table_header hdr;
+	struct staging_area_toc_entry *toc;
+	uint64_t device_id;
+	const char *p = image + SIZE_SJA1105_DEVICE_ID;
+	const char *end = image + image_len;
+	int blk_idx;
+
+	gtable_unpack((void*) image, &device_id, 31, 0, 4);
+	trailer->toc_count = 0;
+	while (p + SIZE_TABLE_HEADER <= end) {
+		sja1105_table_header_unpack((void*) p, &hdr);
+		if (hdr.len == 0) {
+			return 0;
+		}
+		p += SIZE_TABLE_HEADER;
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx < 0 &&
+		    sja1105_table_skipped_entry_size(hdr.block_id) &&
+		    p + hdr.len * 4 + 4 <= end) {
+			/* Not indexed, but part of the image all the same */
+			p += hdr.len * 4 + 4;
+			continue;
+		}
+		if (blk_idx < 0 || trailer->toc_count >= BLK_IDX_MAX ||
+		    p + hdr.len * 4 + 4 > end) {
+			break;
+		}
+		toc = &trailer->toc[trailer->toc_count++];
+		toc->offset   = p - image;
+		toc->len      = hdr.len * 4;
+		toc->block_id = hdr.block_id;
+		toc->count    = toc->len /
+		                sja1105_table_entry_size(blk_idx, device_id);
+		toc->hash     = sja1105_fnv1a64(p, toc->len);
+		p += hdr.len * 4 + 4;
+	}
+	loge("cannot build table of contents: malformed image");
+	return -EINVAL;
+}
+
+/* Returns a newly allocated trailer for the given upload image */
+int staging_area_trailer_build(const char *image, unsigned int image_len,
+                               uint64_t xml_hash, char **buf, int *len)
+{
+	struct staging_area_trailer trailer;
+	char *p;
+	int i, rc;
+
+	memset(&trailer, 0, sizeof(trailer));
+	rc = staging_area_toc_build(image, image_len, &trailer);
+	if (rc < 0) {
+		return rc;
+	}
+	*len = trailer.toc_count * SIZE_TOC_ENTRY + SIZE_TRAILER_FOOTER;
+	*buf = p = malloc(*len);
+	if (p == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	for (i = 0; i < trailer.toc_count; i++) {
+		put_le(p,      trailer.toc[i].offset,   4);
+		put_le(p + 4,  trailer.toc[i].len,      4);
+		put_le(p + 8,  trailer.toc[i].block_id, 4);
+		put_le(p + 12, trailer.toc[i].count,    4);
+		put_le(p + 16, trailer.toc[i].hash,     8);
+		p += SIZE_TOC_ENTRY;
+	}
+	put_le(p,      xml_hash,             8);
+	put_le(p + 8,  (uint64_t) time(NULL), 8);
+	put_le(p + 16, image_len,            4);
+	put_le(p + 20, trailer.toc_count,    4);
+	put_le(p + 24, STAGING_AREA_VERSION, 4);
+	put_le(p + 28, STAGING_AREA_MAGIC,   4);
+	return 0;
+}
+
+/* Returns 1 and fills in trailer if the file has a v2 trailer,
+ * 0 if it is a legacy image, negative if the trailer is corrupt */
+int staging_area_trailer_parse(const char *buf, size_t len,
+                               struct staging_area_trailer *trailer)
+{
+	const char *footer = buf + len - SIZE_TRAILER_FOOTER;
+	const char *p;
+	int i;
+
+	memset(trailer, 0, sizeof(*trailer));
+	if (len < SIZE_TRAILER_FOOTER ||
+	    get_le(footer + 28, 4) != STAGING_AREA_MAGIC) {
+		return 0;
+	}
+	if (get_le(footer + 24, 4) != STAGING_AREA_VERSION) {
+		loge("unsupported staging area version %" PRIu64,
+		     get_le(footer + 24, 4));
+		return -EINVAL;
+	}
+	trailer->xml_hash  = get_le(footer,      8);
+	trailer->timestamp = get_le(footer + 8,  8);
+	trailer->image_len = get_le(footer + 16, 4);
+	trailer->toc_count = get_le(footer + 20, 4);
+	if (trailer->toc_count > BLK_IDX_MAX ||
+	    (uint64_t) trailer->image_len + trailer->toc_count *
+	    SIZE_TOC_ENTRY + SIZE_TRAILER_FOOTER != len) {
+		loge("staging area trailer is corrupt");
+		return -EINVAL;
+	}
+	p = buf + trailer->image_len;
+	for (i = 0; i < trailer->toc_count; i++) {
+		struct staging_area_toc_entry *toc = &trailer->toc[i];
+
+		toc->offset   = get_le(p,      4);
+		toc->len      = get_le(p + 4,  4);
+		toc->block_id = get_le(p + 8,  4);
+		toc->count    = get_le(p + 12, 4);
+		toc->hash     = get_le(p + 16, 8);
+		if ((uint64_t) toc->offset + toc->len + 4 > trailer->image_len ||
+		    sja1105_blk_idx_from_id(toc->block_id) < 0) {
+			loge("staging area table of contents is corrupt");
+			return -EINVAL;
+		}
+		p += SIZE_TOC_ENTRY;
+	}
+	return 1;
+}
+
+void staging_area_trailer_show(const struct staging_area_trailer *trailer)
+{
+	const char *name;
+	time_t timestamp = trailer->timestamp;
+	char date[64];
+	int i;
+
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S",
+	         localtime(&timestamp));
+	printf("Staging area format v%d, saved %s\n",
+	       STAGING_AREA_VERSION, date);
+	if (trailer->xml_hash) {
+		printf("Source XML hash %016" PRIx64 "\n", trailer->xml_hash);
+	}
+	printf("Upload image: %u bytes, %d tables\n",
+	       trailer->image_len, trailer->toc_count);
+	for (i = 0; i < trailer->toc_count; i++) {
+		name = sja1105_table_header_name(trailer->toc[i].block_id);
+		printf("  %-40s offset %5u, %5u bytes, %4u entries, "
+		       "hash %016" PRIx64 "\n", name,
+		       trailer->toc[i].offset, trailer->toc[i].len,
+		       trailer->toc[i].count, trailer->toc[i].hash);
+	}
+}
+
+/* Hash of a whole file, to identify the XML a config came from */
+int staging_area_file_hash(const char *file_name, uint64_t *hash)
+{
+	char  *buf;
+	FILE  *fp;
+	long   size;
+	int    rc = -EIO;
+
+	fp = fopen(file_name, "rb");
+	if (fp == NULL) {
+		return -errno;
+	}
+	if (fseek(fp, 0, SEEK_END) < 0 || (size = ftell(fp)) < 0) {
+		goto out_close;
+	}
+	rewind(fp);
+	buf = malloc(size + 1);
+	if (buf == NULL) {
+		rc = -ENOMEM;
+		goto out_close;
+	}
+	if (fread(buf, 1, size, fp) == (size_t) size) {
+		*hash = sja1105_fnv1a64(buf, size);
+		rc = 0;
+	}
+	free(buf);
+out_close:
+	fclose(fp);
+	return rc;
+}
@@ -0,0 +1,469 @@
+/******************************************************************************
+ * Copyright (c) 2017, NXP Semiconductors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "internal.h"
+/* From libsja1105 */
+#include <lib/include/staging-area.h>
+#include <common.h>
+
+/*
+ * Each "config modify" records how to undo itself in a log next to the
+ * staging area: the lines of staging_area_change_log_stop, which set
+ * every field it wrote back to its previous value, followed by an empty
+ * line. "config undo" replays the last groups backwards and drops them
+ * from the log. Loading a new configuration (load, default, new) clears
+ * the log, which otherwise keeps its newest UNDO_MAX_BYTES / 2 once it
+ * grows past UNDO_MAX_BYTES.
+ *
+ * "config begin" opens a transaction by writing down where the log
+ * stands. Until "config commit", flushes are held back, and "config
+ * abort" undoes everything logged since then.
+ */
+#define UNDO_SUFFIX    ".undo"
+#define TXN_SUFFIX     ".txn"
+#define UNDO_MAX_BYTES (256 * 1024)
+
+static char *undo_file_name(const char *staging_area_file, const char *suffix)
+{
+	char *name;
+
+	name = malloc(strlen(staging_area_file) + strlen(suffix) + 1);
+	if (name) {
+		sprintf(name, "%s%s", staging_area_file, suffix);
+	}
+	return name;
+}
+
+static long file_size(const char *name)
+{
+	struct stat st;
+
+	if (stat(name, &st) < 0) {
+		return 0;
+	}
+	return st.st_size;
+}
+
+/* The whole log, NUL-terminated. A missing log is empty. */
+static int undo_log_read(const char *name, char **buf, long *len)
+{
+	FILE *fp;
+	int   rc = 0;
+
+	*len = file_size(name);
+	*buf = malloc(*len + 1);
+	if (*buf == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	(*buf)[0] = '\0';
+	if (*len == 0) {
+		return 0;
+	}
+	fp = fopen(name, "r");
+	if (fp == NULL) {
+		loge("could not open %s for reading", name);
+		rc = -errno;
+		goto out_free;
+	}
+	if (fread(*buf, 1, *len, fp) != (size_t) *len) {
+		loge("could not read %s", name);
+		rc = -EIO;
+	}
+	fclose(fp);
+	if (rc < 0) {
+		goto out_free;
+	}
+	(*buf)[*len] = '\0';
+	return 0;
+out_free:
+	free(*buf);
+	*buf = NULL;
+	return rc;
+}
+
+/* Offsets at which the groups of the log start. Returns their number. */
+static int undo_log_groups(const char *buf, long len, long **starts)
+{
+	long start = 0;
+	long pos;
+	int  count = 0;
+
+	for (pos = 0; pos < len; pos++) {
+		if (buf[pos] == '\n' && (pos == 0 || buf[pos - 1] == '\n')) {
+			count++;
+		}
+	}
+	*starts = malloc((count + 1) * sizeof(long));
+	if (*starts == NULL) {
+		loge("malloc failed");
+		return -ENOMEM;
+	}
+	count = 0;
+	for (pos = 0; pos < len; pos++) {
+		if (buf[pos] == '\n' && (pos == 0 || buf[pos - 1] == '\n')) {
+			(*starts)[count++] = start;
+			start = pos + 1;
+		}
+	}
+	return count;
+}
+
+int staging_area_txn_open(const char *staging_area_file)
+{
+	char *name;
+	int   open;
+
+	name = undo_file_name(staging_area_file, TXN_SUFFIX);
+	if (name == NULL) {
+		return 0;
+	}
+	open = (access(name, F_OK) == 0);
+	free(name);
+	return open;
+}
+
+/* Where the undo log stood at "config begin" */
+static long txn_start(const char *staging_area_file)
+{
+	char *name;
+	FILE *fp;
+	long  start = 0;
+
+	name = undo_file_name(staging_area_file, TXN_SUFFIX);
+	if (name == NULL) {
+		return 0;
+	}
+	fp = fopen(name, "r");
+	if (fp) {
+		if (fscanf(fp, "%ld", &start) != 1) {
+			start = 0;
+		}
+		fclose(fp);
+	}
+	free(name);
+	return start;
+}
+
+int staging_area_txn_begin(const char *staging_area_file)
+{
+	char *undo_name;
+	char *name;
+	FILE *fp;
+	int   rc = 0;
+
+	if (staging_area_txn_open(staging_area_file)) {
+		loge("A transaction is already open");
+		return -EBUSY;
+	}
+	undo_name = undo_file_name(staging_area_file, UNDO_SUFFIX);
+	name = undo_file_name(staging_area_file, TXN_SUFFIX);
+	if (undo_name == NULL || name == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	fp = fopen(name, "w");
+	if (fp == NULL) {
+		loge("could not open %s for writing", name);
+		rc = -errno;
+		goto out;
+	}
+	fprintf(fp, "%ld\n", file_size(undo_name));
+	if (fclose(fp) != 0) {
+		loge("could not write %s", name);
+		rc = -EIO;
+	}
+out:
+	free(undo_name);
+	free(name);
+	return rc;
+}
+
+void staging_area_txn_end(const char *staging_area_file)
+{
+	char *name;
+
+	name = undo_file_name(staging_area_file, TXN_SUFFIX);
+	if (name == NULL) {
+		return;
+	}
+	unlink(name);
+	free(name);
+}
+
+void staging_area_undo_clear(const char *staging_area_file)
+{
+	char *name;
+
+	name = undo_file_name(staging_area_file, UNDO_SUFFIX);
+	if (name == NULL) {
+		return;
+	}
+	unlink(name);
+	free(name);
+}
+
+/* Keep the newest groups, in no more than half of UNDO_MAX_BYTES */
+static int undo_log_trim(const char *name)
+{
+	char *tmp_name;
+	char *buf;
+	long *starts = NULL;
+	long  len;
+	FILE *fp;
+	int   count;
+	int   i;
+	int   rc;
+
+	rc = undo_log_read(name, &buf, &len);
+	if (rc < 0) {
+		return rc;
+	}
+	count = undo_log_groups(buf, len, &starts);
+	if (count < 0) {
+		rc = count;
+		goto out;
+	}
+	for (i = 0; i < count; i++) {
+		if (len - starts[i] <= UNDO_MAX_BYTES / 2) {
+			break;
+		}
+	}
+	tmp_name = malloc(strlen(name) + 2);
+	if (tmp_name == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	sprintf(tmp_name, "%s~", name);
+	fp = fopen(tmp_name, "w");
+	if (fp == NULL) {
+		loge("could not open %s for writing", tmp_name);
+		rc = -errno;
+		goto out_free_name;
+	}
+	if (i < count) {
+		fwrite(buf + starts[i], 1, len - starts[i], fp);
+	}
+	if (fclose(fp) != 0 || rename(tmp_name, name) < 0) {
+		loge("could not write %s", name);
+		unlink(tmp_name);
+		rc = -EIO;
+		goto out_free_name;
+	}
+	logv("dropped the %d oldest changes from %s", i, name);
+out_free_name:
+	free(tmp_name);
+out:
+	free(starts);
+	free(buf);
+	return rc;
+}
+
+/* Record what a command changed, NULL for nothing, as one group */
+int staging_area_undo_push(const char *staging_area_file, const char *changes)
+{
+	char *name;
+	FILE *fp;
+	long  size;
+	int   rc = 0;
+
+	name = undo_file_name(staging_area_file, UNDO_SUFFIX);
+	if (name == NULL) {
+		return -ENOMEM;
+	}
+	fp = fopen(name, "a");
+	if (fp == NULL) {
+		loge("could not open %s for writing", name);
+		rc = -errno;
+		goto out;
+	}
+	fprintf(fp, "%s\n", changes ? changes : "");
+	size = ftell(fp);
+	if (fclose(fp) != 0 || size < 0) {
+		loge("could not write %s", name);
+		rc = -EIO;
+		goto out;
+	}
+	if (size > UNDO_MAX_BYTES && !staging_area_txn_open(staging_area_file)) {
+		rc = undo_log_trim(name);
+	}
+out:
+	free(name);
+	return rc;
+}
+
+/* Forget the group pushed last, for a command that failed after all */
+void staging_area_undo_drop(const char *staging_area_file)
+{
+	char *name;
+	char *buf = NULL;
+	long *starts = NULL;
+	long  len;
+	int   count;
+
+	name = undo_file_name(staging_area_file, UNDO_SUFFIX);
+	if (name == NULL || undo_log_read(name, &buf, &len) < 0) {
+		goto out;
+	}
+	count = undo_log_groups(buf, len, &starts);
+	if (count > 0 && truncate(name, starts[count - 1]) < 0) {
+		loge("could not truncate %s", name);
+	}
+out:
+	free(starts);
+	free(buf);
+	free(name);
+}
+
+/* Revert one group, from its last line to its first */
+static int undo_group(struct sja1105_staging_area *staging_area,
+                      char *group, const char *name)
+{
+	char *table_name;
+	char *field_name;
+	char *field_val;
+	char *line;
+	int   rc;
+
+	line = strrchr(group, '\n');
+	if (line) {
+		*line = '\0';
+	}
+	while (*group) {
+		line = strrchr(group, '\n');
+		if (line) {
+			*line++ = '\0';
+		} else {
+			line = group;
+		}
+		table_name = line;
+		field_name = strchr(table_name, '\t');
+		field_val  = field_name ? strchr(field_name + 1, '\t') : NULL;
+		if (field_val == NULL) {
+			loge("%s: malformed entry \"%s\"", name, line);
+			return -EINVAL;
+		}
+		*field_name++ = '\0';
+		*field_val++  = '\0';
+		rc = staging_area_modify(staging_area, table_name,
+		                         field_name, field_val);
+		if (rc < 0) {
+			loge("%s: could not undo the change of %s", name,
+			     field_name);
+			return rc;
+		}
+		if (line == group) {
+			break;
+		}
+	}
+	return 0;
+}
+
+/* Undo the last count commands, all those since "config begin" if
+ * count is 0, and save the staging area.
+ * Returns the number of commands undone. */
+int staging_area_undo(const char *staging_area_file,
+                      struct sja1105_staging_area *staging_area,
+                      int count)
+{
+	long *starts = NULL;
+	long  first_offset = 0;
+	char *name;
+	char *buf = NULL;
+	long  len;
+	int   groups;
+	int   first;
+	int   in_txn;
+	int   i;
+	int   rc;
+
+	name = undo_file_name(staging_area_file, UNDO_SUFFIX);
+	if (name == NULL) {
+		return -ENOMEM;
+	}
+	rc = undo_log_read(name, &buf, &len);
+	if (rc < 0) {
+		goto out;
+	}
+	groups = undo_log_groups(buf, len, &starts);
+	if (groups < 0) {
+		rc = groups;
+		goto out;
+	}
+	in_txn = staging_area_txn_open(staging_area_file);
+	if (in_txn) {
+		first_offset = txn_start(staging_area_file);
+	}
+	for (first = 0; first < groups; first++) {
+		if (starts[first] >= first_offset) {
+			break;
+		}
+	}
+	if (count == 0) {
+		count = groups - first;
+	}
+	if (count > groups - first) {
+		loge("Only %d changes can be undone%s", groups - first,
+		     in_txn ? " since config begin" : "");
+		rc = -ERANGE;
+		goto out;
+	}
+	for (i = groups - 1; i >= groups - count; i--) {
+		/* Groups end with an empty line */
+		buf[(i + 1 < groups) ? starts[i + 1] - 1 : len - 1] = '\0';
+		rc = undo_group(staging_area, buf + starts[i], name);
+		if (rc < 0) {
+			goto out;
+		}
+	}
+	/* No longer what the XML file describes */
+	staging_area->xml_hash = 0;
+	rc = staging_area_save(staging_area_file, staging_area);
+	if (rc < 0) {
+		goto out;
+	}
+	if (count && truncate(name, starts[groups - count]) < 0) {
+		loge("could not truncate %s", name);
+		rc = -errno;
+		goto out;
+	}
+	logv("undid %d changes", count);
+	rc = count;
+out:
+	free(starts);
+	free(buf);
+	free(name);
+	return rc;
+}
@@ -30,17 +30,21 @@
  *****************************************************************************/
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include "internal.h"
 /* From libsja1105 */
 #include <lib/include/static-config.h>
+#include <lib/include/compact-config.h>
 #include <lib/include/staging-area.h>
 #include <lib/include/port-control.h>
+#include <lib/include/device.h>
 #include <lib/include/gtable.h>
 #include <lib/include/spi.h>
 #include <lib/include/status.h>
@@ -85,8 +89,10 @@ out:
 int
 staging_area_hexdump(const char *staging_area_file)
 {
+	struct staging_area_trailer trailer;
 	struct stat stat;
 	unsigned int len;
+	int dumped;
 	char *buf;
 	int fd;
 	int rc;
@@ -120,6 +126,15 @@ staging_area_hexdump(const char *staging_area_file)
 		goto invalid_staging_area_error;
 	}
 	logi("static config: dumped %d bytes", rc);
+	dumped = rc;
+	rc = staging_area_trailer_parse(buf, len, &trailer);
+	if (rc < 0) {
+		goto invalid_staging_area_error;
+	}
+	if (rc > 0) {
+		staging_area_trailer_show(&trailer);
+	}
+	rc = dumped;
 filesystem_error3:
 	free(buf);
 filesystem_error2:
@@ -132,19 +147,358 @@ invalid_staging_area_error:
 	return rc;
 }
 
+/* Check the staging area as it is stored, without unpacking it.
+ * The trailer of a v2 staging area must match the image, whose final
+ * header CRC must be valid as well. */
+int
+staging_area_verify(const char *staging_area_file, int check_valid)
+{
+	struct staging_area_trailer trailer;
+	struct sja1105_table_header final_header;
+	struct stat stat;
+	unsigned int image_len;
+	char *base;
+	int fd;
+	int rc;
+
+	fd = open(staging_area_file, O_RDONLY);
+	if (fd < 0) {
+		loge("Staging area %s does not exist!", staging_area_file);
+		rc = fd;
+		sja1105_err_remap(rc, SJA1105_ERR_FILESYSTEM);
+		return rc;
+	}
+	rc = fstat(fd, &stat);
+	if (rc < 0 || stat.st_size == 0) {
+		loge("could not read file size");
+		close(fd);
+		rc = -EINVAL;
+		goto invalid_staging_area_error;
+	}
+	base = mmap(NULL, stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		loge("failed to map staging area from file %s",
+		     staging_area_file);
+		rc = -EINVAL;
+		goto invalid_staging_area_error;
+	}
+	rc = staging_area_trailer_parse(base, stat.st_size, &trailer);
+	if (rc < 0) {
+		goto out_unmap;
+	}
+	image_len = rc ? trailer.image_len : stat.st_size;
+	rc = sja1105_static_config_verify(base, image_len, check_valid);
+	if (rc < 0) {
+		goto out_unmap;
+	}
+	if ((unsigned int) rc != image_len) {
+		loge("staging area has %u extra bytes", image_len - rc);
+		rc = -EINVAL;
+		goto out_unmap;
+	}
+	if (trailer.image_len) {
+		sja1105_table_header_unpack(base + image_len - SIZE_TABLE_HEADER,
+		                            &final_header);
+		if ((final_header.crc & 0xFFFFFFFF) !=
+		    ether_crc32_le(base, image_len - 4)) {
+			loge("Final header CRC is invalid");
+			rc = -EINVAL;
+			goto out_unmap;
+		}
+	}
+	logv("staging area is valid: %u bytes", image_len);
+	rc = 0;
+out_unmap:
+	munmap(base, stat.st_size);
+	if (rc == 0) {
+		return rc;
+	}
+invalid_staging_area_error:
+	sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
+	return rc;
+}
+
+/* The staging area file is mapped rather than read, and indexed by
+ * table header. A table is CRC-checked and unpacked into the static
+ * config only on its first use (staging_area_table_get), so that
+ * commands working on one table do not pay for all the others.
+ */
+enum staging_table_state {
+	STAGING_TABLE_ABSENT = 0,
+	STAGING_TABLE_PACKED,
+	STAGING_TABLE_UNPACKED,
+};
+
+struct sja1105_staging_area_map {
+	char  *base;
+	size_t len;
+	/* Length of the upload image, without the v2 trailer */
+	size_t image_len;
+	/* v2 staging areas also have the final header CRC filled in */
+	int    has_trailer;
+	struct {
+		int   state;
+		/* Table data, right after its header */
+		char *data;
+		int   len;
+	} tables[BLK_IDX_MAX];
+};
+
+static int
+staging_area_device_id_get(struct sja1105_staging_area *staging_area)
+{
+	struct sja1105_staging_area_map *map = staging_area->map;
+
+	if (map->image_len < SIZE_SJA1105_DEVICE_ID) {
+		loge("staging area is too short");
+		return -EINVAL;
+	}
+	gtable_unpack(map->base, &staging_area->static_config.device_id,
+	              31, 0, 4);
+	logv("Device ID is 0x%08" PRIx64 " (%s)",
+	     staging_area->static_config.device_id,
+	     sja1105_device_id_string_get(staging_area->static_config.device_id,
+	                                  SJA1105_PART_NR_DONT_CARE));
+	if (DEVICE_ID_VALID(staging_area->static_config.device_id) == 0) {
+		loge("Invalid device id in staging area: 0x%08" PRIx64,
+		     staging_area->static_config.device_id);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/* v2 staging areas: the table of contents gives the location of
+ * every table directly, so there are no headers to walk */
+static int
+staging_area_index_toc(struct sja1105_staging_area *staging_area,
+                       const struct staging_area_trailer *trailer)
+{
+	struct sja1105_staging_area_map *map = staging_area->map;
+	int blk_idx;
+	int i;
+
+	for (i = 0; i < trailer->toc_count; i++) {
+		const struct staging_area_toc_entry *toc = &trailer->toc[i];
+
+		blk_idx = sja1105_blk_idx_from_id(toc->block_id);
+		if (map->tables[blk_idx].state != STAGING_TABLE_ABSENT) {
+			loge("staging area table of contents is malformed");
+			return -EINVAL;
+		}
+		map->tables[blk_idx].state = STAGING_TABLE_PACKED;
+		map->tables[blk_idx].data  = map->base + toc->offset;
+		map->tables[blk_idx].len   = toc->len;
+	}
+	staging_area->xml_hash  = trailer->xml_hash;
+	staging_area->timestamp = trailer->timestamp;
+	return 0;
+}
+
+static int
+staging_area_index(struct sja1105_staging_area *staging_area)
+{
+	struct sja1105_staging_area_map *map = staging_area->map;
+	struct sja1105_table_header hdr;
+	uint64_t computed_crc;
+	char *end = map->base + map->image_len;
+	char *p = map->base + SIZE_SJA1105_DEVICE_ID;
+	int blk_idx;
+
+	while (p + SIZE_TABLE_HEADER <= end) {
+		sja1105_table_header_unpack(p, &hdr);
+		/* This should match on last table header */
+		if (hdr.len == 0) {
+			return 0;
+		}
+		/* Print table header with same verbosity level as "logv" */
+		if (SJA1105_VERBOSE_CONDITION) {
+			sja1105_table_header_show(&hdr);
+		}
+		computed_crc = ether_crc32_le(p, SIZE_TABLE_HEADER - 4);
+		if ((hdr.crc & 0xFFFFFFFF) != computed_crc) {
+			loge("Table header CRC is invalid, exiting.");
+			return -EINVAL;
+		}
+		p += SIZE_TABLE_HEADER;
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx < 0) {
+			if (sja1105_table_skipped_entry_size(hdr.block_id) == 0) {
+				loge("Unknown Table %" PRIX64, hdr.block_id);
+				return -EINVAL;
+			}
+			/* Still uploaded with the image as it is stored */
+			p += hdr.len * 4 + 4;
+			continue;
+		}
+		if (p + hdr.len * 4 + 4 > end ||
+		    map->tables[blk_idx].state != STAGING_TABLE_ABSENT) {
+			loge("staging area is malformed");
+			return -EINVAL;
+		}
+		map->tables[blk_idx].state = STAGING_TABLE_PACKED;
+		map->tables[blk_idx].data  = p;
+		map->tables[blk_idx].len   = hdr.len * 4;
+		p += hdr.len * 4 + 4;
+	}
+	loge("staging area has no final header");
+	return -EINVAL;
+}
+
+static int
+staging_area_table_unpack(struct sja1105_staging_area *staging_area,
+                          int blk_idx)
+{
+	struct sja1105_static_config *config = &staging_area->static_config;
+	struct sja1105_staging_area_map *map = staging_area->map;
+	const struct sja1105_table_desc *desc;
+	uint64_t computed_crc;
+	uint64_t read_crc;
+	char *data = map->tables[blk_idx].data;
+	int len = map->tables[blk_idx].len;
+	int entry_size;
+	int count;
+	int rc;
+
+	desc = sja1105_table_desc_get(blk_idx);
+	entry_size = sja1105_table_entry_size(blk_idx, config->device_id);
+
+	computed_crc = ether_crc32_le(data, len);
+	gtable_unpack(data + len, &read_crc, 31, 0, 4);
+	if (computed_crc != read_crc) {
+		loge("Data CRC is invalid for %s, exiting.", desc->name);
+		loge("Read %" PRIX64 ", computed %" PRIX64,
+		     read_crc, computed_crc);
+		return -EINVAL;
+	}
+	count = len / entry_size;
+	if (count * entry_size != len) {
+		loge("WARNING: Incorrect table length for %s", desc->name);
+	}
+	if (count > desc->max_count) {
+		loge("There can be no more than %d %s entries (%d present)",
+		     desc->max_count, desc->name, count);
+		return -ERANGE;
+	}
+	rc = sja1105_table_entries_unpack(config, blk_idx, data, count);
+	if (rc < 0) {
+		return rc;
+	}
+	*(int*) ((char*) config + desc->count_offset) = count;
+	map->tables[blk_idx].state = STAGING_TABLE_UNPACKED;
+	logv("unpacked %s: %d entries", desc->name, count);
+	return 0;
+}
+
+/* Make sure the table with the given block ID is present in
+ * staging_area->static_config. A no-op for staging areas that
+ * were not loaded from a file (or NULL), or for tables already
+ * unpacked.
+ */
+int staging_area_table_get(struct sja1105_staging_area *staging_area,
+                           uint64_t block_id)
+{
+	struct sja1105_static_config *config = &staging_area->static_config;
+	int blk_idx;
+	int rc;
+	int i;
+
+	blk_idx = sja1105_blk_idx_from_id(block_id);
+	if (staging_area == NULL || staging_area->map == NULL || blk_idx < 0) {
+		return 0;
+	}
+	if (staging_area->map->tables[blk_idx].state == STAGING_TABLE_ABSENT) {
+		/* Empty, but from now on it may be given entries */
+		staging_area->map->tables[blk_idx].state = STAGING_TABLE_UNPACKED;
+		return 0;
+	}
+	if (staging_area->map->tables[blk_idx].state != STAGING_TABLE_PACKED) {
+		return 0;
+	}
+	rc = staging_area_table_unpack(staging_area, blk_idx);
+	if (rc < 0) {
+		sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
+		return rc;
+	}
+	/* Tables whose packed form depends on another table:
+	 * the index of static FDB entries is a hash that depends on
+	 * the L2 lookup parameters, and may change with them. The VL
+	 * lookup entries take their format from the general parameters.
+	 */
+	switch (block_id) {
+	case BLKID_L2_LOOKUP_TABLE:
+		rc = staging_area_table_get(staging_area,
+		                            BLKID_L2_LOOKUP_PARAMS_TABLE);
+		break;
+	case BLKID_L2_LOOKUP_PARAMS_TABLE:
+		rc = staging_area_table_get(staging_area,
+		                            BLKID_L2_LOOKUP_TABLE);
+		break;
+	case BLKID_VL_LOOKUP_TABLE:
+		rc = staging_area_table_get(staging_area,
+		                            BLKID_GENERAL_PARAMS_TABLE);
+		for (i = 0; i < config->vl_lookup_count; i++) {
+			config->vl_lookup[i].format =
+				config->general_params[0].vllupformat;
+		}
+		break;
+	}
+	return rc;
+}
+
+int staging_area_tables_get_all(struct sja1105_staging_area *staging_area)
+{
+	int blk_idx;
+	int rc;
+
+	if (staging_area->map == NULL) {
+		return 0;
+	}
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		rc = staging_area_table_get(staging_area,
+		         sja1105_table_desc_get(blk_idx)->block_id);
+		if (rc < 0) {
+			return rc;
+		}
+	}
+	return 0;
+}
+
+void staging_area_release(struct sja1105_staging_area *staging_area)
+{
+	if (staging_area->map == NULL) {
+		return;
+	}
+	munmap(staging_area->map->base, staging_area->map->len);
+	free(staging_area->map);
+	staging_area->map = NULL;
+}
+
 int
 staging_area_load(const char *staging_area_file,
                   struct sja1105_staging_area *staging_area)
 {
-	struct sja1105_static_config *static_config;
+	struct sja1105_static_config *config;
+	struct sja1105_staging_area_map *map;
+	struct staging_area_trailer trailer;
 	struct stat stat;
-	unsigned int staging_area_len;
-	char *buf;
+	int blk_idx;
 	int fd;
 	int rc;
 
-	static_config = &staging_area->static_config;
-
+	/* Only the table counts need to start at zero: entries are
+	 * written before being counted. Not clearing the whole static
+	 * config keeps its untouched pages from being faulted in. */
+	config = &staging_area->static_config;
+	config->device_id = 0;
+	memset(config->entries_in_fdb_bin, 0, sizeof(config->entries_in_fdb_bin));
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		*(int*) ((char*) config +
+		         sja1105_table_desc_get(blk_idx)->count_offset) = 0;
+	}
+	staging_area->map = NULL;
+	staging_area->xml_hash = 0;
+	staging_area->timestamp = 0;
 	fd = open(staging_area_file, O_RDONLY);
 	if (fd < 0) {
 		loge("Staging area %s does not exist!", staging_area_file);
@@ -156,143 +510,352 @@ staging_area_load(const char *staging_area_file,
 		loge("could not read file size");
 		goto filesystem_error2;
 	}
-	staging_area_len = stat.st_size;
-	buf = (char*) malloc(staging_area_len * sizeof(char));
-	if (!buf) {
-		loge("malloc failed");
+	map = calloc(1, sizeof(*map));
+	if (!map) {
+		loge("calloc failed");
+		rc = -ENOMEM;
 		goto filesystem_error2;
 	}
-	rc = reliable_read(fd, buf, staging_area_len);
-	if (rc < 0) {
-		loge("failed to read staging area from file %s",
+	map->len  = stat.st_size;
+	map->base = mmap(NULL, map->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map->len == 0 || map->base == MAP_FAILED) {
+		loge("failed to map staging area from file %s",
 		     staging_area_file);
-		goto filesystem_error3;
+		free(map);
+		rc = -EINVAL;
+		goto invalid_staging_area_error;
+	}
+	/* The mapping stays valid after the file is closed */
+	close(fd);
+	staging_area->map = map;
+	rc = staging_area_trailer_parse(map->base, map->len, &trailer);
+	if (rc > 0) {
+		map->image_len = trailer.image_len;
+		map->has_trailer = 1;
+		rc = staging_area_device_id_get(staging_area);
+		if (rc == 0) {
+			rc = staging_area_index_toc(staging_area, &trailer);
+		}
+	} else if (rc == 0) {
+		/* Legacy staging area: just the upload image */
+		map->image_len = map->len;
+		rc = staging_area_device_id_get(staging_area);
+		if (rc == 0) {
+			rc = staging_area_index(staging_area);
+		}
+	}
+	if (rc == 0) {
+		/* Changes made since the file was last written */
+		rc = staging_area_journal_replay(staging_area_file,
+		                                 staging_area);
 	}
-	/* Static config */
-	rc = sja1105_static_config_unpack(buf, static_config);
 	if (rc < 0) {
 		loge("error while interpreting config");
-		goto invalid_staging_area_error;
+		staging_area_release(staging_area);
+		sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
+		return rc;
 	}
 	return 0;
-filesystem_error3:
-	free(buf);
 filesystem_error2:
 	close(fd);
 filesystem_error1:
 	sja1105_err_remap(rc, SJA1105_ERR_FILESYSTEM);
 	return rc;
 invalid_staging_area_error:
+	close(fd);
 	sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
 	return rc;
 }
 
+/* Tells apart the successive contents of the staging area file,
+ * 0 if it was not loaded from one */
+uint64_t staging_area_image_id(struct sja1105_staging_area *staging_area)
+{
+	struct sja1105_staging_area_map *map = staging_area->map;
+
+	if (map == NULL) {
+		return 0;
+	}
+	return sja1105_fnv1a64(map->base, map->len);
+}
+
+/* Build the compact form of the staging area. Tables that were never
+ * unpacked are taken as they are from the file. */
+int
+staging_area_compact(struct sja1105_staging_area *staging_area,
+                     struct sja1105_compact_config *compact)
+{
+	struct sja1105_static_config *config = &staging_area->static_config;
+	struct sja1105_staging_area_map *map = staging_area->map;
+	int blk_idx;
+	int rc;
+
+	if (map == NULL) {
+		return sja1105_compact_config_from_static(compact, config);
+	}
+	sja1105_compact_config_init(compact, config->device_id);
+	if (map->tables[BLK_IDX_L2_LOOKUP].state == STAGING_TABLE_UNPACKED) {
+		sja1105_static_config_patch_fdb(config);
+	}
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		struct sja1105_compact_table *table = &compact->tables[blk_idx];
+
+		switch (map->tables[blk_idx].state) {
+		case STAGING_TABLE_PACKED:
+			rc = sja1105_compact_config_resize(compact, blk_idx,
+			         map->tables[blk_idx].len / table->entry_size);
+			if (rc == 0) {
+				memcpy(table->entries, map->tables[blk_idx].data,
+				       table->count * table->entry_size);
+			}
+			break;
+		default:
+			/* Unpacked, or absent from the file but possibly
+			 * given entries since (its count started at zero) */
+			rc = sja1105_compact_table_from_static(compact, config,
+			                                       blk_idx);
+		}
+		if (rc < 0) {
+			sja1105_compact_config_free(compact);
+			return rc;
+		}
+	}
+	return 0;
+}
+
+/* The final table header carries the CRC of everything before it */
+static void staging_area_image_finalize(char *buf, int len)
+{
+	struct sja1105_table_header final_header;
+	char *final_header_ptr;
+
+	/* Read the whole table header */
+	final_header_ptr = buf + len - SIZE_TABLE_HEADER;
+	sja1105_table_header_unpack(final_header_ptr, &final_header);
+	/* Modify. Don't include the CRC field itself */
+	final_header.crc = ether_crc32_le(buf, len - 4);
+	/* Rewrite */
+	sja1105_table_header_pack(final_header_ptr, &final_header);
+}
+
 int
 staging_area_save(const char *staging_area_file,
                   struct sja1105_staging_area *staging_area)
 {
-	struct sja1105_static_config *static_config;
+	struct sja1105_compact_config compact;
 	int   rc = 0;
 	char *buf;
-	int   static_config_len;
 	int   staging_area_len;
+	char *trailer;
+	int   trailer_len;
+	char *tmp_file;
 	int   fd;
 
-	static_config     = &staging_area->static_config;
-	static_config_len = sja1105_static_config_get_length(static_config);
-	staging_area_len  = static_config_len;
+	rc = staging_area_compact(staging_area, &compact);
+	if (rc < 0) {
+		goto out_1;
+	}
+	staging_area_len = sja1105_compact_config_get_length(&compact);
 
 	buf = (char*) malloc(staging_area_len * sizeof(char));
 	if (!buf) {
 		loge("malloc failed");
+		rc = -ENOMEM;
 		goto out_1;
 	}
-	logv("saving static config... %d bytes", static_config_len);
-	rc = sja1105_static_config_pack(buf, static_config);
+	logv("saving static config... %d bytes", staging_area_len);
+	rc = sja1105_compact_config_pack(buf, &compact);
+	if (rc < 0) {
+		loge("sja1105_compact_config_pack failed");
+		goto out_2;
+	}
+	/* Store the image exactly as it is uploaded */
+	staging_area_image_finalize(buf, staging_area_len);
+	rc = staging_area_trailer_build(buf, staging_area_len,
+	                                staging_area->xml_hash,
+	                                &trailer, &trailer_len);
 	if (rc < 0) {
-		loge("sja1105_static_config_pack failed");
 		goto out_2;
 	}
 
-	logv("total staging area size: %d bytes", staging_area_len);
-	fd = open(staging_area_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	logv("total staging area size: %d bytes", staging_area_len + trailer_len);
+	/* Write aside and rename over the file: its previous contents
+	 * may still be mapped, and the journal kept next to it must
+	 * never be found with half a new file */
+	tmp_file = malloc(strlen(staging_area_file) + 5);
+	if (tmp_file == NULL) {
+		loge("malloc failed");
+		rc = -ENOMEM;
+		goto out_3;
+	}
+	sprintf(tmp_file, "%s.tmp", staging_area_file);
+	fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 	if (fd < 0) {
-		loge("could not open %s for write", staging_area_file);
+		loge("could not open %s for write", tmp_file);
 		rc = fd;
-		goto out_2;
+		goto out_4;
 	}
 
 	rc = reliable_write(fd, buf, staging_area_len);
+	if (rc == 0) {
+		rc = reliable_write(fd, trailer, trailer_len);
+	}
+	if (close(fd) < 0 && rc == 0) {
+		rc = -EIO;
+	}
+	if (rc == 0 && rename(tmp_file, staging_area_file) < 0) {
+		loge("could not replace %s", staging_area_file);
+		rc = -errno;
+	}
 	if (rc < 0) {
-		goto out_2;
+		unlink(tmp_file);
+		goto out_4;
 	}
+	/* Whatever was journaled is part of the file now. Should this
+	 * not happen, the journal no longer matches the file and is
+	 * dropped when next replayed. */
+	staging_area_journal_clear(staging_area_file);
 	logv("done");
-
-	close(fd);
+out_4:
+	free(tmp_file);
+out_3:
+	free(trailer);
 out_2:
 	free(buf);
+	sja1105_compact_config_free(&compact);
 out_1:
 	return rc;
 }
 
+/* Pack config into a newly allocated buffer, exactly as it is sent
+ * over SPI, with the CRC of the last header filled in. Goes through
+ * the compact representation, so that the buffer and the packing work
+ * are sized for the tables actually in use.
+ */
 static int
-static_config_upload(struct sja1105_spi_setup *spi_setup,
-                     struct sja1105_static_config *config)
+static_config_pack_final(struct sja1105_static_config *config,
+                         char **config_buf, int *config_buf_len)
 {
-	struct   sja1105_table_header final_header;
-	char    *final_header_ptr;
-	char  *config_buf;
-	int    config_buf_len;
-	int    crc_len;
-	int    rc;
-
-	config_buf_len = sja1105_static_config_get_length(config);
-	config_buf = (char*) malloc(config_buf_len * sizeof(char));
-	if (!config_buf) {
+	struct   sja1105_compact_config compact;
+	char    *buf;
+	int      len;
+	int      rc;
+
+	rc = sja1105_compact_config_from_static(&compact, config);
+	if (rc < 0) {
+		return rc;
+	}
+	logv("compact config: %zu bytes", sja1105_compact_config_mem_size(&compact));
+	len = sja1105_compact_config_get_length(&compact);
+	buf = (char*) malloc(len * sizeof(char));
+	if (!buf) {
 		loge("malloc failed");
 		rc = -errno;
 		goto out;
 	}
-	/* Write Device ID and config tables to config_buf */
-	rc = sja1105_static_config_pack(config_buf, config);
+	/* Write Device ID and config tables to buf */
+	rc = sja1105_compact_config_pack(buf, &compact);
 	if (rc < 0) {
-		loge("sja1105_static_config_pack failed");
-		goto out_free;
+		loge("sja1105_compact_config_pack failed");
+		free(buf);
+		goto out;
 	}
-	/* Recalculate CRC of the last header */
-	/* Don't include the CRC field itself */
-	crc_len = config_buf_len - 4;
-	/* Read the whole table header */
-	final_header_ptr = config_buf + config_buf_len - SIZE_TABLE_HEADER;
-	sja1105_table_header_unpack(final_header_ptr, &final_header);
-	/* Modify */
-	final_header.crc = ether_crc32_le(config_buf, crc_len);
-	/* Rewrite */
-	sja1105_table_header_pack(final_header_ptr, &final_header);
-
-	rc = sja1105_spi_send_long_packed_buf(spi_setup,
-	                                      SPI_WRITE,
-	                                      CONFIG_ADDR,
-	                                      config_buf,
-	                                      config_buf_len);
-out_free:
-	free(config_buf);
+	staging_area_image_finalize(buf, len);
+	*config_buf = buf;
+	*config_buf_len = len;
 out:
+	sja1105_compact_config_free(&compact);
 	return rc;
 }
 
-int static_config_flush(struct sja1105_spi_setup *spi_setup,
-                        struct sja1105_static_config *config)
+/* A streamed config is also copied aside as it is produced, so that
+ * it can be kept as the last known good one once the switch took it */
+struct static_config_capture {
+	struct sja1105_static_config *config;
+	struct sja1105_spi_stream    *stream;
+	/* Copy of what is sent, for the .applied file */
+	FILE                         *fp;
+	int                           failed;
+	unsigned int                  len;
+};
+
+static int static_config_capture_write(void *priv, const void *buf,
+                                       unsigned int len)
+{
+	struct static_config_capture *capture = priv;
+
+	if (capture->fp && fwrite(buf, 1, len, capture->fp) != len) {
+		capture->failed = 1;
+	}
+	capture->len += len;
+	return sja1105_spi_stream_write(capture->stream, buf, len);
+}
+
+static int static_config_produce(void *priv, struct sja1105_spi_stream *stream)
+{
+	struct static_config_capture *capture = priv;
+
+	capture->stream = stream;
+	return sja1105_static_config_stream(capture->config,
+	                                    static_config_capture_write,
+	                                    capture);
+}
+
+/* Time spent in each step of a full flush */
+struct flush_timing {
+	uint64_t last_us;
+	int      count;
+	struct {
+		const char *name;
+		uint64_t    us;
+	} phase[10];
+};
+
+static void flush_timing_mark(struct flush_timing *timing, const char *name)
+{
+	uint64_t now_us = sja1105_time_us();
+
+	if (timing->count < (int) ARRAY_SIZE(timing->phase)) {
+		timing->phase[timing->count].name = name;
+		timing->phase[timing->count].us = now_us - timing->last_us;
+		timing->count++;
+	}
+	timing->last_us = now_us;
+}
+
+static void flush_timing_show(struct flush_timing *timing, int fast)
+{
+	int show = fast || SJA1105_VERBOSE_CONDITION;
+	uint64_t total_us = 0;
+	int i;
+
+	for (i = 0; i < timing->count; i++) {
+		logc(stdout, show, "flush: %-10s %8" PRIu64 " us",
+		     timing->phase[i].name, timing->phase[i].us);
+		total_us += timing->phase[i].us;
+	}
+	logc(stdout, show, "flush: %-10s %8" PRIu64 " us", "total", total_us);
+}
+
+/* If *config_buf is NULL, config is packed while it is being sent, and
+ * written as it goes to the temporary .applied file. *config_buf_len
+ * then returns the number of bytes recorded there, 0 if there is no
+ * usable copy (see staging_area_applied_commit).
+ * With fast_reconfig, the switch is put back in configuration mode
+ * with the quickest reset its family has, and the CGU writes are
+ * sent in a single SPI message, to keep the traffic outage short.
+ */
+static int
+static_config_flush(struct sja1105_spi_setup *spi_setup,
+                    struct sja1105_static_config *config,
+                    char **config_buf, int *config_buf_len,
+                    struct flush_timing *timing)
 {
+	const struct sja1105_device_ops *ops = sja1105_spi_setup_ops(spi_setup);
 	struct sja1105_general_status status;
 	struct sja1105_egress_port_mask port_mask;
-	int i, rc;
+	int i, rc, batch_rc;
 
-	rc = sja1105_static_config_check_valid(config);
-	if (rc < 0) {
-		loge("cannot upload config, because it is not valid");
-		goto staging_area_invalid_error;
-	}
 	/* Workaround for PHY jabbering during switch reset */
 	memset(&port_mask, 0, sizeof(port_mask));
 	for (i = 0; i < SJA1105T_NUM_PORTS; i++) {
@@ -303,48 +866,87 @@ int static_config_flush(struct sja1105_spi_setup *spi_setup,
 		loge("sja1105_set_egress_port_mask failed");
 		goto hardware_not_responding_error;
 	}
+	flush_timing_mark(timing, "inhibit");
 	/* Wait for an eventual egress packet to finish transmission
 	 * (reach IFG). It is guaranteed that a second one will not
 	 * follow, and that switch cold reset is thus safe
 	 */
 	usleep(1000);
+	flush_timing_mark(timing, "drain");
 	/* Put the SJA1105 in programming mode */
-	rc = sja1105_cold_reset(spi_setup);
+	if (spi_setup->fast_reconfig) {
+		rc = ops->config_mode_reset(spi_setup);
+	} else {
+		rc = sja1105_cold_reset(spi_setup);
+	}
 	if (rc < 0) {
 		loge("sja1105_reset failed");
 		goto hardware_left_floating_error;
 	}
+	flush_timing_mark(timing, "reset");
 	/* If we are configuring static FDB entries (L2 Address Lookup),
-	 * we must wait until L2BUSYS clears. Only do this if we are
-	 * talking to real hardware.
+	 * we must wait until L2BUSYS clears. This returns immediately
+	 * if we are not talking to real hardware.
 	 */
-	if (spi_setup->dry_run == 0 && config->l2_lookup_count > 0) {
-		int retries = 100; /* max 1 second */
-
-		do {
-			rc = sja1105_general_status_get(spi_setup, &status);
-			if (rc < 0)
-				goto hardware_not_responding_error;
-			if (status.l2busys == 0)
-				break;
-			usleep(10000); /* 10 ms */
-		} while (--retries);
-
-		if (retries == 0)
+	if (config->l2_lookup_count > 0) {
+		struct sja1105_spi_wait l2busys = {
+			.reg_addr   = CORE_ADDR + 0x03,
+			.start_bit  = 0,
+			.end_bit    = 0,
+			.expected   = 0,
+			.timeout_us = 1000000, /* max 1 second */
+		};
+
+		rc = sja1105_spi_wait_field(spi_setup, &l2busys);
+		if (rc < 0)
 			goto hardware_not_responding_error;
+		flush_timing_mark(timing, "l2busys");
+	}
+	if (*config_buf) {
+		rc = sja1105_spi_send_long_packed_buf(spi_setup,
+		                                      SPI_WRITE,
+		                                      CONFIG_ADDR,
+		                                      *config_buf,
+		                                      *config_buf_len);
+	} else {
+		struct static_config_capture capture = {
+			.config = config,
+			.fp     = staging_area_applied_open(spi_setup),
+		};
+
+		rc = sja1105_spi_send_stream(spi_setup, CONFIG_ADDR,
+		                             static_config_produce, &capture);
+		if (capture.fp && fclose(capture.fp) != 0) {
+			capture.failed = 1;
+		}
+		*config_buf_len = capture.len;
+		if (rc < 0 || capture.fp == NULL || capture.failed) {
+			staging_area_applied_discard(spi_setup);
+			*config_buf_len = 0;
+		}
 	}
-	rc = static_config_upload(spi_setup, config);
 	if (rc < 0) {
-		loge("static_config_upload failed");
+		loge("static config upload failed");
 		goto hardware_left_floating_error;
 	}
+	flush_timing_mark(timing, "upload");
 	/* Configure the CGU (PHY link modes and speeds) */
+	if (spi_setup->fast_reconfig) {
+		sja1105_spi_batch_begin(spi_setup);
+	}
 	rc = sja1105_clocking_setup(spi_setup, &config->xmii_params[0],
 	                           &config->mac_config[0]);
+	if (spi_setup->fast_reconfig) {
+		batch_rc = sja1105_spi_batch_end(spi_setup);
+		if (rc == 0) {
+			rc = batch_rc;
+		}
+	}
 	if (rc < 0) {
 		loge("sja1105_clocking_setup failed");
 		goto hardware_left_floating_error;
 	}
+	flush_timing_mark(timing, "clocking");
 	/* Check that SJA1105 responded well to the config upload */
 	if (spi_setup->dry_run == 0) {
 		/* These checks simply cannot pass (and do not even
@@ -371,11 +973,9 @@ int static_config_flush(struct sja1105_spi_setup *spi_setup,
 			loge("configuration is invalid");
 			goto hardware_left_floating_error;
 		}
+		flush_timing_mark(timing, "status");
 	}
 	return SJA1105_ERR_OK;
-staging_area_invalid_error:
-	sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
-	return rc;
 hardware_left_floating_error:
 	sja1105_err_remap(rc, SJA1105_ERR_UPLOAD_FAILED_HW_LEFT_FLOATING);
 	return rc;
@@ -384,20 +984,277 @@ hardware_not_responding_error:
 	return rc;
 }
 
+/* A v2 staging area that was loaded and not modified since already
+ * holds the exact bytes to upload. Its final header CRC covers the
+ * whole image (the table CRCs included), so checking it once is
+ * enough to trust the file as it was saved.
+ * Returns 1 and points config_buf to the mapped image if it can be
+ * uploaded as it is, 0 if the config must be packed again.
+ */
+static int
+staging_area_image_get(struct sja1105_staging_area *staging_area,
+                       char **config_buf, int *config_buf_len)
+{
+	struct sja1105_static_config *config = &staging_area->static_config;
+	struct sja1105_staging_area_map *map = staging_area->map;
+	const struct sja1105_table_desc *desc;
+	struct sja1105_table_header final_header;
+	uint64_t computed_crc;
+	int blk_idx;
+	int count;
+
+	if (map == NULL || map->has_trailer == 0 ||
+	    map->image_len < SIZE_SJA1105_DEVICE_ID + SIZE_TABLE_HEADER) {
+		return 0;
+	}
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		if (map->tables[blk_idx].state == STAGING_TABLE_UNPACKED) {
+			return 0;
+		}
+	}
+	sja1105_table_header_unpack(map->base + map->image_len -
+	                            SIZE_TABLE_HEADER, &final_header);
+	computed_crc = ether_crc32_le(map->base, map->image_len - 4);
+	if ((final_header.crc & 0xFFFFFFFF) != computed_crc) {
+		loge("Final header CRC is invalid, staging area is corrupt.");
+		return -EINVAL;
+	}
+	/* The table counts are all that is needed to validate the
+	 * config, and they are known without unpacking the tables */
+	for (blk_idx = 0; blk_idx < BLK_IDX_MAX; blk_idx++) {
+		if (map->tables[blk_idx].state != STAGING_TABLE_PACKED) {
+			continue;
+		}
+		desc = sja1105_table_desc_get(blk_idx);
+		count = map->tables[blk_idx].len /
+		        sja1105_table_entry_size(blk_idx, config->device_id);
+		if (count > desc->max_count) {
+			loge("There can be no more than %d %s entries (%d present)",
+			     desc->max_count, desc->name, count);
+			return -ERANGE;
+		}
+		*(int*) ((char*) config + desc->count_offset) = count;
+	}
+	*config_buf = map->base;
+	*config_buf_len = map->image_len;
+	return 1;
+}
+
+/* Get what the upload sequence needs out of a packed config, without
+ * unpacking it all: the table counts, and the MAC configuration and
+ * xMII mode parameters for the CGU. config must start out zeroed.
+ */
+static int
+image_config_prepare(char *buf, int len, struct sja1105_static_config *config)
+{
+	const struct sja1105_table_desc *desc;
+	struct sja1105_table_header hdr;
+	char *p = buf + SIZE_SJA1105_DEVICE_ID;
+	int blk_idx;
+	int count;
+	int rc;
+
+	rc = sja1105_static_config_verify(buf, len, 0);
+	if (rc < 0) {
+		return rc;
+	}
+	gtable_unpack(buf, &config->device_id, 31, 0, 4);
+	for (;;) {
+		sja1105_table_header_unpack(p, &hdr);
+		if (hdr.len == 0) {
+			break;
+		}
+		p += SIZE_TABLE_HEADER;
+		blk_idx = sja1105_blk_idx_from_id(hdr.block_id);
+		if (blk_idx < 0) {
+			/* Skipped table, already checked by the verify */
+			p += hdr.len * 4 + 4;
+			continue;
+		}
+		desc = sja1105_table_desc_get(blk_idx);
+		count = hdr.len * 4 /
+		        sja1105_table_entry_size(blk_idx, config->device_id);
+		*(int*) ((char*) config + desc->count_offset) = count;
+		if (blk_idx == BLK_IDX_MAC_CONFIG ||
+		    blk_idx == BLK_IDX_XMII_PARAMS) {
+			rc = sja1105_table_entries_unpack(config, blk_idx,
+			                                  p, count);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+		p += hdr.len * 4 + 4;
+	}
+	return 0;
+}
+
+/* Upload the last configuration that the switch accepted again, as
+ * it was sent then. Nothing is parsed or packed on the way. */
+int staging_area_rollback(struct sja1105_spi_setup *spi_setup)
+{
+	struct sja1105_static_config *config;
+	struct flush_timing timing = {0};
+	char *config_buf;
+	int   config_buf_len;
+	int   rc;
+
+	timing.last_us = sja1105_time_us();
+	rc = staging_area_applied_load(spi_setup, &config_buf,
+	                               &config_buf_len);
+	if (rc < 0) {
+		loge("no last known good configuration to roll back to");
+		goto invalid_staging_area_error;
+	}
+	config = calloc(1, sizeof(*config));
+	if (config == NULL) {
+		loge("calloc failed");
+		rc = -ENOMEM;
+		goto out_free_buf;
+	}
+	rc = image_config_prepare(config_buf, config_buf_len, config);
+	if (rc < 0) {
+		loge("last known good configuration is corrupt");
+		free(config);
+		free(config_buf);
+		goto invalid_staging_area_error;
+	}
+	flush_timing_mark(&timing, "load");
+	logi("rollback: uploading the last known good configuration");
+	sja1105_ctx_lock(spi_setup->ctx);
+	rc = static_config_flush(spi_setup, config, &config_buf,
+	                         &config_buf_len, &timing);
+	sja1105_ctx_unlock(spi_setup->ctx);
+	if (rc == 0) {
+		flush_timing_show(&timing, spi_setup->fast_reconfig);
+	}
+	free(config);
+out_free_buf:
+	free(config_buf);
+	return rc;
+invalid_staging_area_error:
+	sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
+	return rc;
+}
+
 int
 staging_area_flush(struct sja1105_spi_setup *spi_setup,
                    struct sja1105_staging_area *staging_area)
 {
-	int rc;
+	struct sja1105_static_config *config = &staging_area->static_config;
+	struct flush_timing timing = {0};
+	char *applied_buf = NULL;
+	int   applied_len = 0;
+	char *config_buf;
+	int   config_buf_len;
+	int   stored;
+	int   rc;
+
+	timing.last_us = sja1105_time_us();
+	stored = staging_area_image_get(staging_area, &config_buf,
+	                                &config_buf_len);
+	if (stored < 0) {
+		rc = stored;
+		goto invalid_staging_area_error;
+	}
+	if (stored) {
+		const uint64_t needed[] = {
+			/* Frame memory partitioning, for the validity check */
+			BLKID_L2_FORWARDING_PARAMS_TABLE,
+			BLKID_VL_FORWARDING_PARAMS_TABLE,
+			/* Clocking setup */
+			BLKID_MAC_CONFIG_TABLE,
+			BLKID_XMII_MODE_PARAMS_TABLE,
+		};
+		unsigned int i;
 
-	rc = static_config_flush(spi_setup, &staging_area->static_config);
+		logv("uploading staging area as stored");
+		for (i = 0, rc = 0; i < ARRAY_SIZE(needed) && rc == 0; i++) {
+			rc = staging_area_table_get(staging_area, needed[i]);
+		}
+	} else {
+		rc = staging_area_tables_get_all(staging_area);
+	}
+	if (rc < 0) {
+		return rc;
+	}
+	rc = sja1105_static_config_check_valid(config);
+	if (rc < 0) {
+		loge("cannot upload config, because it is not valid");
+		goto invalid_staging_area_error;
+	}
+	if (spi_setup->delta_flush &&
+	    staging_area_applied_load(spi_setup, &applied_buf,
+	                              &applied_len) < 0) {
+		logi("flush: configuration running on the switch is unknown");
+	}
+	if (!stored && applied_buf == NULL && !spi_setup->fast_reconfig) {
+		/* Nothing to compare against: pack while uploading.
+		 * A fast reconfiguration packs everything up front
+		 * instead, so that the switch is reset as late as
+		 * possible. */
+		config_buf = NULL;
+		config_buf_len = 0;
+	} else if (!stored) {
+		rc = static_config_pack_final(config, &config_buf,
+		                              &config_buf_len);
+		if (rc < 0) {
+			goto invalid_staging_area_error;
+		}
+	}
+	flush_timing_mark(&timing, "pack");
+	/* Keep other users of the context off the bus for the
+	 * whole reset and upload sequence */
+	sja1105_ctx_lock(spi_setup->ctx);
+	if (applied_buf) {
+		rc = staging_area_delta_flush(spi_setup, applied_buf,
+		                              applied_len, config_buf,
+		                              config_buf_len);
+		if (rc > 0) {
+			goto out_applied;
+		}
+		if (rc < 0) {
+			logi("dynamic reconfiguration failed, "
+			     "falling back to a full flush");
+		}
+		flush_timing_mark(&timing, "delta");
+	}
+	logi("flush: full reconfiguration (switch reset and upload)");
+	rc = static_config_flush(spi_setup, config, &config_buf,
+	                         &config_buf_len, &timing);
 	if (rc < 0) {
 		loge("static_config_flush failed");
+		staging_area_applied_discard(spi_setup);
+		if (staging_area_rollback(spi_setup) == 0) {
+			logi("flush: switch is back to the last known good "
+			     "configuration");
+			sja1105_err_remap(rc, SJA1105_ERR_UPLOAD_FAILED_ROLLED_BACK);
+		}
 		goto out;
 	}
+	flush_timing_show(&timing, spi_setup->fast_reconfig);
 	/* TODO: other configuration tables?
 	 */
+out_applied:
+	if (config_buf) {
+		staging_area_applied_save(spi_setup, config_buf,
+		                          config_buf_len);
+	} else if (config_buf_len) {
+		/* Streamed, and recorded on the way */
+		staging_area_applied_commit(spi_setup);
+	} else {
+		/* Would not match what the switch runs any longer */
+		staging_area_applied_clear(spi_setup);
+	}
+	rc = SJA1105_ERR_OK;
 out:
+	sja1105_ctx_unlock(spi_setup->ctx);
+	if (!stored) {
+		free(config_buf);
+	}
+	free(applied_buf);
+	return rc;
+invalid_staging_area_error:
+	free(applied_buf);
+	sja1105_err_remap(rc, SJA1105_ERR_STAGING_AREA_INVALID);
 	return rc;
 }
-
@@ -31,6 +31,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <inttypes.h>
 #include "internal.h"
 /* From libsja1105 */
@@ -63,10 +64,14 @@ struct fields_set {
 	int cs_change;
 	int dry_run;
 	int flush;
+	int delta_flush;
+	int fast_reconfig;
 	int verbose;
 	int debug;
 	int entries_per_line;
 	int screen_width;
+	int threads;
+	int compile_cache;
 };
 
 static void
@@ -90,10 +95,13 @@ config_set_defaults(struct sja1105_spi_setup *spi_setup,
 	SET_DEFAULT_VAL(spi_setup, cs_change, 0, logi, "%d");
 	SET_DEFAULT_VAL(spi_setup, dry_run, 0, logi, "%d");
 	SET_DEFAULT_VAL(spi_setup, flush, 0, logi, "%d");
+	SET_DEFAULT_VAL(spi_setup, delta_flush, 1, logv, "%d");
+	SET_DEFAULT_VAL(spi_setup, fast_reconfig, 0, logv, "%d");
 	SET_DEFAULT_VAL(general_conf, verbose, 0, logi, "%d");
 	SET_DEFAULT_VAL(general_conf, debug, 0, logi, "%d");
 	SET_DEFAULT_VAL(general_conf, entries_per_line, 1, logi, "%d");
 	SET_DEFAULT_VAL(general_conf, screen_width, 80, logi, "%d");
+	SET_DEFAULT_VAL(general_conf, threads, 1, logv, "%d");
 }
 
 static int parse_spi_mode(struct sja1105_spi_setup *spi_setup, char *mode)
@@ -192,6 +200,28 @@ parse_spi_setup(struct sja1105_spi_setup *spi_setup, char *key, char *value,
 			return -1;
 		}
 		fields_set->flush = 1;
+	} else if (strcmp(key, "delta_flush") == 0) {
+		if (strcmp(value, "false") == 0) {
+			spi_setup->delta_flush = 0;
+		} else if (strcmp(value, "true") == 0) {
+			spi_setup->delta_flush = 1;
+		} else {
+			loge("Invalid value \"%s\" for delta_flush. "
+			     "Expected true or false.", value);
+			return -1;
+		}
+		fields_set->delta_flush = 1;
+	} else if (strcmp(key, "fast_reconfig") == 0) {
+		if (strcmp(value, "false") == 0) {
+			spi_setup->fast_reconfig = 0;
+		} else if (strcmp(value, "true") == 0) {
+			spi_setup->fast_reconfig = 1;
+		} else {
+			loge("Invalid value \"%s\" for fast_reconfig. "
+			     "Expected true or false.", value);
+			return -1;
+		}
+		fields_set->fast_reconfig = 1;
 	} else if (strcmp(key, "staging_area") == 0) {
 		spi_setup->staging_area = strdup(value);
 		fields_set->staging_area = 1;
@@ -248,6 +278,16 @@ parse_general_config(struct general_config *general_conf,
 		}
 		general_conf->screen_width = tmp;
 		fields_set->screen_width = 1;
+	} else if (strcmp(key, "threads") == 0) {
+		rc = reliable_uint64_from_string(&tmp, value, NULL);
+		if (rc < 0 || tmp > INT_MAX) {
+			goto error;
+		}
+		general_conf->threads = tmp;
+		fields_set->threads = 1;
+	} else if (strcmp(key, "compile_cache") == 0) {
+		general_conf->compile_cache = strdup(value);
+		fields_set->compile_cache = 1;
 	} else {
 		loge("Invalid key \"%s\"", key);
 		return -1;
@@ -35,5 +35,6 @@
 #include "internal.h"
 
 int sja1105_staging_area_from_xml(const char*, struct sja1105_staging_area*);
+int sja1105_staging_area_parse_xml(const char*, struct sja1105_staging_area*);
 
 #endif